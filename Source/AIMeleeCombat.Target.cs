@@ -9,6 +9,6 @@ public class AIMeleeCombatTarget : TargetRules
 	{
 		Type = TargetType.Game;
 		DefaultBuildSettings = BuildSettingsVersion.V2;
-		ExtraModuleNames.AddRange( new string[] { "AIMeleeCombat" } );
+		ExtraModuleNames.AddRange( new string[] { "AIMeleeCombat", "CombatCore" } );
 	}
 }
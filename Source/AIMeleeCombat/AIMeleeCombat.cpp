@@ -3,4 +3,6 @@
 #include "AIMeleeCombat.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_LOG_CATEGORY(LogAIMeleeCombat);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, AIMeleeCombat, "AIMeleeCombat" );
@@ -4,3 +4,7 @@
 
 #include "CoreMinimal.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogAIMeleeCombat, Log, All);
+
+// "stat AIMeleeCombat" shows the combat systems counters & timings
+DECLARE_STATS_GROUP(TEXT("AIMeleeCombat"), STATGROUP_AIMeleeCombat, STATCAT_Advanced);
@@ -2,4 +2,413 @@
 
 
 #include "AIMeleeCombatGameModeBase.h"
+#include "AIMeleeCombat.h"
+#include "AIMeleeCombatSettings.h"
+#include "AI_BaseCharacter.h"
+#include "CorpseSubsystem.h"
+#include "CombatArchetype.h"
+#include "CombatAssetStreamer.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "NavigationSystem.h"
+#include "HAL/IConsoleManager.h"
 
+DECLARE_CYCLE_STAT(TEXT("Wave Spawning"), STAT_WaveSpawning, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pending Spawns"), STAT_PendingSpawns, STATGROUP_AIMeleeCombat);
+
+static FAutoConsoleCommandWithWorldAndArgs StartWaveCommand(
+	TEXT("AIMelee.Spawner.StartWave"),
+	TEXT("Starts the wave at the given index (AIMelee.Spawner.StartWave 0)"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if(AAIMeleeCombatGameModeBase* GameMode = World ? World->GetAuthGameMode<AAIMeleeCombatGameModeBase>() : nullptr)
+		{
+			GameMode->StartWave(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 0);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld SpawnerReportCommand(
+	TEXT("AIMelee.Spawner.Report"),
+	TEXT("Logs the spawn latency & frame hitches of the current wave"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if(const AAIMeleeCombatGameModeBase* GameMode = World ? World->GetAuthGameMode<AAIMeleeCombatGameModeBase>() : nullptr)
+		{
+			GameMode->LogReport();
+		}
+	}));
+
+AAIMeleeCombatGameModeBase::AAIMeleeCombatGameModeBase() :
+	bAutoStartWaves(false),
+	CurrentWave(INDEX_NONE),
+	WaveStartTime(0.0),
+	LoadCompleteTime(0.0),
+	TotalSpawnLatency(0.0),
+	MaxSpawnLatency(0.0),
+	MaxSpawnFrameMs(0.0),
+	MaxWaveFrameMs(0.f),
+	NumArchetypesLoading(0),
+	NumSpawned(0),
+	NumRevived(0),
+	NumSpawnFrames(0)
+{
+	// Only ticks while a wave is spawning
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+}
+
+void AAIMeleeCombatGameModeBase::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if(bAutoStartWaves && Waves.Num() > 0)
+	{
+		StartWave(0);
+	}
+}
+
+void AAIMeleeCombatGameModeBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for (TPair<int32, TSharedPtr<FStreamableHandle>>& LoadHandle : WaveLoadHandles)
+	{
+		if(LoadHandle.Value.IsValid())
+		{
+			LoadHandle.Value->CancelHandle();
+		}
+	}
+	WaveLoadHandles.Empty();
+	PendingSpawns.Empty();
+	ReleaseArchetypes(WaveArchetypes);
+	ReleaseArchetypes(PreviousWaveArchetypes);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AAIMeleeCombatGameModeBase::PrewarmWave(int32 WaveIndex)
+{
+	if(!Waves.IsValidIndex(WaveIndex) || WaveLoadHandles.Contains(WaveIndex)) { return; }
+
+	TArray<FSoftObjectPath> ClassesToLoad;
+	for (const FSpawnWaveEntry& Entry : Waves[WaveIndex].Entries)
+	{
+		if(!Entry.CombatantClass.IsNull())
+		{
+			ClassesToLoad.AddUnique(Entry.CombatantClass.ToSoftObjectPath());
+		}
+		if(!Entry.Archetype.IsNull())
+		{
+			ClassesToLoad.AddUnique(Entry.Archetype.ToSoftObjectPath());
+		}
+	}
+
+	// Handle is still stored when there is nothing to load so StartWave doesn't request it again
+	TSharedPtr<FStreamableHandle> LoadHandle;
+	if(ClassesToLoad.Num() > 0)
+	{
+		LoadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(ClassesToLoad, FStreamableDelegate(), FStreamableManager::AsyncLoadHighPriority);
+	}
+	WaveLoadHandles.Add(WaveIndex, LoadHandle);
+}
+
+void AAIMeleeCombatGameModeBase::StartWave(int32 WaveIndex)
+{
+	if(!Waves.IsValidIndex(WaveIndex))
+	{
+		UE_LOG(LogAIMeleeCombat, Warning, TEXT("StartWave: there is no wave %d (%d waves)"), WaveIndex, Waves.Num());
+		return;
+	}
+
+	GetWorldTimerManager().ClearTimer(NextWaveTimerHandle);
+	GetWorldTimerManager().ClearTimer(WaveClearedTimerHandle);
+	SetActorTickEnabled(false);
+
+	CurrentWave = WaveIndex;
+	PendingSpawns.Reset();
+	WaveCombatants.Reset();
+	ReleaseArchetypes(PreviousWaveArchetypes);
+	PreviousWaveArchetypes = MoveTemp(WaveArchetypes);
+	WaveArchetypes.Reset();
+	NumArchetypesLoading = 0;
+
+	WaveStartTime = FPlatformTime::Seconds();
+	LoadCompleteTime = WaveStartTime;
+	TotalSpawnLatency = 0.0;
+	MaxSpawnLatency = 0.0;
+	MaxSpawnFrameMs = 0.0;
+	MaxWaveFrameMs = 0.f;
+	NumSpawned = 0;
+	NumRevived = 0;
+	NumSpawnFrames = 0;
+
+	PrewarmWave(WaveIndex);
+
+	const TSharedPtr<FStreamableHandle> LoadHandle = WaveLoadHandles.FindRef(WaveIndex);
+	if(LoadHandle.IsValid() && !LoadHandle->HasLoadCompleted())
+	{
+		LoadHandle->BindCompleteDelegate(FStreamableDelegate::CreateUObject(this, &AAIMeleeCombatGameModeBase::OnWaveLoaded, WaveIndex));
+	}
+	else
+	{
+		OnWaveLoaded(WaveIndex);
+	}
+}
+
+void AAIMeleeCombatGameModeBase::OnWaveLoaded(int32 WaveIndex)
+{
+	// A different wave was started while this one was loading
+	if(WaveIndex != CurrentWave) { return; }
+
+	LoadCompleteTime = FPlatformTime::Seconds();
+
+	const FSpawnWave& Wave = Waves[WaveIndex];
+
+	TArray<AActor*> SpawnPoints;
+	if(!Wave.SpawnPointTag.IsNone())
+	{
+		UGameplayStatics::GetAllActorsWithTag(this, Wave.SpawnPointTag, SpawnPoints);
+	}
+
+	FVector FallbackOrigin = FVector::ZeroVector;
+	if(SpawnPoints.Num() == 0)
+	{
+		if(const AActor* PlayerStart = FindPlayerStart(nullptr))
+		{
+			FallbackOrigin = PlayerStart->GetActorLocation();
+		}
+	}
+
+	// Spawn points are used in turn so each group is spread over all of them
+	int32 SpawnPointIndex = 0;
+	for (const FSpawnWaveEntry& Entry : Wave.Entries)
+	{
+		UClass* CombatantClass = Entry.CombatantClass.Get();
+		if(CombatantClass == nullptr)
+		{
+			UE_LOG(LogAIMeleeCombat, Warning, TEXT("Wave %d: %s failed to load"), WaveIndex, *Entry.CombatantClass.ToString());
+			continue;
+		}
+
+		for (int32 Count = 0; Count < Entry.Count; ++Count)
+		{
+			FPendingSpawn& PendingSpawn = PendingSpawns.AddDefaulted_GetRef();
+			PendingSpawn.CombatantClass = CombatantClass;
+			PendingSpawn.Archetype = Entry.Archetype.Get();
+			PendingSpawn.TeamNumber = Entry.TeamNumber;
+			PendingSpawn.Origin = SpawnPoints.Num() > 0 ? SpawnPoints[SpawnPointIndex++ % SpawnPoints.Num()]->GetActorLocation() : FallbackOrigin;
+		}
+
+		// The class default archetype is used when the entry doesn't override it
+		UCombatArchetype* Archetype = Entry.Archetype.Get();
+		if(Archetype == nullptr)
+		{
+			Archetype = CombatantClass->GetDefaultObject<AAI_BaseCharacter>()->GetArchetype();
+		}
+		if(Archetype)
+		{
+			WaveArchetypes.AddUnique(Archetype);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_PendingSpawns, PendingSpawns.Num());
+
+	// Streams the montages in before the first spawn so no AI has to wait on (or load) its animations
+	UCombatAssetStreamer* Streamer = UCombatAssetStreamer::Get(this);
+	if(Streamer && WaveArchetypes.Num() > 0)
+	{
+		NumArchetypesLoading = WaveArchetypes.Num();
+		for (const UCombatArchetype* Archetype : TArray<UCombatArchetype*>(WaveArchetypes))
+		{
+			TArray<FSoftObjectPath> MontagePaths;
+			Archetype->GetMontagePaths(MontagePaths);
+			Streamer->Acquire(Archetype, MontagePaths, FSimpleDelegate::CreateUObject(this, &AAIMeleeCombatGameModeBase::OnWaveArchetypeLoaded, WaveIndex));
+		}
+	}
+	else
+	{
+		ReleaseArchetypes(PreviousWaveArchetypes);
+		SetActorTickEnabled(PendingSpawns.Num() > 0);
+	}
+}
+
+void AAIMeleeCombatGameModeBase::OnWaveArchetypeLoaded(int32 WaveIndex)
+{
+	if(WaveIndex != CurrentWave || --NumArchetypesLoading > 0) { return; }
+
+	// Montages shared with the previous wave are now held by this one too, so dropping its hold won't unload them
+	ReleaseArchetypes(PreviousWaveArchetypes);
+
+	LoadCompleteTime = FPlatformTime::Seconds();
+	SetActorTickEnabled(PendingSpawns.Num() > 0);
+}
+
+void AAIMeleeCombatGameModeBase::ReleaseArchetypes(TArray<UCombatArchetype*>& Archetypes)
+{
+	if(UCombatAssetStreamer* Streamer = UCombatAssetStreamer::Get(this))
+	{
+		for (const UCombatArchetype* Archetype : Archetypes)
+		{
+			Streamer->Release(Archetype);
+		}
+	}
+	Archetypes.Reset();
+}
+
+void AAIMeleeCombatGameModeBase::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if(PendingSpawns.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_WaveSpawning);
+
+	// DeltaSeconds is the length of the previous frame, which includes the frame the wave finished loading on
+	MaxWaveFrameMs = FMath::Max(MaxWaveFrameMs, DeltaSeconds * 1000.f);
+
+	const double BudgetSeconds = GetDefault<UAIMeleeCombatSettings>()->SpawnFrameBudgetMs / 1000.0;
+	const double FrameStart = FPlatformTime::Seconds();
+
+	// Oldest first so latency stays fair across groups
+	int32 NumProcessed = 0;
+	do
+	{
+		const FPendingSpawn PendingSpawn = PendingSpawns[NumProcessed++];
+		SpawnCombatant(PendingSpawn.CombatantClass, PendingSpawn.Archetype, PendingSpawn.TeamNumber, PendingSpawn.Origin);
+	}
+	while (NumProcessed < PendingSpawns.Num() && FPlatformTime::Seconds() - FrameStart < BudgetSeconds);
+
+	PendingSpawns.RemoveAt(0, NumProcessed, false);
+
+	++NumSpawnFrames;
+	MaxSpawnFrameMs = FMath::Max(MaxSpawnFrameMs, (FPlatformTime::Seconds() - FrameStart) * 1000.0);
+	SET_DWORD_STAT(STAT_PendingSpawns, PendingSpawns.Num());
+
+	if(PendingSpawns.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+		LogReport();
+
+		// Loads the next wave while this one is being fought
+		PrewarmWave(CurrentWave + 1);
+
+		if(bAutoStartWaves)
+		{
+			GetWorldTimerManager().SetTimer(WaveClearedTimerHandle, this, &AAIMeleeCombatGameModeBase::CheckWaveCleared, 1.f, true);
+		}
+	}
+}
+
+bool AAIMeleeCombatGameModeBase::SpawnCombatant(UClass* CombatantClass, UCombatArchetype* Archetype, int32 TeamNumber, const FVector& Origin)
+{
+	const FTransform SpawnTransform(FRotator(0.f, FMath::FRandRange(-180.f, 180.f), 0.f), PickSpawnLocation(Origin));
+
+	// Reusing a pooled corpse skips construction, component registration & BeginPlay entirely
+	AAI_BaseCharacter* Combatant = nullptr;
+	if(UCorpseSubsystem* CorpseSubsystem = UCorpseSubsystem::Get(this))
+	{
+		Combatant = CorpseSubsystem->AcquirePooledCombatant(CombatantClass, Archetype);
+	}
+
+	// Teams are set before the combatant registers with the registry & perception, so nobody ever sees it on its old or default team
+	if(Combatant)
+	{
+		if(TeamNumber >= 0)
+		{
+			Combatant->SetGenericTeamId(FGenericTeamId(static_cast<uint8>(TeamNumber)));
+		}
+		Combatant->ReviveFromPool(SpawnTransform);
+		++NumRevived;
+	}
+	else
+	{
+		Combatant = GetWorld()->SpawnActorDeferred<AAI_BaseCharacter>(CombatantClass, SpawnTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn);
+		if(Combatant == nullptr) { return false; }
+
+		if(Archetype)
+		{
+			Combatant->SetArchetype(Archetype);
+		}
+		if(TeamNumber >= 0)
+		{
+			Combatant->SetGenericTeamId(FGenericTeamId(static_cast<uint8>(TeamNumber)));
+		}
+
+		// Hand placed AI are possessed on load, spawned ones need to ask for their controller
+		Combatant->AutoPossessAI = EAutoPossessAI::PlacedInWorldOrSpawned;
+		Combatant->FinishSpawning(SpawnTransform);
+	}
+
+	WaveCombatants.Add(Combatant->GetCombatantHandle());
+	++NumSpawned;
+
+	const double Latency = FPlatformTime::Seconds() - WaveStartTime;
+	TotalSpawnLatency += Latency;
+	MaxSpawnLatency = FMath::Max(MaxSpawnLatency, Latency);
+
+	return true;
+}
+
+FVector AAIMeleeCombatGameModeBase::PickSpawnLocation(const FVector& Origin) const
+{
+	const float SpawnRadius = GetDefault<UAIMeleeCombatSettings>()->SpawnRadius;
+
+	const UNavigationSystemV1* NavSystem = UNavigationSystemV1::GetCurrent<UNavigationSystemV1>(GetWorld());
+	FNavLocation NavLocation;
+	if(NavSystem && SpawnRadius > 0.f && NavSystem->GetRandomReachablePointInRadius(Origin, SpawnRadius, NavLocation))
+	{
+		return NavLocation.Location;
+	}
+
+	return Origin;
+}
+
+void AAIMeleeCombatGameModeBase::CheckWaveCleared()
+{
+	const UCombatantRegistry* Registry = UCombatantRegistry::Get(this);
+	if(Registry == nullptr) { return; }
+
+	for (const FCombatantHandle& Handle : WaveCombatants)
+	{
+		if(Registry->IsAlive(Handle)) { return; }
+	}
+
+	GetWorldTimerManager().ClearTimer(WaveClearedTimerHandle);
+
+	// Requested before the cleared waves handle is released so classes shared by both waves stay loaded
+	// (its archetype montages are released once the next waves montages have streamed in, in OnWaveArchetypeLoaded)
+	const int32 NextWave = CurrentWave + 1;
+	PrewarmWave(NextWave);
+	WaveLoadHandles.Remove(CurrentWave);
+
+	if(!Waves.IsValidIndex(NextWave)) { return; }
+
+	const float Delay = Waves[NextWave].DelayBeforeWave;
+	if(Delay > 0.f)
+	{
+		GetWorldTimerManager().SetTimer(NextWaveTimerHandle, FTimerDelegate::CreateUObject(this, &AAIMeleeCombatGameModeBase::StartWave, NextWave), Delay, false);
+	}
+	else
+	{
+		StartWave(NextWave);
+	}
+}
+
+void AAIMeleeCombatGameModeBase::LogReport() const
+{
+	if(CurrentWave == INDEX_NONE)
+	{
+		UE_LOG(LogAIMeleeCombat, Log, TEXT("No wave has been started"));
+		return;
+	}
+
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("Wave %d: %d spawned (%d revived from the corpse pool), %d pending, load %.1f ms, spawn latency avg %.1f ms / max %.1f ms"),
+		CurrentWave, NumSpawned, NumRevived, PendingSpawns.Num(), (LoadCompleteTime - WaveStartTime) * 1000.0,
+		NumSpawned > 0 ? TotalSpawnLatency / NumSpawned * 1000.0 : 0.0, MaxSpawnLatency * 1000.0);
+
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("Wave %d: spawned over %d frames, worst spawn frame %.2f ms (budget %.2f ms), worst frame while spawning %.1f ms"),
+		CurrentWave, NumSpawnFrames, MaxSpawnFrameMs, GetDefault<UAIMeleeCombatSettings>()->SpawnFrameBudgetMs, MaxWaveFrameMs);
+}
@@ -4,14 +4,148 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "CombatantRegistry.h"
 #include "AIMeleeCombatGameModeBase.generated.h"
 
+class AAI_BaseCharacter;
+struct FStreamableHandle;
+
+// A group of one combatant type in a wave
+USTRUCT(BlueprintType)
+struct FSpawnWaveEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Spawning)
+	TSoftClassPtr<AAI_BaseCharacter> CombatantClass;
+
+	// Overrides the archetype set on the class (lets one class be reused for several combat types)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Spawning)
+	TSoftObjectPtr<class UCombatArchetype> Archetype;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Spawning, meta = (ClampMin = "1"))
+	int32 Count = 1;
+
+	// Team given to the spawned combatants (-1 keeps the team set on the class)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Spawning, meta = (ClampMin = "-1", ClampMax = "254"))
+	int32 TeamNumber = -1;
+};
+
+USTRUCT(BlueprintType)
+struct FSpawnWave
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Spawning)
+	TArray<FSpawnWaveEntry> Entries;
+
+	// Combatants spawn around actors in the level with this tag (around the player start if none are found)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Spawning)
+	FName SpawnPointTag;
+
+	// Seconds after the previous wave is cleared before this wave starts (its assets are prewarmed during the delay)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Spawning, meta = (ClampMin = "0"))
+	float DelayBeforeWave = 5.f;
+};
+
 /**
- * 
+ * Spawns waves of AI combatants under a per frame time budget (Project Settings > AI Melee Combat > Spawning),
+ * async loading each waves classes before it starts so no load or spawn work lands on a single frame
  */
 UCLASS()
 class AIMELEECOMBAT_API AAIMeleeCombatGameModeBase : public AGameModeBase
 {
 	GENERATED_BODY()
-	
+
+public:
+	AAIMeleeCombatGameModeBase();
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	// Starts loading the waves classes without spawning anything (done automatically for the next wave)
+	void PrewarmWave(int32 WaveIndex);
+
+	// Spawns the wave once its classes have loaded
+	UFUNCTION(BlueprintCallable, Category = Spawning)
+	void StartWave(int32 WaveIndex);
+
+	// Logs spawn latency & the spawn/load frame hitches of the current wave (AIMelee.Spawner.Report)
+	void LogReport() const;
+
+	FORCEINLINE int32 GetCurrentWave() const { return CurrentWave; }
+	FORCEINLINE int32 GetNumPendingSpawns() const { return PendingSpawns.Num(); }
+
+protected:
+
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+
+	void OnWaveLoaded(int32 WaveIndex);
+
+	// Called as each archetypes montages finish streaming in, spawning starts once all of them have
+	void OnWaveArchetypeLoaded(int32 WaveIndex);
+
+	// Drops the waves hold on these archetypes montages & empties the array
+	void ReleaseArchetypes(TArray<UCombatArchetype*>& Archetypes);
+
+	// Spawns (or revives from the corpse pool) one combatant, returns false if it couldn't be spawned
+	bool SpawnCombatant(UClass* CombatantClass, UCombatArchetype* Archetype, int32 TeamNumber, const FVector& Origin);
+
+	FVector PickSpawnLocation(const FVector& Origin) const;
+
+	void CheckWaveCleared();
+
+	// Waves played in order
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Spawning, meta = (AllowPrivateAccess = "true"))
+	TArray<FSpawnWave> Waves;
+
+	// Starts the first wave on BeginPlay & each next wave once the current one is cleared
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Spawning, meta = (AllowPrivateAccess = "true"))
+	bool bAutoStartWaves;
+
+	struct FPendingSpawn
+	{
+		UClass* CombatantClass = nullptr;
+		UCombatArchetype* Archetype = nullptr;
+		int32 TeamNumber = -1;
+		FVector Origin = FVector::ZeroVector;
+	};
+
+	// Combatants still to spawn in the current wave (class & archetype pointers are kept loaded by the waves streamable handle)
+	TArray<FPendingSpawn> PendingSpawns;
+
+	// Live combatants of the current wave (the wave is cleared once none of them are alive)
+	TArray<FCombatantHandle> WaveCombatants;
+
+	// Async load handles by wave index, released once the wave is cleared
+	TMap<int32, TSharedPtr<FStreamableHandle>> WaveLoadHandles;
+
+	// Archetypes of the current wave, their montages are held in UCombatAssetStreamer until the wave is cleared
+	UPROPERTY()
+	TArray<UCombatArchetype*> WaveArchetypes;
+
+	// Archetypes of the previous wave, held until the next waves montages have streamed in so shared montages aren't reloaded
+	UPROPERTY()
+	TArray<UCombatArchetype*> PreviousWaveArchetypes;
+
+	int32 NumArchetypesLoading;
+
+	int32 CurrentWave;
+
+	FTimerHandle NextWaveTimerHandle;
+	FTimerHandle WaveClearedTimerHandle;
+
+	// Spawn timings of the current wave
+	double WaveStartTime;
+	double LoadCompleteTime;
+	double TotalSpawnLatency;
+	double MaxSpawnLatency;
+	double MaxSpawnFrameMs;
+	float MaxWaveFrameMs;
+	int32 NumSpawned;
+	int32 NumRevived;
+	int32 NumSpawnFrames;
 };
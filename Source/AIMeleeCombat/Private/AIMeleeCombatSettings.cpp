@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AIMeleeCombatSettings.h"
+
+namespace
+{
+	// Row major [TeamA * MatrixSize + TeamB], only covers the teams mentioned in the settings
+	TArray<uint8> AttitudeMatrix;
+	int32 MatrixSize = 0;
+	ETeamAttitude::Type DefaultAttitude = ETeamAttitude::Hostile;
+
+	ETeamAttitude::Type DefaultTeamRule(uint8 A, uint8 B)
+	{
+		if(A == FGenericTeamId::NoTeam.GetId() || B == FGenericTeamId::NoTeam.GetId())
+		{
+			return ETeamAttitude::Neutral;
+		}
+
+		return A == B ? ETeamAttitude::Friendly : DefaultAttitude;
+	}
+}
+
+UAIMeleeCombatSettings::UAIMeleeCombatSettings() :
+	DefaultTeamAttitude(ETeamAttitude::Hostile),
+	AnimBudgetUpdateInterval(0.25f),
+	MaxInterpolatedUpdateRate(4),
+	SignificanceUpdateInterval(0.5f),
+	SignificanceMaxDistance(5000.f),
+	SignificanceDistanceWeight(0.5f),
+	SignificanceCombatWeight(0.3f),
+	SignificanceVisibilityWeight(0.2f),
+	SignificanceHysteresis(0.05f),
+	CorpseFreezeDelay(3.f),
+	CorpseBudget(16),
+	bPoolEvictedCorpses(true),
+	CorpsePoolSize(16),
+	SpawnFrameBudgetMs(2.f),
+	SpawnRadius(500.f),
+	TelegraphRadius(1000.f),
+	TelegraphConeHalfAngle(60.f),
+	TelegraphDefaultImpactDelay(0.4f),
+	BlockLeadTime(0.15f),
+	DodgeLeadTime(0.25f),
+	MaxUtilityTargets(8),
+	UtilityJobBatchSize(32),
+	AbstractCombatDistance(6000.f),
+	AbstractCombatPromoteDistance(4500.f),
+	AbstractCombatStep(0.5f),
+	TacticalRings(2),
+	TacticalRingPoints(16),
+	TacticalCacheSeconds(0.5f),
+	TacticalAllySpacing(250.f),
+	TacticalMaxTravel(500.f),
+	EncirclementMeleeSlots(8),
+	EncirclementRangedSlots(12),
+	EncirclementSwapMargin(150.f),
+	EncirclementRepathDistance(100.f),
+	ProjectileStep(1.f / 60.f),
+	ProjectileMaxSteps(4),
+	ProjectileLifetime(3.f),
+	ProjectileGridCellSize(500.f)
+{
+	CategoryName = TEXT("Game");
+
+	AnimBudgetBuckets.Add(FAnimBudgetBucket(1500.f, 1, 2));
+	AnimBudgetBuckets.Add(FAnimBudgetBucket(3000.f, 2, 4));
+	AnimBudgetBuckets.Add(FAnimBudgetBucket(6000.f, 4, 8));
+	AnimBudgetBuckets.Add(FAnimBudgetBucket(12000.f, 8, 15));
+
+	SignificanceBuckets.Add(FSignificanceBucket(0.6f, 0.5f, 0.f, 0.f, 0.f));
+	SignificanceBuckets.Add(FSignificanceBucket(0.35f, 0.75f, 0.05f, 0.25f, 0.f));
+	SignificanceBuckets.Add(FSignificanceBucket(0.15f, 1.5f, 0.2f, 0.5f, 0.1f));
+	SignificanceBuckets.Add(FSignificanceBucket(0.f, 3.f, 0.5f, 1.f, 0.25f));
+}
+
+void UAIMeleeCombatSettings::ApplyTeamAttitudes() const
+{
+	DefaultAttitude = DefaultTeamAttitude;
+
+	int32 HighestTeam = -1;
+	for (const int32 Team : NeutralTeams)
+	{
+		HighestTeam = FMath::Max(HighestTeam, Team);
+	}
+	for (const FTeamAttitudeOverride& Override : TeamAttitudeOverrides)
+	{
+		HighestTeam = FMath::Max3(HighestTeam, Override.TeamA, Override.TeamB);
+	}
+
+	MatrixSize = FMath::Clamp(HighestTeam + 1, 0, static_cast<int32>(FGenericTeamId::NoTeam.GetId()));
+	AttitudeMatrix.SetNumUninitialized(MatrixSize * MatrixSize);
+
+	for (int32 A = 0; A < MatrixSize; ++A)
+	{
+		for (int32 B = 0; B < MatrixSize; ++B)
+		{
+			ETeamAttitude::Type Attitude = DefaultTeamRule(static_cast<uint8>(A), static_cast<uint8>(B));
+			if(A != B && (NeutralTeams.Contains(A) || NeutralTeams.Contains(B)))
+			{
+				Attitude = ETeamAttitude::Neutral;
+			}
+			AttitudeMatrix[A * MatrixSize + B] = static_cast<uint8>(Attitude);
+		}
+	}
+
+	for (const FTeamAttitudeOverride& Override : TeamAttitudeOverrides)
+	{
+		if(Override.TeamA < 0 || Override.TeamA >= MatrixSize || Override.TeamB < 0 || Override.TeamB >= MatrixSize) { continue; }
+
+		AttitudeMatrix[Override.TeamA * MatrixSize + Override.TeamB] = Override.Attitude.GetValue();
+		AttitudeMatrix[Override.TeamB * MatrixSize + Override.TeamA] = Override.Attitude.GetValue();
+	}
+
+	FGenericTeamId::SetAttitudeSolver(&UAIMeleeCombatSettings::GetTeamAttitude);
+}
+
+ETeamAttitude::Type UAIMeleeCombatSettings::GetTeamAttitude(FGenericTeamId A, FGenericTeamId B)
+{
+	const uint8 TeamA = A.GetId();
+	const uint8 TeamB = B.GetId();
+
+	if(TeamA < MatrixSize && TeamB < MatrixSize)
+	{
+		return static_cast<ETeamAttitude::Type>(AttitudeMatrix[TeamA * MatrixSize + TeamB]);
+	}
+
+	return DefaultTeamRule(TeamA, TeamB);
+}
+
+#if WITH_EDITOR
+void UAIMeleeCombatSettings::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	ApplyTeamAttitudes();
+}
+#endif
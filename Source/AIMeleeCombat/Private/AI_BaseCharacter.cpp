@@ -2,6 +2,7 @@
 
 
 #include "AI_BaseCharacter.h"
+#include "AIMeleeCombat.h"
 #include "Character_AIController.h"
 #include "Navigation/PathFollowingComponent.h"
 #include "AITypes.h"
@@ -9,6 +10,7 @@
 #include "Components/SphereComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "Perception/AIPerceptionStimuliSourceComponent.h"
+#include "Perception/AIPerceptionComponent.h"
 #include "Perception/AISense_Sight.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Character_AnimInstance.h"
@@ -16,21 +18,35 @@
 #include "AI_UtilityComponent.h"
 #include "Components/SceneComponent.h"
 #include "PlayerCharacter.h"
+#include "CombatantRegistry.h"
+#include "AIMeleeCombatSettings.h"
+#include "CorpseSubsystem.h"
+#include "CombatArchetype.h"
+#include "CombatAssetStreamer.h"
+#include "CombatMovementComponent.h"
+#include "AttackTelegraphSubsystem.h"
+#include "AbstractCombatSubsystem.h"
+#include "TacticalPointSubsystem.h"
+#include "EncirclementSubsystem.h"
+#include "CombatProjectileSubsystem.h"
+#include "CombatRules.h"
+#include "UObject/ObjectSaveContext.h"
+
+static TAutoConsoleVariable<int32> CVarFacingUseMovement(
+	TEXT("AIMelee.Facing.UseMovement"),
+	1,
+	TEXT("0: AI face their enemy with a SetWorldRotation every tick, 1: facing is applied inside the character movement update"));
 
 // Sets default values
-AAI_BaseCharacter::AAI_BaseCharacter() :
-	PatrolRadius (1000.f),
+AAI_BaseCharacter::AAI_BaseCharacter(const FObjectInitializer& ObjectInitializer) :
+	Super(ObjectInitializer.SetDefaultSubobjectClass<UCombatMovementComponent>(ACharacter::CharacterMovementComponentName)),
+	Archetype(nullptr),
 	TeamNumber(0),
 	CurrentHealth (300.f),
-	MaxHealth (300.f),
-	bCanPatrol (false),
 	StrafeDirection(EStrafeDirection::ESD_NULL),
-	AttackRange (250.0f),
-	RangedAttackRange(350.0f),
 	bEnemyDetected(false),
 	bInAttackRange(false),
 	bInRangedAttackRange(false),
-	bIsAggressive(false),
 	bCanStrafe(true),
 	bCanBlock(true),
 	bCanDodge(true),
@@ -38,8 +54,29 @@ AAI_BaseCharacter::AAI_BaseCharacter() :
 	bIsBlocking(false),
 	bIsDodging(false),
 	bIsDead(false),
+	bDamageWindowActive(false),
+	bCorpseFrozen(false),
+	bAbstractCombat(false),
+#if WITH_EDITORONLY_DATA
+	PatrolRadius_DEPRECATED(1000.f),
+	MaxHealth_DEPRECATED(300.f),
+	bCanPatrol_DEPRECATED(false),
+	AttackRange_DEPRECATED(250.f),
+	RangedAttackRange_DEPRECATED(350.f),
+	bIsAggressive_DEPRECATED(false),
+	AttackMontage_DEPRECATED(nullptr),
+	RangedAttackMontage_DEPRECATED(nullptr),
+	UltimateAttackMontage_DEPRECATED(nullptr),
+	BlockingMontage_DEPRECATED(nullptr),
+	DodgingMontage_DEPRECATED(nullptr),
+	DeathMontage_DEPRECATED(nullptr),
+#endif
 	ComboIndex(0),
-	CombatState(ECombatState::ECS_Unoccupied)
+	SeekGoal(FVector::ZeroVector),
+	SignificanceBucket(0),
+	CapsuleCollision(ECollisionEnabled::QueryAndPhysics),
+	MeshCollision(ECollisionEnabled::QueryAndPhysics),
+	WeaponCollision(ECollisionEnabled::QueryAndPhysics)
 
 {
 
@@ -56,12 +93,17 @@ AAI_BaseCharacter::AAI_BaseCharacter() :
 	// Adds utility actor component to AI_BaseCharacter
 	UtilityComponent = CreateDefaultSubobject<UAI_UtilityComponent>(TEXT("Utility Component"));
 
+	CombatMovement = Cast<UCombatMovementComponent>(GetCharacterMovement());
+
 	// Changes Visibility collision channel to block on characters mesh (used for detecting raycast hits when taking damage)
 	GetMesh()->SetCollisionResponseToChannel(ECollisionChannel::ECC_Visibility, ECollisionResponse::ECR_Block);
 
 	// Required so AIPerception on the AIController detects this character
 	SetupStimulus();
 
+	CombatStateMachine.OnExit.BindUObject(this, &AAI_BaseCharacter::OnCombatStateExit);
+	CombatStateMachine.OnEnter.BindUObject(this, &AAI_BaseCharacter::OnCombatStateEnter);
+
 
 }
 
@@ -69,7 +111,12 @@ AAI_BaseCharacter::AAI_BaseCharacter() :
 void AAI_BaseCharacter::BeginPlay()
 {
 	Super::BeginPlay();
-	CurrentHealth = MaxHealth;
+	CurrentHealth = Archetype->MaxHealth;
+	BindController();
+}
+
+void AAI_BaseCharacter::BindController()
+{
 	Character_AIController = Cast<ACharacter_AIController>(GetController());
 
 	// Continues to call OnAIMoveCompleted() once current patrolling has finished & if bCanPatrol = true
@@ -80,147 +127,338 @@ void AAI_BaseCharacter::BeginPlay()
 	}
 }
 
-void AAI_BaseCharacter::Tick(float DeltaSeconds)
+void AAI_BaseCharacter::PostInitializeComponents()
 {
-	Super::Tick(DeltaSeconds);
+	Super::PostInitializeComponents();
+
+	if(!GetWorld()->IsGameWorld()) { return; }
+
+	// Before any BeginPlay so the utility component can read its behavior from the archetype
+	ResolveArchetype();
 
-	if(EnemyReference && CombatState == ECombatState::ECS_Unoccupied && bEnemyDetected)
+	// Held until EndPlay, pooled corpses keep their archetypes montages loaded for when they are revived
+	if(UCombatAssetStreamer* Streamer = UCombatAssetStreamer::Get(this))
 	{
-		RotateTowardsTarget(EnemyReference->GetActorLocation());
+		TArray<FSoftObjectPath> MontagePaths;
+		Archetype->GetMontagePaths(MontagePaths);
+		Streamer->Acquire(Archetype, MontagePaths);
 	}
 
-	if(EnemyPlayer && CombatState == ECombatState::ECS_Unoccupied && bEnemyDetected)
+	CombatantRegistry = UCombatantRegistry::Get(this);
+	if(CombatantRegistry)
 	{
-		RotateTowardsTarget(EnemyPlayer->GetActorLocation());
+		CombatantHandle = CombatantRegistry->Register(this, ECombatantKind::ECK_AI, TeamNumber);
 	}
+}
 
-	if(EnemyReference && bEnemyDetected)
+void AAI_BaseCharacter::ResolveArchetype()
+{
+	if(Archetype) { return; }
+
+#if WITH_EDITOR
+	// Unmigrated AI (PIE only, cooking refuses them) get their own stand in, AI of one class can hold different old values
+	Archetype = BuildLegacyArchetype(this, MakeUniqueObjectName(this, UCombatArchetype::StaticClass(), TEXT("LegacyArchetype")), RF_Transient);
+	UE_LOG(LogAIMeleeCombat, Warning, TEXT("%s has no combat archetype, using its old per instance values (run AIMelee.Archetype.MigrateLegacy in the editor)"), *GetName());
+#else
+	UE_LOG(LogAIMeleeCombat, Error, TEXT("%s has no combat archetype, using the default archetype"), *GetName());
+	Archetype = GetMutableDefault<UCombatArchetype>();
+#endif
+}
+
+#if WITH_EDITOR
+void AAI_BaseCharacter::PreSave(FObjectPreSaveContext ObjectSaveContext)
+{
+	Super::PreSave(ObjectSaveContext);
+
+	if(ObjectSaveContext.IsCooking() && Archetype == nullptr && !IsTemplate())
 	{
-		const float EnemyDistance = (EnemyReference->GetActorLocation() - GetActorLocation()).Length();
-		if(EnemyDistance <= AttackRange)
-		{
-			bInAttackRange = true;
-		}
-		else
-		{
-			bInAttackRange = false;
-		}
+		UE_LOG(LogAIMeleeCombat, Error, TEXT("%s has no combat archetype, run AIMelee.Archetype.MigrateLegacy on its level before cooking"), *GetPathName());
+	}
+}
 
-		if(EnemyDistance > AttackRange && EnemyDistance <= RangedAttackRange)
-		{
-			bInRangedAttackRange = true;
-		}
-		else
+UCombatArchetype* AAI_BaseCharacter::BuildLegacyArchetype(UObject* Outer, FName Name, EObjectFlags Flags) const
+{
+	UCombatArchetype* NewArchetype = NewObject<UCombatArchetype>(Outer, Name, Flags);
+	NewArchetype->AttackMontage = AttackMontage_DEPRECATED;
+	NewArchetype->RangedAttackMontage = RangedAttackMontage_DEPRECATED;
+	NewArchetype->UltimateAttackMontage = UltimateAttackMontage_DEPRECATED;
+	NewArchetype->BlockingMontage = BlockingMontage_DEPRECATED;
+	NewArchetype->DodgingMontage = DodgingMontage_DEPRECATED;
+	NewArchetype->DeathMontage = DeathMontage_DEPRECATED;
+	NewArchetype->MaxHealth = MaxHealth_DEPRECATED;
+	NewArchetype->AttackRange = AttackRange_DEPRECATED;
+	NewArchetype->RangedAttackRange = RangedAttackRange_DEPRECATED;
+	NewArchetype->bIsAggressive = bIsAggressive_DEPRECATED;
+	NewArchetype->bCanPatrol = bCanPatrol_DEPRECATED;
+	NewArchetype->PatrolRadius = PatrolRadius_DEPRECATED;
+	UtilityComponent->GetLegacyBehavior(NewArchetype->CombatBehaviorData, NewArchetype->RowName);
+	return NewArchetype;
+}
+
+bool AAI_BaseCharacter::MatchesLegacyArchetype(const UCombatArchetype& Candidate) const
+{
+	UDataTable* CombatBehaviorData = nullptr;
+	FName RowName;
+	UtilityComponent->GetLegacyBehavior(CombatBehaviorData, RowName);
+
+	return Candidate.AttackMontage == AttackMontage_DEPRECATED
+		&& Candidate.RangedAttackMontage == RangedAttackMontage_DEPRECATED
+		&& Candidate.UltimateAttackMontage == UltimateAttackMontage_DEPRECATED
+		&& Candidate.BlockingMontage == BlockingMontage_DEPRECATED
+		&& Candidate.DodgingMontage == DodgingMontage_DEPRECATED
+		&& Candidate.DeathMontage == DeathMontage_DEPRECATED
+		&& Candidate.MaxHealth == MaxHealth_DEPRECATED
+		&& Candidate.AttackRange == AttackRange_DEPRECATED
+		&& Candidate.RangedAttackRange == RangedAttackRange_DEPRECATED
+		&& Candidate.bIsAggressive == bIsAggressive_DEPRECATED
+		&& Candidate.bCanPatrol == bCanPatrol_DEPRECATED
+		&& Candidate.PatrolRadius == PatrolRadius_DEPRECATED
+		&& Candidate.CombatBehaviorData == CombatBehaviorData
+		&& Candidate.RowName == RowName;
+}
+#endif
+
+float AAI_BaseCharacter::GetPatrolRadius() const
+{
+	return Archetype ? Archetype->PatrolRadius : 0.f;
+}
+
+bool AAI_BaseCharacter::CanPatrol() const
+{
+	return Archetype && Archetype->bCanPatrol;
+}
+
+void AAI_BaseCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(Archetype && GetWorld()->IsGameWorld())
+	{
+		if(UCombatAssetStreamer* Streamer = UCombatAssetStreamer::Get(this))
 		{
-			bInRangedAttackRange = false;
+			Streamer->Release(Archetype);
 		}
 	}
 
-	if(EnemyPlayer && bEnemyDetected)
+	if(UEncirclementSubsystem* Encirclement = UEncirclementSubsystem::Get(this))
+	{
+		Encirclement->Leave(CombatantHandle);
+		Encirclement->ReleaseTarget(CombatantHandle);
+	}
+
+	if(CombatantRegistry)
+	{
+		CombatantRegistry->Unregister(CombatantHandle);
+		CombatantHandle.Reset();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AAI_BaseCharacter::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	// Player or AI target, both are handled the same way here
+	const ACharacter* Enemy = GetEnemyCharacter();
+
+	const bool bFaceEnemy = Enemy && GetCombatState() == ECombatState::ECS_Unoccupied && bEnemyDetected;
+
+	// Facing is a target for the movement component, so the capsule is only moved once per frame
+	if(CombatMovement && CVarFacingUseMovement.GetValueOnGameThread() != 0)
 	{
-		const float EnemyDistance = (EnemyPlayer->GetActorLocation() - GetActorLocation()).Length();
-		if(EnemyDistance <= AttackRange)
+		CombatMovement->SetFacingTarget(bFaceEnemy ? Enemy : nullptr);
+	}
+	else
+	{
+		if(CombatMovement)
 		{
-			bInAttackRange = true;
+			CombatMovement->SetFacingTarget(nullptr);
 		}
-		else
+		if(bFaceEnemy && RotateTowardsTarget(Enemy->GetActorLocation()))
 		{
-			bInAttackRange = false;
+			UCombatMovementComponent::CountTickFacingUpdate();
 		}
+	}
+
+	UpdateEnemyRanges();
+}
+
+void AAI_BaseCharacter::UpdateEnemyRanges()
+{
+	const ACharacter* Enemy = GetEnemyCharacter();
+	if(Enemy && bEnemyDetected)
+	{
+		const float EnemyDistance = (Enemy->GetActorLocation() - GetActorLocation()).Length();
+		const CombatCore::ERangeBand Band = CombatCore::GetRangeBand(EnemyDistance, { Archetype->AttackRange, Archetype->RangedAttackRange });
+		bInAttackRange = Band == CombatCore::ERangeBand::Melee;
+		bInRangedAttackRange = Band == CombatCore::ERangeBand::Ranged;
+	}
+}
+
+// Rejected by the state machine while an action is playing, so a move finishing can't cut an attack short
+void AAI_BaseCharacter::OnAIMoveCompleted(FAIRequestID RequestID, const FPathFollowingResult& Result)
+{
+	CombatStateMachine.Dispatch(ECombatEvent::ECE_MoveFinished);
+}
+
+// returns true if targets team number is not equal to owners team number (looked up in the combatant registry, no casting)
+bool AAI_BaseCharacter::IsEnemy(FCombatantHandle Target) const
+{
+	return CombatantRegistry && CombatantRegistry->AreEnemies(CombatantHandle, Target);
+}
+
+void AAI_BaseCharacter::ApplySignificance(int32 BucketIndex, const FSignificanceBucket& Bucket)
+{
+	SignificanceBucket = BucketIndex;
+
+	SetActorTickInterval(Bucket.ActorTickInterval);
+	GetCharacterMovement()->SetComponentTickInterval(Bucket.MovementTickInterval);
+	UtilityComponent->SetThinkInterval(Bucket.ThinkInterval);
+
+	if(Character_AIController)
+	{
+		Character_AIController->SetPerceptionInterval(Bucket.PerceptionInterval);
+	}
+}
 
-		if(EnemyDistance > AttackRange && EnemyDistance <= RangedAttackRange)
+void AAI_BaseCharacter::SetAbstractCombat(bool bAbstract)
+{
+	if(bAbstractCombat == bAbstract) { return; }
+
+	bAbstractCombat = bAbstract;
+
+	SetActorTickEnabled(!bAbstract);
+	GetMesh()->SetComponentTickEnabled(!bAbstract);
+	Weapon->SetComponentTickEnabled(!bAbstract);
+	GetCharacterMovement()->SetComponentTickEnabled(!bAbstract);
+
+	if(bAbstract)
+	{
+		UtilityComponent->StopThinking();
+		GetCharacterMovement()->StopMovementImmediately();
+		if(Character_AIController)
 		{
-			bInRangedAttackRange = true;
+			Character_AIController->StopMovement();
 		}
-		else
+		if(CombatMovement)
 		{
-			bInRangedAttackRange = false;
+			CombatMovement->SetFacingTarget(nullptr);
 		}
 	}
+	else if(!bIsDead)
+	{
+		UtilityComponent->StartThinking();
+	}
 }
 
-void AAI_BaseCharacter::OnAIMoveCompleted(FAIRequestID RequestID, const FPathFollowingResult& Result)
+FGenericTeamId AAI_BaseCharacter::GetGenericTeamId() const
 {
-	SetUnoccupied();
+	return FGenericTeamId(static_cast<uint8>(FMath::Clamp(TeamNumber, 0, 255)));
 }
 
-// returns true if targets team number is not equal to owners team number
-bool AAI_BaseCharacter::IsEnemy(AActor* Target)
+void AAI_BaseCharacter::SetGenericTeamId(const FGenericTeamId& NewTeamID)
 {
-	if(Target->GetInstigatorController()->IsPlayerController())
+	TeamNumber = NewTeamID.GetId();
+
+	if(CombatantRegistry)
 	{
-		EnemyPlayer = Cast<APlayerCharacter>(Target);
-		if(EnemyPlayer && EnemyPlayer->GetTeamNumber() != TeamNumber)
-		{
-			EnemyReference = nullptr;
-			return true;
-		}
+		CombatantRegistry->SetTeam(CombatantHandle, TeamNumber);
 	}
-	else
+
+	// The perception system caches the listeners team, so a team change has to refresh it or the AI keep seeing old enemies
+	if(Character_AIController && Character_AIController->GetPerceptionComponent())
+	{
+		Character_AIController->GetPerceptionComponent()->RequestStimuliListenerUpdate();
+	}
+}
+
+void AAI_BaseCharacter::SetEnemy(FCombatantHandle Target)
+{
+	// The slot around the old target is freed straight away rather than on the next seek
+	if(Target != EnemyHandle)
 	{
-		EnemyReference = Cast<AAI_BaseCharacter>(Target);
-		if(EnemyReference && EnemyReference->TeamNumber != TeamNumber)
+		if(UEncirclementSubsystem* Encirclement = UEncirclementSubsystem::Get(this))
 		{
-			EnemyPlayer = nullptr;
-			return true;
+			Encirclement->Leave(CombatantHandle);
 		}
 	}
 
-	return false;
+	EnemyHandle = Target;
+}
+
+AAI_BaseCharacter* AAI_BaseCharacter::GetEnemy() const
+{
+	return CombatantRegistry ? CombatantRegistry->GetAICharacter(EnemyHandle) : nullptr;
+}
+
+APlayerCharacter* AAI_BaseCharacter::GetEnemyPlayer() const
+{
+	return CombatantRegistry ? CombatantRegistry->GetPlayerCharacter(EnemyHandle) : nullptr;
+}
+
+ACharacter* AAI_BaseCharacter::GetEnemyCharacter() const
+{
+	return CombatantRegistry ? CombatantRegistry->GetCharacter(EnemyHandle) : nullptr;
 }
 
 // When ApplyDamage() is called in DealDamage(), TakeDamage() is called on the character receiving the damage
 float AAI_BaseCharacter::TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator,
 	AActor* DamageCauser)
 {
-	if(CurrentHealth - DamageAmount <= 0.f)
+	// Full simulation AI vs AI hits are what the abstract combat model is validated against (attacker resolved through the registry, player hits come back null)
+	const AAI_BaseCharacter* Attacker = (CombatantRegistry && !bAbstractCombat && !bIsDead) ? CombatantRegistry->GetAICharacter(CombatantRegistry->FindHandle(DamageCauser)) : nullptr;
+	const bool bRecordHit = Attacker && !Attacker->IsAbstractCombat();
+	const float IncomingDamage = DamageAmount;
+
+	// Blocking halves the damage & dodging avoids it (see CombatCore::ResolveDamage)
+	CombatCore::FDefenderState Defender;
+	Defender.Health = CurrentHealth;
+	Defender.bBlocking = bIsBlocking;
+	Defender.bDodging = bIsDodging;
+	const CombatCore::FDamageResult Result = CombatCore::ResolveDamage(Defender, DamageAmount);
+
+	CurrentHealth = Result.Health;
+	if(Result.bKilled)
 	{
-		// Dead
-		CurrentHealth = 0;
 		Death();
 	}
-	else
-	{
-		// Attack does half damage if character is currently blocking
-		if(bIsBlocking)
-		{
-			DamageAmount *= 0.5f;
-			
-		}
 
-		// Character avoids taking damage if they are dodging
-		if(bIsDodging)
+	if(bRecordHit)
+	{
+		if(UAbstractCombatSubsystem* AbstractCombat = UAbstractCombatSubsystem::Get(this))
 		{
-			DamageAmount = 0;
+			AbstractCombat->RecordFullSimHit(Attacker->GetArchetype(), Archetype, IncomingDamage, Result.Outcome, bIsDead);
 		}
-
-		CurrentHealth -= DamageAmount;
 	}
 
-	return Super::TakeDamage(DamageAmount, DamageEvent, EventInstigator, DamageCauser);
+	return Super::TakeDamage(Result.Damage, DamageEvent, EventInstigator, DamageCauser);
 }
 
 // Character moves towards target enemy until it is within attacking range (if the character is aggressive)
 void AAI_BaseCharacter::SeekEnemy(AActor* Enemy)
 {
-	if(CombatState != ECombatState::ECS_Unoccupied) { return; }
+	if(GetCombatState() != ECombatState::ECS_Unoccupied) { return; }
 
 	if(Character_AIController)
 	{
-		if(EnemyReference)
-		{
-			if(bIsAggressive)
-			{
-				Character_AIController->MoveToLocation(EnemyReference->GetActorLocation(), 200, true);
-				SetUnoccupied();
-			}
-		}
-
-		if(EnemyPlayer)
+		if(const ACharacter* EnemyCharacter = GetEnemyCharacter())
 		{
-			if(bIsAggressive)
+			if(Archetype->bIsAggressive)
 			{
-				Character_AIController->MoveToLocation(EnemyPlayer->GetActorLocation(), 200, true);
+				// Each AI heads for its own slot around the target, the targets location only while its ring is full
+				FVector Goal = EnemyCharacter->GetActorLocation();
+				float AcceptanceRadius = 200.f;
+				UEncirclementSubsystem* Encirclement = UEncirclementSubsystem::Get(this);
+				if(Encirclement && Encirclement->GetSlotGoal(this, Goal))
+				{
+					AcceptanceRadius = 50.f;
+				}
+
+				const float RepathDistance = GetDefault<UAIMeleeCombatSettings>()->EncirclementRepathDistance;
+				if(Character_AIController->GetMoveStatus() != EPathFollowingStatus::Moving || FVector::DistSquared2D(Goal, SeekGoal) > FMath::Square(RepathDistance))
+				{
+					SeekGoal = Goal;
+					Character_AIController->MoveToLocation(Goal, AcceptanceRadius, true);
+				}
 				SetUnoccupied();
 			}
 		}
@@ -238,14 +476,10 @@ void AAI_BaseCharacter::SetupStimulus()
 // Called from AI_UtilityComponent class (ComboIndex given a random integer so the switch chooses a random Attack for the AI to perform)
 void AAI_BaseCharacter::AttackCombo()
 {
-	if(CombatState != ECombatState::ECS_Unoccupied) { return; }
-
-	if(bInAttackRange)
+	if(bInAttackRange && CombatStateMachine.Dispatch(ECombatEvent::ECE_Attack))
 	{
-		CombatState = ECombatState::ECS_Attacking;
-		bAttacking = true;
-		UAnimMontage* Attack = AttackMontage;
-		ComboIndex = UKismetMathLibrary::RandomIntegerInRange(0, 3);
+		UAnimMontage* Attack = Archetype->AttackMontage.Get();
+		ComboIndex = CombatCore::PickAttackSection(FMath::FRand());
 
 		if(Attack)
 		{
@@ -269,6 +503,11 @@ void AAI_BaseCharacter::AttackCombo()
 				break;
 			}
 			SetMontageToPlay(Attack, SectionName);
+			TelegraphAttack(Attack, SectionName);
+		}
+		else
+		{
+			SetUnoccupied();
 		}
 	}
 }
@@ -276,44 +515,74 @@ void AAI_BaseCharacter::AttackCombo()
 // Called from AI_UtilityComponent class on ChooseBestAbility()
 void AAI_BaseCharacter::RangedAttack()
 {
-	if(CombatState != ECombatState::ECS_Unoccupied) { return; }
+	// Without the montage (not streamed in yet or unset) there is no attack to fire from, so nothing is launched
+	UAnimMontage* Montage = Archetype->RangedAttackMontage.Get();
+	if(Montage == nullptr || !CombatStateMachine.Dispatch(ECombatEvent::ECE_Attack)) { return; }
+
+	SetMontageToPlay(Montage, "Default");
+	TelegraphAttack(Montage, "Default");
+
+	// Montages with a damage window fire as it opens (BeginDamageWindow)
+	UCombatAssetStreamer* Streamer = UCombatAssetStreamer::Get(this);
+	if(Streamer == nullptr || Streamer->FindDamageWindow(Montage, "Default") == nullptr)
+	{
+		LaunchProjectile();
+	}
+}
+
+void AAI_BaseCharacter::LaunchProjectile()
+{
+	const ACharacter* Enemy = GetEnemyCharacter();
+	UCombatProjectileSubsystem* Projectiles = UCombatProjectileSubsystem::Get(this);
+	if(Enemy == nullptr || Projectiles == nullptr || Archetype->ProjectileSpeed <= 0.f) { return; }
+
+	const FVector Origin = TraceStart ? TraceStart->GetComponentLocation() : GetActorLocation();
+	const float FlightTime = FVector::Dist(Origin, Enemy->GetActorLocation()) / Archetype->ProjectileSpeed;
+	const FVector AimLocation = Enemy->GetActorLocation() + Enemy->GetVelocity() * FlightTime;
 
-	CombatState = ECombatState::ECS_Attacking;
-	bAttacking = true;
-	SetMontageToPlay(RangedAttackMontage, "Default");
+	Projectiles->Launch(CombatantHandle, Origin, (AimLocation - Origin).GetSafeNormal() * Archetype->ProjectileSpeed,
+		Archetype->ProjectileDamage, Archetype->ProjectileRadius, Archetype->ProjectileGravityScale);
 }
 
 // Called from AI_UtilityComponent class on ChooseBestAbility()
 void AAI_BaseCharacter::UltimateAttack()
 {
-	if(CombatState != ECombatState::ECS_Unoccupied) { return; }
+	if(!CombatStateMachine.Dispatch(ECombatEvent::ECE_Attack)) { return; }
 
-	CombatState = ECombatState::ECS_Attacking;
-	bAttacking = true;
-	SetMontageToPlay(UltimateAttackMontage, "Default");
+	UAnimMontage* Montage = Archetype->UltimateAttackMontage.Get();
+	SetMontageToPlay(Montage, "Default");
+	TelegraphAttack(Montage, "Default");
+}
+
+void AAI_BaseCharacter::TelegraphAttack(const UAnimMontage* Montage, FName Section) const
+{
+	if(Montage == nullptr) { return; }
+
+	if(UAttackTelegraphSubsystem* Telegraphs = UAttackTelegraphSubsystem::Get(this))
+	{
+		Telegraphs->BroadcastAttack(this, CombatantHandle, Montage, Section);
+	}
 }
 
 void AAI_BaseCharacter::Blocking()
 {
-	if(CombatState != ECombatState::ECS_Unoccupied) { return; }
+	if(!CombatStateMachine.Dispatch(ECombatEvent::ECE_Block)) { return; }
 
-	bIsBlocking = true;
-	CombatState = ECombatState::ECS_Blocking;
-	SetMontageToPlay(BlockingMontage, "Default");
+	SetMontageToPlay(Archetype->BlockingMontage.Get(), "Default");
 
 	bCanBlock = false;
-	GetWorld()->GetTimerManager().SetTimer(BlockCooldownHandle, this, &AAI_BaseCharacter::BlockOffCooldown, UKismetMathLibrary::RandomFloatInRange(4, 6), false);
+	GetWorld()->GetTimerManager().SetTimer(BlockCooldownHandle, this, &AAI_BaseCharacter::BlockOffCooldown, CombatCore::RollCooldown(CombatCore::BlockCooldown, FMath::FRand()), false);
 }
 
 void AAI_BaseCharacter::Dodging()
 {
-	if(CombatState != ECombatState::ECS_Unoccupied) { return; }
+	if(!CombatStateMachine.CanDispatch(ECombatEvent::ECE_Dodge)) { return; }
 
 	const int32 DodgeIndex = UKismetMathLibrary::RandomIntegerInRange(0, 1);
-	if(DodgingMontage)
+	if(Archetype->DodgingMontage.Get())
 	{
 		FName SectionName;
-		switch (ComboIndex)
+		switch (DodgeIndex)
 		{
 		case 0:
 			SectionName = "DodgeLeft";
@@ -325,19 +594,25 @@ void AAI_BaseCharacter::Dodging()
 			break;
 		}
 
-		bIsDodging = true;
-		CombatState = ECombatState::ECS_Dodging;
-		SetMontageToPlay(DodgingMontage, SectionName);
+		CombatStateMachine.Dispatch(ECombatEvent::ECE_Dodge);
+		SetMontageToPlay(Archetype->DodgingMontage.Get(), SectionName);
 	}
 
 	bCanDodge = false;
-	GetWorld()->GetTimerManager().SetTimer(BlockCooldownHandle, this, &AAI_BaseCharacter::DodgeOffCooldown, UKismetMathLibrary::RandomFloatInRange(4, 6), false);
+	GetWorld()->GetTimerManager().SetTimer(DodgeCooldownHandle, this, &AAI_BaseCharacter::DodgeOffCooldown, CombatCore::RollCooldown(CombatCore::DodgeCooldown, FMath::FRand()), false);
 	
 }
 
 // Called any time we want to perform an animation montage (takes in the montage to perform & montage section as parameters, to know which montage to play) 
 void AAI_BaseCharacter::SetMontageToPlay(UAnimMontage* Montage, FName Section)
 {
+	// Montage hasn't streamed in yet (or isn't set on the archetype), nothing will end the action so free the AI again straight away
+	if(Montage == nullptr)
+	{
+		SetUnoccupied();
+		return;
+	}
+
 	UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
 	AnimInstance->Montage_Play(Montage);
 	AnimInstance->Montage_JumpToSection(Section);
@@ -346,69 +621,114 @@ void AAI_BaseCharacter::SetMontageToPlay(UAnimMontage* Montage, FName Section)
 // Called after an action is finished (also called in Anim Notify at the end of Montages)
 void AAI_BaseCharacter::SetUnoccupied()
 {
-	// Reset Attack & CombatState
-	ComboIndex = 0;
-	bAttacking = false;
-	bIsBlocking = false;
-	bIsDodging = false;
+	// Pauses anims at the end of the death montage so they don't get back up before the corpse is frozen
+	if(GetCombatState() == ECombatState::ECS_Dead)
+	{
+		GetMesh()->bPauseAnims = true;
+		return;
+	}
 
-	StrafeDirection = EStrafeDirection::ESD_NULL;
+	CombatStateMachine.Dispatch(ECombatEvent::ECE_ActionFinished);
+}
 
-	if(!GetCharacterMovement()->bOrientRotationToMovement)
+void AAI_BaseCharacter::OnCombatStateExit(ECombatState State)
+{
+	switch (State)
 	{
-		GetCharacterMovement()->bOrientRotationToMovement = true;
+	case ECombatState::ECS_Attacking:
+		ComboIndex = 0;
+		bAttacking = false;
+		break;
+	case ECombatState::ECS_Blocking:
+		bIsBlocking = false;
+		break;
+	case ECombatState::ECS_Dodging:
+		bIsDodging = false;
+		break;
+	default:
+		break;
 	}
+}
 
-	// Clears enemy target if current enemy dies
-	if(EnemyReference)
+void AAI_BaseCharacter::OnCombatStateEnter(ECombatState State)
+{
+	switch (State)
 	{
-		if(EnemyReference->IsDead())
+	case ECombatState::ECS_Attacking:
+		bAttacking = true;
+		break;
+	case ECombatState::ECS_Blocking:
+		bIsBlocking = true;
+		break;
+	case ECombatState::ECS_Dodging:
+		bIsDodging = true;
+		break;
+	case ECombatState::ECS_Unoccupied:
+		StrafeDirection = EStrafeDirection::ESD_NULL;
+
+		if(!GetCharacterMovement()->bOrientRotationToMovement)
 		{
-			EnemyReference = nullptr;
-			bEnemyDetected = false;
+			GetCharacterMovement()->bOrientRotationToMovement = true;
 		}
-	}
 
-	// Clears player target when player dies
-	if(EnemyPlayer)
-	{
-		if(EnemyPlayer->IsDead())
+		// Clears enemy target when the current enemy (player or AI) dies or is removed from the world
+		if(EnemyHandle.IsValid() && (CombatantRegistry == nullptr || !CombatantRegistry->IsAlive(EnemyHandle)))
 		{
-			EnemyPlayer = nullptr;
-			bEnemyDetected = false;
+			SetEnemy(FCombatantHandle());
 		}
-	}
-
-	if(EnemyPlayer != nullptr || EnemyReference != nullptr)
-	{
-		bEnemyDetected = true;
-	}
-
-	// Clears enemy target after death & pauses anims so they don't get back up after death montage
-	if(bIsDead && CombatState == ECombatState::ECS_Dead)
-	{
-		EnemyReference = nullptr;
-		EnemyPlayer = nullptr;
+		bEnemyDetected = EnemyHandle.IsValid();
+		break;
+	case ECombatState::ECS_Dead:
+		EnemyHandle.Reset();
 		bEnemyDetected = false;
-		GetMesh()->bPauseAnims = true;
-	}
-	else
-	{
-		CombatState = ECombatState::ECS_Unoccupied;
+		// Tick is off for corpses, so Tick won't clear it
+		if(CombatMovement)
+		{
+			CombatMovement->SetFacingTarget(nullptr);
+		}
+		break;
+	default:
+		break;
 	}
 }
 
-
-void AAI_BaseCharacter::RotateTowardsTarget(FVector Target)
+bool AAI_BaseCharacter::RotateTowardsTarget(FVector Target)
 {
 	const FVector WorldLocation = GetCapsuleComponent()->GetComponentLocation();
 	const FRotator WorldRotation = GetCapsuleComponent()->GetComponentRotation();
+	if((Target - WorldLocation).IsNearlyZero()) { return false; }
 
 	const FRotator LookAtRotation = UKismetMathLibrary::FindLookAtRotation(WorldLocation, Target);
 
 	double LerpValue = UKismetMathLibrary::Lerp(WorldRotation.Yaw, LookAtRotation.Yaw, 1);
 	const FRotator Rotation = UKismetMathLibrary::MakeRotator(WorldRotation.Roll, WorldRotation.Pitch, LerpValue);
+
+	// Same skip as UCombatMovementComponent::PhysicsRotation, so both paths count the same updates
+	if(WorldRotation.Equals(Rotation, UCombatMovementComponent::FacingTolerance)) { return false; }
+
 	GetCapsuleComponent()->SetWorldRotation(Rotation);
+	return true;
+}
+
+float AAI_BaseCharacter::GetHealthFraction() const
+{
+	return Archetype && Archetype->MaxHealth > 0.f ? FMath::Clamp(CurrentHealth / Archetype->MaxHealth, 0.f, 1.f) : 0.f;
+}
+
+// GetTimerRemaining returns -1 for timers that aren't running
+float AAI_BaseCharacter::GetStrafeCooldownRemaining() const
+{
+	return bCanStrafe ? 0.f : FMath::Max(GetWorldTimerManager().GetTimerRemaining(StrafeCooldownHandle), 0.f);
+}
+
+float AAI_BaseCharacter::GetBlockCooldownRemaining() const
+{
+	return bCanBlock ? 0.f : FMath::Max(GetWorldTimerManager().GetTimerRemaining(BlockCooldownHandle), 0.f);
+}
+
+float AAI_BaseCharacter::GetDodgeCooldownRemaining() const
+{
+	return bCanDodge ? 0.f : FMath::Max(GetWorldTimerManager().GetTimerRemaining(DodgeCooldownHandle), 0.f);
 }
 
 void AAI_BaseCharacter::StrafeOffCooldown()
@@ -443,7 +763,7 @@ void AAI_BaseCharacter::DamageDetectTrace()
 	bool bHit = UKismetSystemLibrary::SphereTraceSingle(GetWorld(), StartLocation, EndLocation, 20.f, TraceParams, false, ActorsToIgnore, EDrawDebugTrace::None, Hit, true, FColor::Blue, FColor::Green, 2.0f);
 	if(bHit)
 	{
-		if(EnemyReference)
+		if(EnemyHandle.IsValid())
 		{
 			AActor* ActorHit;
 			ActorHit = Hit.GetActor();
@@ -453,35 +773,64 @@ void AAI_BaseCharacter::DamageDetectTrace()
 				DamageEnemy(ActorHit);
 			}
 		}
+	}
+}
 
-		if(EnemyPlayer)
-		{
-			AActor* ActorHit;
-			ActorHit = Hit.GetActor();
-			if(AlreadyDamagedActors.Contains(ActorHit) == false)
-			{
-				AlreadyDamagedActors.AddUnique(ActorHit);
-				DamageEnemy(ActorHit);
-			}
-		}
+void AAI_BaseCharacter::BeginDamageWindow()
+{
+	// Ranged attacks fire a projectile instead of tracing the weapon
+	const UAnimMontage* RangedMontage = Archetype->RangedAttackMontage.Get();
+	if(RangedMontage && GetCurrentMontage() == RangedMontage)
+	{
+		LaunchProjectile();
+		return;
 	}
+
+	bDamageWindowActive = true;
+	AlreadyDamagedActors.Reset();
+}
+
+void AAI_BaseCharacter::TickDamageWindow()
+{
+	if(!bDamageWindowActive) { return; }
+
+	DamageDetectTrace();
+}
+
+// Clears damaged actors so the next attack can damage them again
+void AAI_BaseCharacter::EndDamageWindow()
+{
+	bDamageWindowActive = false;
+	AlreadyDamagedActors.Reset();
+}
+
+// AI pick a random attack section every time AttackCombo() is called, so there is no combo to advance
+void AAI_BaseCharacter::AdvanceCombo()
+{
+}
+
+void AAI_BaseCharacter::EndAction()
+{
+	SetUnoccupied();
 }
 
 void AAI_BaseCharacter::DamageEnemy(AActor* Enemy)
 {
-	constexpr float Damage = 20.0f;
-	UGameplayStatics::ApplyDamage(Enemy, Damage, GetInstigatorController(), this, UDamageType::StaticClass());
+	UGameplayStatics::ApplyDamage(Enemy, CombatCore::MeleeHitDamage, GetInstigatorController(), this, UDamageType::StaticClass());
 }
 
 void AAI_BaseCharacter::Death()
 {
 	if(bIsDead) { return; }
 
+	// Killed in an abstract fight, the death montage still plays
+	SetAbstractCombat(false);
+
 	UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
 	AnimInstance->StopAllMontages(0.1f);
 
 	const int32 DeathIndex = UKismetMathLibrary::RandomIntegerInRange(0, 1);
-	if(DeathMontage)
+	if(Archetype->DeathMontage.Get())
 	{
 		FName SectionName;
 		switch (DeathIndex)
@@ -496,23 +845,171 @@ void AAI_BaseCharacter::Death()
 			break;
 		}
 
-		SetMontageToPlay(DeathMontage, SectionName);
+		SetMontageToPlay(Archetype->DeathMontage.Get(), SectionName);
 	}
 
 	bIsDead = true;
-	CombatState = ECombatState::ECS_Dead;
-	Character_AIController->StopMovement();
+	CombatStateMachine.Dispatch(ECombatEvent::ECE_Died);
+
+	BeginCorpse();
+}
+
+void AAI_BaseCharacter::BeginCorpse()
+{
+	// Its own slot & the rings of the AI surrounding it
+	if(UEncirclementSubsystem* Encirclement = UEncirclementSubsystem::Get(this))
+	{
+		Encirclement->Leave(CombatantHandle);
+		Encirclement->ReleaseTarget(CombatantHandle);
+	}
+
+	// Anyone still targeting this AI drops it on their next SetUnoccupied (the handle no longer resolves)
+	if(CombatantRegistry)
+	{
+		CombatantRegistry->Unregister(CombatantHandle);
+		CombatantHandle.Reset();
+	}
+	Stimulus->UnregisterFromPerceptionSystem();
+
+	EnemyHandle.Reset();
+	bEnemyDetected = false;
+	bDamageWindowActive = false;
+	AlreadyDamagedActors.Reset();
+
+	UtilityComponent->StopThinking();
+	GetWorldTimerManager().ClearAllTimersForObject(this);
+	SetActorTickEnabled(false);
+
+	// The controller is destroyed by the detach (AI controllers have no player state), keep falling until the pose is frozen
+	if(Character_AIController)
+	{
+		Character_AIController->GetPathFollowingComponent()->OnRequestFinished.RemoveAll(this);
+		Character_AIController->StopMovement();
+		Character_AIController = nullptr;
+	}
+	DetachFromControllerPendingDestroy();
+	GetCharacterMovement()->bRunPhysicsWithNoController = true;
+
+	const float FreezeDelay = GetDefault<UAIMeleeCombatSettings>()->CorpseFreezeDelay;
+	if(FreezeDelay > 0.f)
+	{
+		GetWorldTimerManager().SetTimer(CorpseFreezeHandle, this, &AAI_BaseCharacter::FreezeCorpse, FreezeDelay, false);
+	}
+	else
+	{
+		FreezeCorpse();
+	}
+
+	if(UCorpseSubsystem* CorpseSubsystem = UCorpseSubsystem::Get(this))
+	{
+		CorpseSubsystem->AddCorpse(this);
+	}
+}
+
+void AAI_BaseCharacter::FreezeCorpse()
+{
+	if(bCorpseFrozen) { return; }
+
+	bCorpseFrozen = true;
+	GetWorldTimerManager().ClearTimer(CorpseFreezeHandle);
+
+	// Holds the last evaluated pose without updating the anim graph or the bone transforms again
+	GetMesh()->bPauseAnims = true;
+	GetMesh()->bNoSkeletonUpdate = true;
+	GetMesh()->SetComponentTickEnabled(false);
+	Weapon->SetComponentTickEnabled(false);
+
+	GetCharacterMovement()->StopMovementImmediately();
+	GetCharacterMovement()->bRunPhysicsWithNoController = false;
+	GetCharacterMovement()->SetComponentTickEnabled(false);
+
+	CapsuleCollision = GetCapsuleComponent()->GetCollisionEnabled();
+	MeshCollision = GetMesh()->GetCollisionEnabled();
+	WeaponCollision = Weapon->GetCollisionEnabled();
+	GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	GetMesh()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Weapon->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+}
+
+void AAI_BaseCharacter::ReviveFromPool(const FTransform& SpawnTransform)
+{
+	GetWorldTimerManager().ClearAllTimersForObject(this);
+
+	if(bCorpseFrozen)
+	{
+		bCorpseFrozen = false;
+
+		GetCapsuleComponent()->SetCollisionEnabled(CapsuleCollision);
+		GetMesh()->SetCollisionEnabled(MeshCollision);
+		Weapon->SetCollisionEnabled(WeaponCollision);
+	}
+
+	SetActorTransform(SpawnTransform, false, nullptr, ETeleportType::ResetPhysics);
+	SetActorHiddenInGame(false);
+
+	GetMesh()->bNoSkeletonUpdate = false;
+	GetMesh()->bPauseAnims = false;
+	GetMesh()->SetComponentTickEnabled(true);
+	Weapon->SetComponentTickEnabled(true);
+	if(UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance())
+	{
+		AnimInstance->StopAllMontages(0.f);
+	}
+
+	GetCharacterMovement()->bRunPhysicsWithNoController = false;
+	GetCharacterMovement()->SetComponentTickEnabled(true);
+	GetCharacterMovement()->SetMovementMode(MOVE_Walking);
+	SetActorTickEnabled(true);
+
+	CurrentHealth = Archetype->MaxHealth;
+	bIsDead = false;
+	bCanStrafe = true;
+	bCanBlock = true;
+	bCanDodge = true;
+	bInAttackRange = false;
+	bInRangedAttackRange = false;
+	ComboIndex = 0;
+
+	if(CombatantRegistry)
+	{
+		CombatantHandle = CombatantRegistry->Register(this, ECombatantKind::ECK_AI, TeamNumber);
+	}
+	Stimulus->RegisterWithPerceptionSystem();
+
+	SpawnDefaultController();
+	BindController();
+
+	// Back to Unoccupied, which restarts the utility component
+	CombatStateMachine.Dispatch(ECombatEvent::ECE_Revived);
 }
 
 void AAI_BaseCharacter::StrafeAroundEnemy()
 {
-	if(CombatState != ECombatState::ECS_Unoccupied) { return; }
+	if(GetCombatState() != ECombatState::ECS_Unoccupied) { return; }
 
 	if(GetCharacterMovement()->bOrientRotationToMovement)
 	{
 		GetCharacterMovement()->bOrientRotationToMovement = false;
 	}
 
+	// Character unable to strafe again until StrafeOffCooldown is called (will be called after 8-10 seconds)
+	GetWorld()->GetTimerManager().SetTimer(StrafeCooldownHandle, this, &AAI_BaseCharacter::StrafeOffCooldown, CombatCore::RollCooldown(CombatCore::StrafeCooldown, FMath::FRand()), false);
+	bCanStrafe = false;
+
+	// Navigable spot spaced from allies, in ranged attack spacing for archetypes with a ranged attack & close in for the rest
+	UTacticalPointSubsystem* TacticalPoints = UTacticalPointSubsystem::Get(this);
+	const bool bRangedSpacing = Archetype->HasRangedAttack();
+	const float MinDistance = bRangedSpacing ? Archetype->AttackRange : Archetype->AttackRange * 0.5f;
+	const float MaxDistance = bRangedSpacing ? Archetype->RangedAttackRange : Archetype->AttackRange;
+	FVector TacticalPoint;
+	if(Character_AIController && TacticalPoints && TacticalPoints->FindPoint(this, MinDistance, MaxDistance, TacticalPoint))
+	{
+		Character_AIController->MoveToLocation(TacticalPoint, 0, true);
+		SetUnoccupied();
+		return;
+	}
+
+	// No navmesh or no free spot, falls back to a random direction
 	if(StrafeDirection == EStrafeDirection::ESD_NULL)
 	{
 		const float Value = UKismetMathLibrary::RandomFloatInRange(0,1);
@@ -556,10 +1053,6 @@ void AAI_BaseCharacter::StrafeAroundEnemy()
 
 	Character_AIController->MoveToLocation(StrafeDestination, 0, true);
 
-	// Character unable to strafe again until StrafeOffCooldown is called (will be called after 8-10 seconds)
-	GetWorld()->GetTimerManager().SetTimer(StrafeCooldownHandle, this, &AAI_BaseCharacter::StrafeOffCooldown, UKismetMathLibrary::RandomFloatInRange(8, 10), false);
-	bCanStrafe = false;
-
 	SetUnoccupied();
 }
 
@@ -3,15 +3,73 @@
 
 #include "AI_UtilityComponent.h"
 #include "AI_BaseCharacter.h"
+#include "AIMeleeCombat.h"
+#include "CombatArchetype.h"
+#include "AttackTelegraphSubsystem.h"
+#include "AIMeleeCombatSettings.h"
 #include "PlayerCharacter.h"
+#include "Character_AIController.h"
+#include "CombatSnapshotSubsystem.h"
+#include "CombatPlannerSubsystem.h"
+#include "CombatPolicySubsystem.h"
+#include "CombatRules.h"
 #include "Kismet/KismetMathLibrary.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Utility Pairs Evaluated"), STAT_UtilityPairsEvaluated, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Utility Evaluations"), STAT_UtilityEvaluations, STATGROUP_AIMeleeCombat);
+DECLARE_CYCLE_STAT(TEXT("Utility Score Targets"), STAT_UtilityScoreTargets, STATGROUP_AIMeleeCombat);
+
+static TAutoConsoleVariable<int32> CVarUtilityPrune(
+	TEXT("AIMelee.Utility.Prune"),
+	1,
+	TEXT("0: every ability is scored against every target, 1: (ability, target) pairs that can't beat the abilities best score are skipped"));
+
+static FAutoConsoleCommandWithWorld UtilityBenchmarkCommand(
+	TEXT("AIMelee.Utility.Benchmark"),
+	TEXT("Scores one AI against 1, 8 & 32 generated targets with & without pruning & logs the pairs evaluated & time per evaluation"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&UAI_UtilityComponent::RunScoringBenchmark));
+
+namespace
+{
+	// Same bands the AI uses for its current target in AAI_BaseCharacter::UpdateEnemyRanges
+	CombatCore::ERangeBand GetRangeBand(const FUtilityAgentState& Agent, const FUtilityTarget& Target)
+	{
+		return CombatCore::GetRangeBand(Target.Distance, Agent.Ranges);
+	}
+
+	CombatCore::FBehaviorValues MakeBehaviorValues(const FCombatBehavior& Behavior)
+	{
+		CombatCore::FBehaviorValues Values;
+		Values.Attack = Behavior.AttackValue;
+		Values.Block = Behavior.BlockValue;
+		Values.Dodge = Behavior.DodgeValue;
+		Values.RangedAttack = Behavior.RangedAttackValue;
+		Values.UltimateAttack = Behavior.UltimateAttackValue;
+		return Values;
+	}
+}
+
+static_assert(UAI_UtilityComponent::NumAbilities == static_cast<int32>(EUtilityAbility::EUA_MAX), "Ability indices must match EUtilityAbility");
+static_assert(static_cast<int32>(CombatCore::EAbility::Count) == static_cast<int32>(EUtilityAbility::EUA_MAX), "Combat core abilities must match EUtilityAbility");
 
 // Sets default values for this component's properties
-UAI_UtilityComponent::UAI_UtilityComponent()
+UAI_UtilityComponent::UAI_UtilityComponent() :
+	S_CombatBehavior(nullptr),
+#if WITH_EDITORONLY_DATA
+	CombatBehaviorData_DEPRECATED(nullptr),
+#endif
+	LastPairsEvaluated(0),
+	ThinkInterval(0.5f),
+	IncomingImpactEndTime(-1.f),
+	ScheduledDefenseIndex(INDEX_NONE),
+	ScheduledImpactTime(0.f),
+	PlanStep(0),
+	bPlanStepStarted(false)
 {
-	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
-	// off to improve performance if you don't need them.
-	PrimaryComponentTick.bCanEverTick = true;
+	// Scoring is driven by UpdateScoreTimer, so the component never needs to tick
+	PrimaryComponentTick.bCanEverTick = false;
 }
 
 
@@ -27,73 +85,184 @@ void UAI_UtilityComponent::BeginPlay()
 
 void UAI_UtilityComponent::InitialiseBehavior()
 {
-	if(CombatBehaviorData)
-	{
-		const FString ContextString = RowName.ToString();
-		S_CombatBehavior = CombatBehaviorData->FindRow<FCombatBehavior>(RowName, ContextString, true);
+	AICharacter = Cast<AAI_BaseCharacter>(GetOwner());
 
+	if(AICharacter && AICharacter->GetArchetype())
+	{
+		S_CombatBehavior = AICharacter->GetArchetype()->FindCombatBehavior();
 
-		AICharacter = Cast<AAI_BaseCharacter>(GetOwner());
-		
-		if(AICharacter)
+		if(S_CombatBehavior)
 		{
-			AbilitiesAvailable.Add(SeekScore());
-			AbilitiesAvailable.Add(StrafeScore());
-			AbilitiesAvailable.Add(AttackScore());
-			AbilitiesAvailable.Add(RangedAttackScore());
-			AbilitiesAvailable.Add(UltimateAttackScore());
-			AbilitiesAvailable.Add(DodgeScore());
-			AbilitiesAvailable.Add(BlockScore());
-
-			
-			GetWorld()->GetTimerManager().SetTimer(UpdateScoreTimer, this, &UAI_UtilityComponent::UpdateScore, 0.5f, true);
+			AbilitiesAvailable.Init(0.f, NumAbilities);
+			BestTargets.Init(INDEX_NONE, NumAbilities);
+
+			AICharacter->OnCombatStateChanged().AddUObject(this, &UAI_UtilityComponent::OnOwnerCombatStateChanged);
+			StartThinking();
 		}
 	}
 }
 
-void UAI_UtilityComponent::ChooseBestAbility()
+#if WITH_EDITOR
+void UAI_UtilityComponent::GetLegacyBehavior(UDataTable*& OutCombatBehaviorData, FName& OutRowName) const
 {
-	//float Score = 0;
-	int BestAbilityIndex = 0;
+	OutCombatBehaviorData = CombatBehaviorData_DEPRECATED;
+	OutRowName = RowName_DEPRECATED;
+}
+#endif
+
+void UAI_UtilityComponent::StartThinking()
+{
+	if(AICharacter == nullptr || S_CombatBehavior == nullptr || AICharacter->IsAbstractCombat()) { return; }
+
+	// Random first delay spreads the AI that become free on the same frame over the interval (same average wait as the old polling timer)
+	GetWorld()->GetTimerManager().SetTimer(UpdateScoreTimer, this, &UAI_UtilityComponent::UpdateScore, ThinkInterval, true, FMath::FRandRange(0.f, ThinkInterval));
+}
+
+void UAI_UtilityComponent::OnOwnerCombatStateChanged(ECombatState OldState, ECombatState NewState)
+{
+	if(NewState == ECombatState::ECS_Dead)
+	{
+		CurrentPlan.Reset();
+	}
+
+	if(NewState != ECombatState::ECS_Unoccupied)
+	{
+		StopThinking();
+	}
+	else if(!GetWorld()->GetTimerManager().IsTimerActive(UpdateScoreTimer))
+	{
+		StartThinking();
+	}
+}
+
+void UAI_UtilityComponent::StopThinking()
+{
+	GetWorld()->GetTimerManager().ClearTimer(UpdateScoreTimer);
+
+	// A stun or death cancels a block/dodge still waiting for its attack
+	GetWorld()->GetTimerManager().ClearTimer(DefenseTimer);
+}
+
+void UAI_UtilityComponent::SetThinkInterval(float Interval)
+{
+	if(FMath::IsNearlyEqual(Interval, ThinkInterval)) { return; }
+
+	ThinkInterval = Interval;
+
+	// Keeps the current wait if it is shorter than the new interval, so speeding up takes effect straight away
+	FTimerManager& TimerManager = GetWorld()->GetTimerManager();
+	if(TimerManager.IsTimerActive(UpdateScoreTimer))
+	{
+		const float FirstDelay = FMath::Min(TimerManager.GetTimerRemaining(UpdateScoreTimer), ThinkInterval);
+		TimerManager.SetTimer(UpdateScoreTimer, this, &UAI_UtilityComponent::UpdateScore, ThinkInterval, true, FirstDelay);
+	}
+}
+
+bool UAI_UtilityComponent::OnAttackTelegraphed(const FAttackTelegraph& Telegraph)
+{
+	if(AICharacter == nullptr || S_CombatBehavior == nullptr || AbilitiesAvailable.Num() < NumAbilities) { return false; }
+
+	IncomingImpactEndTime = FMath::Max(IncomingImpactEndTime, Telegraph.ImpactEndTime);
+
+	// Busy AI can't start a block or dodge anyway & one already waiting for an earlier attack keeps it
+	FTimerManager& TimerManager = GetWorld()->GetTimerManager();
+	if(AICharacter->GetCombatState() != ECombatState::ECS_Unoccupied || TimerManager.IsTimerActive(DefenseTimer)) { return false; }
+
+	// Only the defensive scores against the attacker are refreshed, the rest wait for the timer
+	FUtilityTarget Attacker = MakeTarget(Telegraph.Attacker, true);
+	Attacker.bAttacking = true;
+	const FUtilityAgentState Agent = MakeAgentState();
+	AbilitiesAvailable[5] = StepScore(Agent, static_cast<int32>(EUtilityAbility::EUA_Dodge), Attacker);
+	AbilitiesAvailable[6] = StepScore(Agent, static_cast<int32>(EUtilityAbility::EUA_Block), Attacker);
+
 	const float RandNum = UKismetMathLibrary::RandomFloatInRange(0, 1);
-	for (int i = 0; i < AbilitiesAvailable.Num(); ++i)
+	const UAIMeleeCombatSettings* Settings = GetDefault<UAIMeleeCombatSettings>();
+	float LeadTime = 0.f;
+	if(AbilitiesAvailable[6] >= AbilitiesAvailable[5] && RandNum < AbilitiesAvailable[6])
+	{
+		ScheduledDefenseIndex = 6;
+		LeadTime = Settings->BlockLeadTime;
+	}
+	else if(RandNum < AbilitiesAvailable[5])
+	{
+		ScheduledDefenseIndex = 5;
+		LeadTime = Settings->DodgeLeadTime;
+	}
+	else
 	{
-		// Checks that the ability has a score value > 0
-		if(AbilitiesAvailable[i] > 0)
+		return false;
+	}
+
+	// Starting just before impact instead of at the telegraph stops block montages running out before the hit lands
+	ScheduledImpactTime = Telegraph.ImpactTime;
+	const float Delay = Telegraph.ImpactTime - LeadTime - GetWorld()->GetTimeSeconds();
+	if(Delay > 0.f)
+	{
+		TimerManager.SetTimer(DefenseTimer, this, &UAI_UtilityComponent::StartScheduledDefense, Delay, false);
+	}
+	else
+	{
+		StartScheduledDefense();
+	}
+	return true;
+}
+
+void UAI_UtilityComponent::StartScheduledDefense()
+{
+	GetWorld()->GetTimerManager().ClearTimer(DefenseTimer);
+
+	if(AICharacter == nullptr || AICharacter->GetCombatState() != ECombatState::ECS_Unoccupied) { return; }
+
+	if(ScheduledDefenseIndex == 6)
+	{
+		AICharacter->Blocking();
+	}
+	else
+	{
+		AICharacter->Dodging();
+	}
+
+	const ECombatState State = AICharacter->GetCombatState();
+	if(State == ECombatState::ECS_Blocking || State == ECombatState::ECS_Dodging)
+	{
+		if(UAttackTelegraphSubsystem* Telegraphs = UAttackTelegraphSubsystem::Get(this))
 		{
-			for (const float Item : AbilitiesAvailable)
-			{
-				// Prioritized Dithering
-				if(RandNum < Item)
-				{
-					// Checks if the [i] ability score is higher than the current score & calls the switch case relating to that index (original utility code)
-					//if(AbilitiesAvailable[i] > Score)
-					//{
-					//	BestAbilityIndex = i;
-					//	Score = AbilitiesAvailable[i];
-					//}
-
-					// Sets index to = the element relating to Item in the AbilitiesAvailable array
-					BestAbilityIndex = AbilitiesAvailable.IndexOfByKey(Item);
-				}
-			}
+			Telegraphs->RecordDefense(ScheduledImpactTime - GetWorld()->GetTimeSeconds());
 		}
-
 	}
+}
 
+bool UAI_UtilityComponent::IsAttackIncoming() const
+{
+	return IncomingImpactEndTime >= GetWorld()->GetTimeSeconds();
+}
 
+void UAI_UtilityComponent::ChooseBestAbility()
+{
+	// Prioritized Dithering (shared with the headless matches of the behavior sweep)
+	const int32 BestAbilityIndex = CombatCore::PickDitheredAbility(AbilitiesAvailable.GetData(), AbilitiesAvailable.Num(), UKismetMathLibrary::RandomFloatInRange(0, 1));
 
-	switch (BestAbilityIndex)
+	// Switches to the target the chosen ability scored best against before using it
+	const int32 TargetIndex = BestTargets.IsValidIndex(BestAbilityIndex) ? BestTargets[BestAbilityIndex] : INDEX_NONE;
+	if(Targets.IsValidIndex(TargetIndex) && Targets[TargetIndex].Handle.IsValid() && Targets[TargetIndex].Handle != AICharacter->GetEnemyHandle())
+	{
+		AICharacter->SetEnemy(Targets[TargetIndex].Handle);
+		AICharacter->SetEnemyDetected(true);
+		AICharacter->UpdateEnemyRanges();
+	}
+
+	PerformAbility(BestAbilityIndex);
+}
+
+void UAI_UtilityComponent::PerformAbility(int32 AbilityIndex)
+{
+	switch (AbilityIndex)
 	{
 		// Seek
 	case 0:
-		if(AICharacter->GetEnemy())
-		{
-			AICharacter->SeekEnemy(AICharacter->GetEnemy());
-		}
-		if(AICharacter->GetEnemyPlayer())
+		if(AICharacter->GetEnemyCharacter())
 		{
-			AICharacter->SeekEnemy(AICharacter->GetEnemyPlayer());
+			AICharacter->SeekEnemy(AICharacter->GetEnemyCharacter());
 		}
 		break;
 
@@ -132,255 +301,383 @@ void UAI_UtilityComponent::ChooseBestAbility()
 		break;
 
 	}
-
-
 }
 
-void UAI_UtilityComponent::UpdateScore()
+bool UAI_UtilityComponent::FollowPlan()
 {
-	if(AICharacter->IsDead())
-	{
-		GetWorld()->GetTimerManager().ClearTimer(UpdateScoreTimer);
-		return;
-	}
+	const UCombatArchetype* Archetype = AICharacter->GetArchetype();
+	if(!Archetype->bUseCombatPlanner) { return false; }
+
+	UCombatPlannerSubsystem* Planner = UCombatPlannerSubsystem::Get(this);
+	if(Planner == nullptr) { return false; }
 
-	if(AICharacter->GetCombatState() != ECombatState::ECS_Unoccupied) { return; }
+	const FCombatWorldState State = MakeWorldState();
 
-	for (const float Item : AbilitiesAvailable)
+	if(CurrentPlan.IsValid() && CurrentPlan->Steps.IsValidIndex(PlanStep) && bPlanStepStarted)
 	{
-		if(Item == AbilitiesAvailable[0])
-		{
-			AbilitiesAvailable[0] = SeekScore();
-		}
-		if(Item == AbilitiesAvailable[1])
-		{
-			AbilitiesAvailable[1] = StrafeScore();
-		}
-		if(Item == AbilitiesAvailable[2])
-		{
-			AbilitiesAvailable[2] = AttackScore();
-		}
-		if(Item == AbilitiesAvailable[3])
-		{
-			AbilitiesAvailable[3] = RangedAttackScore();
-		}
-		if(Item == AbilitiesAvailable[4])
-		{
-			AbilitiesAvailable[4] = UltimateAttackScore();
-		}
-		if(Item == AbilitiesAvailable[5])
+		// Thinking only happens once the owner is unoccupied again, so a started action is done by now
+		// Seek keeps moving until it reaches attack range (or its preconditions break below)
+		const FCombatPlanStep& Step = CurrentPlan->Steps[PlanStep];
+		const bool bEffectsHold = State.Meets(Step.Added, Step.Removed);
+		if(!Step.bDurative || bEffectsHold)
 		{
-			AbilitiesAvailable[5] = DodgeScore();
+			++PlanStep;
+			bPlanStepStarted = false;
 		}
-		if(Item == AbilitiesAvailable[6])
+	}
+
+	const bool bPlanFinished = !CurrentPlan.IsValid() || !CurrentPlan->Steps.IsValidIndex(PlanStep);
+	if(bPlanFinished || !State.Meets(CurrentPlan->Steps[PlanStep].Required, CurrentPlan->Steps[PlanStep].Forbidden))
+	{
+		if(!bPlanFinished)
 		{
-			AbilitiesAvailable[6] = BlockScore();
+			Planner->RecordReplan();
 		}
 
+		CurrentPlan = Planner->FindOrPlan(Archetype, State);
+		PlanStep = 0;
+		bPlanStepStarted = false;
+
+		if(!CurrentPlan.IsValid()) { return false; }
 	}
-	ChooseBestAbility();
 
+	PerformAbility(static_cast<int32>(CurrentPlan->Steps[PlanStep].Ability));
+	bPlanStepStarted = true;
+	return true;
 }
 
-float UAI_UtilityComponent::ScoreAbilities(float BehaviorValue, TArray<float> Conditions)
+FCombatWorldState UAI_UtilityComponent::MakeWorldState() const
 {
-	float Score = BehaviorValue;
-	for (const float AbilityScore: Conditions)
-	{
-		Score *= AbilityScore;
-
-		if(Score == 0)
-		{
-			return 0;
-		}
-	}
-
-	// Averaging scheme of overall score
-	// Depending on the amount of conditions being multiplied, Score can become very small,
-	// so this calculation averages it out giving it a more readable score
-	const float OriginalScore = Score;
-	const float ModFactor = 1 - (1 / Conditions.Num());
-	const float MakeupValue = (1 - OriginalScore) * ModFactor;
-	Score = OriginalScore + (MakeupValue * OriginalScore);
-	return Score;
+	const UCombatArchetype* Archetype = AICharacter->GetArchetype();
+	const bool bEnemyDetected = AICharacter->GetEnemyDetected() && AICharacter->GetEnemyCharacter();
+
+	FCombatWorldState State;
+	State.Set(ECombatFact::EnemyDetected, bEnemyDetected);
+	State.Set(ECombatFact::InAttackRange, bEnemyDetected && AICharacter->InAttackRange());
+	State.Set(ECombatFact::InRangedAttackRange, bEnemyDetected && AICharacter->InRangedAttackRange());
+	State.Set(ECombatFact::EnemyAttacking, IsAttackIncoming() || MakeTarget(AICharacter->GetEnemyHandle(), bEnemyDetected).bAttacking);
+	State.Set(ECombatFact::CanStrafe, AICharacter->CanStrafe());
+	State.Set(ECombatFact::CanBlock, AICharacter->CanBlock());
+	State.Set(ECombatFact::CanDodge, AICharacter->CanDodge());
+	State.Set(ECombatFact::Aggressive, Archetype->bIsAggressive);
+	State.Set(ECombatFact::HasRangedAttack, Archetype->HasRangedAttack());
+	State.Set(ECombatFact::HasUltimateAttack, !Archetype->UltimateAttackMontage.IsNull());
+	return State;
 }
 
-float UAI_UtilityComponent::SeekScore()
+void UAI_UtilityComponent::UpdateScore()
 {
-	TArray<float> SeekConditions;
-	float SeekValue = 0;
-	if(!AICharacter->InAttackRange() && AICharacter->GetEnemyDetected())
+	if(AICharacter->IsDead())
 	{
-		SeekValue = 0.9f;
+		GetWorld()->GetTimerManager().ClearTimer(UpdateScoreTimer);
+		return;
 	}
-	else
+
+	// Waiting to block or dodge a telegraphed attack
+	if(GetWorld()->GetTimerManager().IsTimerActive(DefenseTimer)) { return; }
+
+	// Planned archetypes only fall back to scoring when no plan applies
+	if(FollowPlan()) { return; }
+
+	// Batched through the policy network with the other AI thinking this frame, the scores below are the fallback without a model
+	UCombatPolicySubsystem* Policy = UCombatPolicySubsystem::Get(this);
+	if(Policy && Policy->IsPolicyReady())
 	{
-		SeekValue = 0;
+		Policy->RequestEvaluation(this);
+		return;
 	}
 
-	if(AICharacter->InRangedAttackRange())
+	// Scored on worker threads against next frames snapshot, the snapshot subsystem calls ChooseBestAbility with the results
+	UCombatSnapshotSubsystem* Snapshot = UCombatSnapshotSubsystem::Get(this);
+	if(Snapshot && Snapshot->IsAsyncEvaluationEnabled())
 	{
-		SeekValue = 0;
+		Snapshot->RequestEvaluation(this);
+		return;
 	}
 
+	GatherTargets();
+	LastPairsEvaluated = ScoreTargets(MakeAgentState(), Targets, IsPruningEnabled(), AbilitiesAvailable, BestTargets);
+	ChooseBestAbility();
 
-	
-	SeekConditions.Add(SeekValue);
-	return ScoreAbilities(SeekValue, SeekConditions);
 }
 
-float UAI_UtilityComponent::StrafeScore()
+bool UAI_UtilityComponent::IsPruningEnabled()
 {
-	TArray<float> StrafeConditions;
-	float StrafeValue = 0;
-	if(AICharacter->CanStrafe() && AICharacter->GetEnemyDetected())
-	{
-		StrafeValue = 0.8;
-	}
-	else
-	{
-		StrafeValue = 0;
-	}
-
-	StrafeConditions.Add(StrafeValue);
-
+	return CVarUtilityPrune.GetValueOnGameThread() != 0;
+}
 
-	return ScoreAbilities(StrafeValue, StrafeConditions);
+float UAI_UtilityComponent::ScoreAbilities(float BehaviorValue, TArrayView<const float> Conditions)
+{
+	return CombatCore::ScoreConditions(BehaviorValue, Conditions.GetData(), Conditions.Num());
 }
 
-float UAI_UtilityComponent::AttackScore()
+void UAI_UtilityComponent::GatherTargets()
 {
-	TArray<float> AttackConditions;
-	float AttackRangeValue = 0;
+	TArray<FCombatantHandle, TInlineAllocator<8>> Candidates;
+	GatherCandidates(Candidates);
 
-	if(AICharacter->InAttackRange() && AICharacter->GetEnemyDetected())
+	Targets.Reset();
+	for (int32 Index = 0; Index < Candidates.Num(); ++Index)
 	{
-		AttackRangeValue = 0.6f;
-	}
-	else
-	{
-		AttackRangeValue = 0;
+		Targets.Add(MakeTarget(Candidates[Index], Index > 0 || AICharacter->GetEnemyDetected()));
 	}
+}
+
+void UAI_UtilityComponent::GatherCandidates(TArray<FCombatantHandle, TInlineAllocator<8>>& OutCandidates) const
+{
+	OutCandidates.Reset();
 
+	const FCombatantHandle EnemyHandle = AICharacter->GetEnemyHandle();
+	OutCandidates.Add(EnemyHandle);
 
+	const ACharacter_AIController* Controller = AICharacter->GetCharacterAIController();
+	const int32 MaxTargets = GetDefault<UAIMeleeCombatSettings>()->MaxUtilityTargets;
+	if(Controller == nullptr || MaxTargets <= 1) { return; }
 
-	AttackConditions.Add(AttackRangeValue);
+	TArray<FCombatantHandle> PerceivedEnemies;
+	Controller->GetPerceivedEnemies(PerceivedEnemies, MaxTargets);
+	for (const FCombatantHandle& Handle : PerceivedEnemies)
+	{
+		if(OutCandidates.Num() >= MaxTargets) { break; }
+		if(Handle != EnemyHandle)
+		{
+			OutCandidates.Add(Handle);
+		}
+	}
+}
 
+FUtilityAgentState UAI_UtilityComponent::MakeAgentState() const
+{
+	FUtilityAgentState Agent;
+	const UCombatArchetype* Archetype = AICharacter->GetArchetype();
+	Agent.Behavior = MakeBehaviorValues(*S_CombatBehavior);
+	Agent.Ranges = { Archetype->AttackRange, Archetype->RangedAttackRange };
+	for (int32 Ability = 0; Ability < NumAbilities; ++Ability)
+	{
+		Agent.Considerations[Ability] = Archetype->GetBakedConsiderations(Ability);
+	}
+	Agent.HealthFraction = AICharacter->GetHealthFraction();
+	Agent.StrafeCooldownRemaining = AICharacter->GetStrafeCooldownRemaining();
+	Agent.BlockCooldownRemaining = AICharacter->GetBlockCooldownRemaining();
+	Agent.DodgeCooldownRemaining = AICharacter->GetDodgeCooldownRemaining();
+	Agent.bCanStrafe = AICharacter->CanStrafe();
+	Agent.bCanBlock = AICharacter->CanBlock();
+	Agent.bCanDodge = AICharacter->CanDodge();
+	Agent.bAttackIncoming = IsAttackIncoming();
+	Agent.bEnemyDetected = AICharacter->GetEnemyDetected();
+	return Agent;
+}
 
-	return ScoreAbilities(S_CombatBehavior->AttackValue, AttackConditions);
+void UAI_UtilityComponent::MakePolicyInputs(const FUtilityAgentState& Agent, const FUtilityTarget& Target, float* OutInputs)
+{
+	OutInputs[static_cast<int32>(EPolicyInput::EnemyDetected)] = Target.bDetected ? 1.f : 0.f;
+	OutInputs[static_cast<int32>(EPolicyInput::InAttackRange)] = Target.bDetected && GetRangeBand(Agent, Target) == CombatCore::ERangeBand::Melee ? 1.f : 0.f;
+	OutInputs[static_cast<int32>(EPolicyInput::InRangedAttackRange)] = Target.bDetected && GetRangeBand(Agent, Target) == CombatCore::ERangeBand::Ranged ? 1.f : 0.f;
+	OutInputs[static_cast<int32>(EPolicyInput::CanStrafe)] = Agent.bCanStrafe ? 1.f : 0.f;
+	OutInputs[static_cast<int32>(EPolicyInput::CanBlock)] = Agent.bCanBlock ? 1.f : 0.f;
+	OutInputs[static_cast<int32>(EPolicyInput::CanDodge)] = Agent.bCanDodge ? 1.f : 0.f;
+	OutInputs[static_cast<int32>(EPolicyInput::EnemyAttacking)] = (Target.bAttacking || Agent.bAttackIncoming) ? 1.f : 0.f;
+	OutInputs[static_cast<int32>(EPolicyInput::HealthFraction)] = Agent.HealthFraction;
 }
 
-float UAI_UtilityComponent::RangedAttackScore()
+FUtilityTarget UAI_UtilityComponent::MakeTarget(FCombatantHandle Handle, bool bDetected) const
 {
-	TArray<float> RangedAttackConditions;
-	float RangedAttackValue = 0;
+	FUtilityTarget Target;
+	Target.Handle = Handle;
 
-	
-	if(AICharacter->InRangedAttackRange() && AICharacter->GetEnemyDetected())
+	const UCombatantRegistry* CombatantRegistry = UCombatantRegistry::Get(this);
+	const ACharacter* Character = CombatantRegistry ? CombatantRegistry->GetCharacter(Handle) : nullptr;
+	if(Character == nullptr) { return Target; }
+
+	Target.bDetected = bDetected;
+	Target.Distance = (Character->GetActorLocation() - AICharacter->GetActorLocation()).Length();
+
+	if(const AAI_BaseCharacter* EnemyAI = CombatantRegistry->GetAICharacter(Handle))
 	{
-		RangedAttackValue = 0.3f;
+		Target.bAttacking = EnemyAI->GetIsAttacking();
 	}
-	else
+	else if(const APlayerCharacter* EnemyPlayer = CombatantRegistry->GetPlayerCharacter(Handle))
 	{
-		RangedAttackValue = 0;
+		Target.bAttacking = EnemyPlayer->GetIsAttacking();
 	}
-
-	RangedAttackConditions.Add(RangedAttackValue);
-
-
-	return ScoreAbilities(S_CombatBehavior->RangedAttackValue, RangedAttackConditions);
+	return Target;
 }
 
-float UAI_UtilityComponent::UltimateAttackScore()
+int32 UAI_UtilityComponent::ScoreTargets(const FUtilityAgentState& Agent, const TArray<FUtilityTarget>& InTargets, bool bPrune, TArray<float>& OutScores, TArray<int32>& OutBestTargets)
 {
-	TArray<float> UltimateAttackConditions;
-	float UltimateAttackValue = 0;
+	SCOPE_CYCLE_COUNTER(STAT_UtilityScoreTargets);
+
+	OutScores.Init(0.f, NumAbilities);
+	OutBestTargets.Init(INDEX_NONE, NumAbilities);
 
-	if(AICharacter->InAttackRange() && AICharacter->GetEnemyDetected())
+	float UpperBounds[NumAbilities];
+	for (int32 Ability = 0; Ability < NumAbilities; ++Ability)
 	{
-		UltimateAttackValue = 0.2f;
+		UpperBounds[Ability] = AbilityUpperBound(Agent, Ability);
 	}
-	else
+
+	int32 PairsEvaluated = 0;
+	for (int32 TargetIndex = 0; TargetIndex < InTargets.Num(); ++TargetIndex)
 	{
-		UltimateAttackValue = 0;
-	}
+		bool bAnyOpen = false;
+		for (int32 Ability = 0; Ability < NumAbilities; ++Ability)
+		{
+			// Nothing can beat a score already at the bound, so later targets only compete for the abilities still open
+			if(bPrune && OutScores[Ability] >= UpperBounds[Ability]) { continue; }
 
-	UltimateAttackConditions.Add(UltimateAttackValue);
+			bAnyOpen = true;
+			++PairsEvaluated;
 
+			const float Score = ScoreAbility(Agent, Ability, InTargets[TargetIndex]);
+			if(Score > OutScores[Ability])
+			{
+				OutScores[Ability] = Score;
+				OutBestTargets[Ability] = TargetIndex;
+			}
+		}
 
+		if(!bAnyOpen) { break; }
+	}
 
-	return ScoreAbilities(S_CombatBehavior->UltimateAttackValue, UltimateAttackConditions);
+	INC_DWORD_STAT(STAT_UtilityEvaluations);
+	INC_DWORD_STAT_BY(STAT_UtilityPairsEvaluated, PairsEvaluated);
+	return PairsEvaluated;
 }
 
-// Character attempts to Dodge incoming ranged melee attacks
-float UAI_UtilityComponent::DodgeScore()
+float UAI_UtilityComponent::ScoreAbility(const FUtilityAgentState& Agent, int32 AbilityIndex, const FUtilityTarget& Target)
 {
-	TArray<float> DodgeConditions;
-	float DodgeValue = 0;
-
-	if(AICharacter->GetEnemy())
+	const FBakedConsiderationSet& Considerations = Agent.Considerations[AbilityIndex];
+	if(!Considerations.IsEmpty())
 	{
-		if(AICharacter->GetEnemy()->GetIsAttacking() && AICharacter->CanDodge())
-		{
-			DodgeValue = 0.5f;
-		}
-		else
-		{
-			DodgeValue = 0;
-		}
+		return CurveScore(Agent, AbilityIndex, Considerations, Target);
 	}
 
-	if(AICharacter->GetEnemyPlayer())
+	return StepScore(Agent, AbilityIndex, Target);
+}
+
+float UAI_UtilityComponent::StepScore(const FUtilityAgentState& Agent, int32 AbilityIndex, const FUtilityTarget& Target)
+{
+	CombatCore::FStepFacts Facts;
+	Facts.Distance = Target.Distance;
+	Facts.bDetected = Target.bDetected;
+	Facts.bEnemyAttacking = Target.bAttacking || Agent.bAttackIncoming;
+	Facts.bCanStrafe = Agent.bCanStrafe;
+	Facts.bCanBlock = Agent.bCanBlock;
+	Facts.bCanDodge = Agent.bCanDodge;
+
+	return CombatCore::StepScore(static_cast<CombatCore::EAbility>(AbilityIndex), Agent.Behavior, Agent.Ranges, Facts);
+}
+
+float UAI_UtilityComponent::AbilityUpperBound(const FUtilityAgentState& Agent, int32 AbilityIndex)
+{
+	// Scores only grow with their conditions, so the best sample of every curve bounds the score
+	const FBakedConsiderationSet& Considerations = Agent.Considerations[AbilityIndex];
+	if(!Considerations.IsEmpty())
 	{
-		if(AICharacter->GetEnemyPlayer()->GetIsAttacking() && AICharacter->CanDodge())
-		{
-			DodgeValue = 0.5f;
-		}
-		else
+		TArray<float, TInlineAllocator<4>> MaxConditions;
+		for (const FBakedCurve& Curve : Considerations.Curves)
 		{
-			DodgeValue = 0;
+			MaxConditions.Add(Curve.MaxValue);
 		}
+		return ScoreAbilities(GetBehaviorValue(Agent, AbilityIndex), MaxConditions);
 	}
 
+	return CombatCore::StepUpperBound(static_cast<CombatCore::EAbility>(AbilityIndex), Agent.Behavior);
+}
 
+float UAI_UtilityComponent::CurveScore(const FUtilityAgentState& Agent, int32 AbilityIndex, const FBakedConsiderationSet& Considerations, const FUtilityTarget& Target)
+{
+	// Seek & the attacks still need a target in sight, dodge & block are shaped by the Enemy Attacking input instead
+	if(AbilityIndex <= static_cast<int32>(EUtilityAbility::EUA_UltimateAttack) && !Target.bDetected) { return 0.f; }
 
+	// Abilities without a cooldown curve keep the hard cooldown gate
+	const float CooldownRemaining = GetCooldownRemaining(Agent, AbilityIndex);
+	if(!Considerations.bReadsCooldown && CooldownRemaining > 0.f) { return 0.f; }
 
-	DodgeConditions.Add(DodgeValue);
-	return ScoreAbilities(S_CombatBehavior->DodgeValue, DodgeConditions);
+	const float Inputs[static_cast<int32>(EUtilityInput::EUI_MAX)] =
+	{
+		Target.Distance,
+		Agent.HealthFraction,
+		CooldownRemaining,
+		(Target.bAttacking || Agent.bAttackIncoming) ? 1.f : 0.f
+	};
+
+	TArray<float, TInlineAllocator<4>> Conditions;
+	for (int32 Index = 0; Index < Considerations.Curves.Num(); ++Index)
+	{
+		Conditions.Add(Considerations.Curves[Index].Sample(Inputs[static_cast<int32>(Considerations.Inputs[Index])]));
+	}
+
+	return ScoreAbilities(GetBehaviorValue(Agent, AbilityIndex), Conditions);
 }
 
+float UAI_UtilityComponent::GetBehaviorValue(const FUtilityAgentState& Agent, int32 AbilityIndex)
+{
+	return CombatCore::GetBehaviorValue(Agent.Behavior, static_cast<CombatCore::EAbility>(AbilityIndex));
+}
 
-// Character attempts to Block incoming melee attacks
-float UAI_UtilityComponent::BlockScore()
+float UAI_UtilityComponent::GetCooldownRemaining(const FUtilityAgentState& Agent, int32 AbilityIndex)
 {
-	TArray<float> BlockConditions;
-	float BlockValue = 0;
+	switch (static_cast<EUtilityAbility>(AbilityIndex))
+	{
+	case EUtilityAbility::EUA_Strafe:
+		return Agent.StrafeCooldownRemaining;
+	case EUtilityAbility::EUA_Dodge:
+		return Agent.DodgeCooldownRemaining;
+	case EUtilityAbility::EUA_Block:
+		return Agent.BlockCooldownRemaining;
+	default:
+		return 0.f;
+	}
+}
 
-	if(AICharacter->GetEnemy())
+void UAI_UtilityComponent::RunScoringBenchmark(UWorld* World)
+{
+	if(World == nullptr) { return; }
+
+	const UAI_UtilityComponent* Utility = nullptr;
+	for (TActorIterator<AAI_BaseCharacter> It(World); It && Utility == nullptr; ++It)
 	{
-		if(AICharacter->GetEnemy()->GetIsAttacking() && AICharacter->CanBlock())
-		{
-			BlockValue = 0.6f;
-		}
-		else
-		{
-			BlockValue = 0;
-		}
+		const UAI_UtilityComponent* Candidate = It->GetUtilityComponent();
+		Utility = Candidate && Candidate->S_CombatBehavior ? Candidate : nullptr;
 	}
+	if(Utility == nullptr)
+	{
+		UE_LOG(LogAIMeleeCombat, Warning, TEXT("AIMelee.Utility.Benchmark needs an AI with a combat behavior in the world"));
+		return;
+	}
+
+	constexpr int32 NumIterations = 10000;
+	const FUtilityAgentState Agent = Utility->MakeAgentState();
+	const float RangedAttackRange = Agent.Ranges.RangedAttackRange;
 
-	if(AICharacter->GetEnemyPlayer())
+	for (const int32 NumTargets : { 1, 8, 32 })
 	{
-		if(AICharacter->GetEnemyPlayer()->GetIsAttacking() && AICharacter->CanBlock())
+		// Fixed seed so the pruned & unpruned runs see the same targets
+		FRandomStream Random(NumTargets);
+		TArray<FUtilityTarget> BenchmarkTargets;
+		for (int32 Index = 0; Index < NumTargets; ++Index)
 		{
-			BlockValue = 0.6f;
+			FUtilityTarget& Target = BenchmarkTargets.AddDefaulted_GetRef();
+			Target.Distance = Random.FRandRange(0.f, RangedAttackRange * 2.f);
+			Target.bDetected = true;
+			Target.bAttacking = Random.FRand() < 0.25f;
 		}
-		else
+
+		TArray<float> Scores;
+		TArray<int32> Best;
+		for (const bool bPrune : { false, true })
 		{
-			BlockValue = 0;
+			int64 PairsEvaluated = 0;
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+			{
+				PairsEvaluated += ScoreTargets(Agent, BenchmarkTargets, bPrune, Scores, Best);
+			}
+			const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+			UE_LOG(LogAIMeleeCombat, Log, TEXT("%2d targets, %s: %.1f pairs per evaluation, %.2f us per evaluation"),
+				NumTargets, bPrune ? TEXT("pruned  ") : TEXT("unpruned"), static_cast<double>(PairsEvaluated) / NumIterations, Seconds / NumIterations * 1000000.0);
 		}
 	}
-
-	BlockConditions.Add(BlockValue);
-	return ScoreAbilities(S_CombatBehavior->BlockValue, BlockConditions);
 }
-
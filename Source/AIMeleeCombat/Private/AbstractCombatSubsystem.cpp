@@ -0,0 +1,357 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AbstractCombatSubsystem.h"
+#include "AIMeleeCombat.h"
+#include "AIMeleeCombatSettings.h"
+#include "AI_BaseCharacter.h"
+#include "CombatArchetype.h"
+#include "CombatantRegistry.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "NavigationSystem.h"
+#include "GameFramework/PlayerController.h"
+#include "Kismet/GameplayStatics.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Abstract Combatants"), STAT_AbstractCombatants, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Abstract Exchanges"), STAT_AbstractExchanges, STATGROUP_AIMeleeCombat);
+DECLARE_CYCLE_STAT(TEXT("Abstract Combat Step"), STAT_AbstractCombatStep, STATGROUP_AIMeleeCombat);
+
+static TAutoConsoleVariable<int32> CVarAbstractCombatEnable(
+	TEXT("AIMelee.AbstractCombat.Enable"),
+	1,
+	TEXT("0: every fight runs the full simulation, 1: AI vs AI fights far from the players are resolved statistically"));
+
+static FAutoConsoleCommandWithWorld AbstractCombatValidateCommand(
+	TEXT("AIMelee.AbstractCombat.Validate"),
+	TEXT("Compares the damage rates, block & dodge rates & duel outcomes recorded from full simulation AI fights with the statistical model"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if(const UAbstractCombatSubsystem* AbstractCombat = World ? World->GetSubsystem<UAbstractCombatSubsystem>() : nullptr)
+		{
+			AbstractCombat->LogValidation();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld CombatCoreBenchmarkCommand(
+	TEXT("AIMelee.CombatCore.Benchmark"),
+	TEXT("Runs abstract duels of the default archetype through the combat core rules on one thread & on every core & logs the exchanges per second"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&UAbstractCombatSubsystem::RunCoreBenchmark));
+
+UAbstractCombatSubsystem::UAbstractCombatSubsystem() :
+	Random(FPlatformTime::Cycles()),
+	TimeSinceStep(0.f),
+	NumAbstract(0)
+{
+}
+
+UAbstractCombatSubsystem* UAbstractCombatSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UAbstractCombatSubsystem>() : nullptr;
+}
+
+TStatId UAbstractCombatSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UAbstractCombatSubsystem, STATGROUP_Tickables);
+}
+
+void UAbstractCombatSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TimeSinceStep += DeltaTime;
+	if(TimeSinceStep < GetDefault<UAIMeleeCombatSettings>()->AbstractCombatStep) { return; }
+
+	Step(TimeSinceStep);
+	TimeSinceStep = 0.f;
+}
+
+void UAbstractCombatSubsystem::Step(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AbstractCombatStep);
+
+	const UAIMeleeCombatSettings* Settings = GetDefault<UAIMeleeCombatSettings>();
+	const UCombatantRegistry* Registry = UCombatantRegistry::Get(this);
+	if(Registry == nullptr) { return; }
+
+	TArray<FVector, TInlineAllocator<4>> PlayerLocations;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if(const APlayerController* PlayerController = It->Get())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			PlayerLocations.Add(ViewLocation);
+		}
+	}
+
+	const bool bEnabled = CVarAbstractCombatEnable.GetValueOnGameThread() != 0;
+
+	// Eligibility first, a fight only changes mode once both of its sides have been looked at
+	TArray<AAI_BaseCharacter*, TInlineAllocator<64>> Alive;
+	TSet<const AAI_BaseCharacter*> Eligible;
+	Registry->ForEachCombatant([this, Registry, Settings, bEnabled, &PlayerLocations, &Alive, &Eligible](FCombatantHandle Handle, ACharacter* Character, ECombatantKind Kind)
+	{
+		AAI_BaseCharacter* AICharacter = Registry->GetAICharacter(Handle);
+		if(AICharacter == nullptr || AICharacter->IsDead()) { return; }
+
+		Alive.Add(AICharacter);
+
+		// Abstract AI stay abstract until a player gets within the (shorter) promote distance, only AI free to switch (idle or abstract already) count
+		const float MinDistance = AICharacter->IsAbstractCombat() ? Settings->AbstractCombatPromoteDistance : Settings->AbstractCombatDistance;
+		const bool bFree = AICharacter->IsAbstractCombat() || AICharacter->GetCombatState() == ECombatState::ECS_Unoccupied;
+		if(bEnabled && bFree && IsEligible(AICharacter, PlayerLocations, MinDistance))
+		{
+			Eligible.Add(AICharacter);
+		}
+	});
+
+	TArray<AAI_BaseCharacter*, TInlineAllocator<64>> Abstract;
+	for (AAI_BaseCharacter* AICharacter : Alive)
+	{
+		// Only pairs fighting each other go abstract, otherwise a full simulation AI would be swinging at one that no longer fights back
+		const AAI_BaseCharacter* Enemy = AICharacter->GetEnemy();
+		const bool bPaired = Eligible.Contains(AICharacter) && Eligible.Contains(Enemy) && Enemy->GetEnemy() == AICharacter;
+		if(bPaired != AICharacter->IsAbstractCombat())
+		{
+			AICharacter->SetAbstractCombat(bPaired);
+		}
+
+		if(AICharacter->IsAbstractCombat())
+		{
+			Abstract.Add(AICharacter);
+			continue;
+		}
+
+		// Full simulation time spent fighting another AI, the denominator of the recorded damage rates
+		if(Enemy && AICharacter->GetEnemyDetected() && FVector::Dist(Enemy->GetActorLocation(), AICharacter->GetActorLocation()) <= AICharacter->GetArchetype()->RangedAttackRange)
+		{
+			FindOrAddObservation(AICharacter->GetArchetype()).EngagedSeconds += DeltaTime;
+		}
+	}
+
+	// Resolved after the promotions so both sides of a fight see the same modes
+	for (AAI_BaseCharacter* AICharacter : Abstract)
+	{
+		if(!AICharacter->IsDead() && AICharacter->IsAbstractCombat())
+		{
+			Resolve(AICharacter, DeltaTime);
+		}
+	}
+
+	NumAbstract = Abstract.Num();
+	SET_DWORD_STAT(STAT_AbstractCombatants, NumAbstract);
+}
+
+bool UAbstractCombatSubsystem::IsEligible(const AAI_BaseCharacter* AICharacter, const TArray<FVector, TInlineAllocator<4>>& PlayerLocations, float MinDistance) const
+{
+	const AAI_BaseCharacter* Enemy = AICharacter->GetEnemy();
+	if(Enemy == nullptr || Enemy->IsDead() || !AICharacter->GetEnemyDetected()) { return false; }
+
+	const float MinDistanceSquared = FMath::Square(MinDistance);
+	for (const FVector& PlayerLocation : PlayerLocations)
+	{
+		if(FVector::DistSquared(PlayerLocation, AICharacter->GetActorLocation()) < MinDistanceSquared
+			|| FVector::DistSquared(PlayerLocation, Enemy->GetActorLocation()) < MinDistanceSquared)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void UAbstractCombatSubsystem::Resolve(AAI_BaseCharacter* AICharacter, float DeltaTime)
+{
+	AAI_BaseCharacter* Enemy = AICharacter->GetEnemy();
+	if(Enemy == nullptr || Enemy->IsDead()) { return; }
+
+	const UCombatArchetype* Archetype = AICharacter->GetArchetype();
+	const FVector ToEnemy = Enemy->GetActorLocation() - AICharacter->GetActorLocation();
+	const float Distance = ToEnemy.Size2D();
+
+	// Walks straight at the enemy, the exact path doesn't matter with no one watching
+	if(Distance > Archetype->AttackRange)
+	{
+		const float MoveDistance = FMath::Min(AICharacter->GetCharacterMovement()->MaxWalkSpeed * DeltaTime, Distance - Archetype->AttackRange * 0.8f);
+		const FVector Direction = FVector(ToEnemy.X, ToEnemy.Y, 0.f).GetSafeNormal();
+		const FVector Location = AICharacter->GetActorLocation();
+		FVector Goal = Location + Direction * MoveDistance;
+
+		// Along the navmesh (stopping at its edges) & onto its height, so abstract AI can't walk through walls, off ledges or float over slopes
+		const UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+		if(NavSystem == nullptr)
+		{
+			AICharacter->SetActorLocationAndRotation(Goal, Direction.Rotation(), true);
+			return;
+		}
+
+		const float HalfHeight = AICharacter->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+		const FVector FeetOffset(0.f, 0.f, HalfHeight);
+		FVector HitLocation;
+		if(UNavigationSystemV1::NavigationRaycast(GetWorld(), Location - FeetOffset, Goal - FeetOffset, HitLocation, nullptr, AICharacter->GetController()))
+		{
+			Goal = HitLocation + FeetOffset;
+		}
+
+		FNavLocation NavLocation;
+		if(!NavSystem->ProjectPointToNavigation(Goal - FeetOffset, NavLocation, FVector(AICharacter->GetCapsuleComponent()->GetScaledCapsuleRadius(), AICharacter->GetCapsuleComponent()->GetScaledCapsuleRadius(), HalfHeight))) { return; }
+
+		AICharacter->SetActorLocationAndRotation(NavLocation.Location + FeetOffset, Direction.Rotation());
+		return;
+	}
+
+	EAbstractHit Hit;
+	const float Damage = ResolveExchange(*Archetype, *Enemy->GetArchetype(), DeltaTime, Random, Hit);
+	INC_DWORD_STAT(STAT_AbstractExchanges);
+
+	if(Damage > 0.f)
+	{
+		UGameplayStatics::ApplyDamage(Enemy, Damage, AICharacter->GetController(), AICharacter, UDamageType::StaticClass());
+	}
+}
+
+CombatCore::FExchangeProfile UAbstractCombatSubsystem::MakeExchangeProfile(const UCombatArchetype& Archetype)
+{
+	CombatCore::FExchangeProfile Profile;
+	Profile.MaxHealth = Archetype.MaxHealth;
+	Profile.DamagePerSecond = Archetype.AbstractDamagePerSecond;
+	Profile.BlockChance = Archetype.AbstractBlockChance;
+	Profile.DodgeChance = Archetype.AbstractDodgeChance;
+	return Profile;
+}
+
+float UAbstractCombatSubsystem::ResolveExchange(const UCombatArchetype& Attacker, const UCombatArchetype& Defender, float DeltaTime, FRandomStream& InRandom, EAbstractHit& OutHit)
+{
+	return CombatCore::ResolveExchange(MakeExchangeProfile(Attacker), MakeExchangeProfile(Defender), DeltaTime, InRandom.FRand(), OutHit);
+}
+
+UAbstractCombatSubsystem::FArchetypeObservation& UAbstractCombatSubsystem::FindOrAddObservation(const UCombatArchetype* Archetype)
+{
+	FArchetypeObservation& Observation = Observations.FindOrAdd(FObjectKey(Archetype));
+	Observation.Archetype = Archetype;
+	return Observation;
+}
+
+void UAbstractCombatSubsystem::RecordFullSimHit(const UCombatArchetype* Attacker, const UCombatArchetype* Defender, float Damage, EAbstractHit Hit, bool bKilled)
+{
+	if(Attacker == nullptr || Defender == nullptr) { return; }
+
+	FindOrAddObservation(Attacker).DamageDealt += Damage;
+
+	FArchetypeObservation& DefenderObservation = FindOrAddObservation(Defender);
+	++DefenderObservation.HitsTaken;
+	DefenderObservation.HitsBlocked += Hit == EAbstractHit::Blocked ? 1 : 0;
+	DefenderObservation.HitsDodged += Hit == EAbstractHit::Dodged ? 1 : 0;
+
+	if(bKilled)
+	{
+		Kills.FindOrAdd(TPair<FObjectKey, FObjectKey>(FObjectKey(Attacker), FObjectKey(Defender)))++;
+	}
+}
+
+void UAbstractCombatSubsystem::SimulateDuels(const UCombatArchetype& A, const UCombatArchetype& B, int32 NumDuels, float& OutWinRateA, float& OutMeanDuration)
+{
+	// Same step as the live resolution, so step size effects show up in the comparison too
+	const float DeltaTime = FMath::Max(GetDefault<UAIMeleeCombatSettings>()->AbstractCombatStep, 0.05f);
+	constexpr float MaxDuration = 600.f;
+
+	CombatCore::FCombatRandom DuelRandom(42);
+	CombatCore::FDuelStats Stats;
+	CombatCore::SimulateDuels(MakeExchangeProfile(A), MakeExchangeProfile(B), DeltaTime, MaxDuration, NumDuels, DuelRandom, Stats);
+
+	OutWinRateA = Stats.Decisive > 0 ? static_cast<float>(Stats.WinsA) / Stats.Decisive : 0.f;
+	OutMeanDuration = Stats.NumDuels > 0 ? static_cast<float>(Stats.TotalDuration / Stats.NumDuels) : 0.f;
+}
+
+void UAbstractCombatSubsystem::RunCoreBenchmark(UWorld* World)
+{
+	const CombatCore::FExchangeProfile Profile = MakeExchangeProfile(*GetDefault<UCombatArchetype>());
+	const float DeltaTime = FMath::Max(GetDefault<UAIMeleeCombatSettings>()->AbstractCombatStep, 0.05f);
+	constexpr float MaxDuration = 600.f;
+	constexpr int32 DuelsPerWorker = 20000;
+
+	CombatCore::FCombatRandom Random(42);
+	CombatCore::FDuelStats SingleStats;
+	double StartTime = FPlatformTime::Seconds();
+	CombatCore::SimulateDuels(Profile, Profile, DeltaTime, MaxDuration, DuelsPerWorker, Random, SingleStats);
+	const double SingleSeconds = FPlatformTime::Seconds() - StartTime;
+
+	// Every worker runs its own duels with its own random stream, nothing is shared until the totals are summed
+	const int32 NumWorkers = FMath::Max(FPlatformMisc::NumberOfCoresIncludingHyperthreads(), 1);
+	TArray<CombatCore::FDuelStats> WorkerStats;
+	WorkerStats.SetNum(NumWorkers);
+	StartTime = FPlatformTime::Seconds();
+	ParallelFor(NumWorkers, [&](int32 Worker)
+	{
+		CombatCore::FCombatRandom WorkerRandom(1234 + Worker);
+		CombatCore::SimulateDuels(Profile, Profile, DeltaTime, MaxDuration, DuelsPerWorker, WorkerRandom, WorkerStats[Worker]);
+	});
+	const double ParallelSeconds = FPlatformTime::Seconds() - StartTime;
+
+	int64 ParallelExchanges = 0;
+	for (const CombatCore::FDuelStats& Stats : WorkerStats)
+	{
+		ParallelExchanges += static_cast<int64>(Stats.NumExchanges);
+	}
+
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("Combat core benchmark: %d duels, %lld exchanges in %.1f ms on one thread (%.1f million exchanges/s)"),
+		DuelsPerWorker, static_cast<int64>(SingleStats.NumExchanges), SingleSeconds * 1000.0, SingleSeconds > 0.0 ? SingleStats.NumExchanges / SingleSeconds / 1e6 : 0.0);
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("  %d workers: %lld exchanges in %.1f ms (%.1f million exchanges/s)"),
+		NumWorkers, ParallelExchanges, ParallelSeconds * 1000.0, ParallelSeconds > 0.0 ? ParallelExchanges / ParallelSeconds / 1e6 : 0.0);
+}
+
+void UAbstractCombatSubsystem::LogValidation() const
+{
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("Abstract combat: %d AI resolved statistically, %d archetypes observed in full simulation"), NumAbstract, Observations.Num());
+
+	// Dodged hits only count dodges that were still hit by the trace, so the full simulation dodge rate reads low
+	for (const TPair<FObjectKey, FArchetypeObservation>& Pair : Observations)
+	{
+		const FArchetypeObservation& Observation = Pair.Value;
+		const UCombatArchetype* Archetype = Observation.Archetype.Get();
+		if(Archetype == nullptr) { continue; }
+
+		const double DamagePerSecond = Observation.EngagedSeconds > 0.0 ? Observation.DamageDealt / Observation.EngagedSeconds : 0.0;
+		const double BlockRate = Observation.HitsTaken > 0 ? static_cast<double>(Observation.HitsBlocked) / Observation.HitsTaken : 0.0;
+		const double DodgeRate = Observation.HitsTaken > 0 ? static_cast<double>(Observation.HitsDodged) / Observation.HitsTaken : 0.0;
+
+		UE_LOG(LogAIMeleeCombat, Log, TEXT("  %s: %.0fs engaged, %.1f dps (model %.1f), %d hits taken, block %.0f%% (model %.0f%%), dodge %.0f%% (model %.0f%%)"),
+			*Archetype->GetName(), Observation.EngagedSeconds, DamagePerSecond, Archetype->AbstractDamagePerSecond, Observation.HitsTaken,
+			BlockRate * 100.0, Archetype->AbstractBlockChance * 100.f, DodgeRate * 100.0, Archetype->AbstractDodgeChance * 100.f);
+	}
+
+	TSet<TPair<FObjectKey, FObjectKey>> Logged;
+	for (const TPair<TPair<FObjectKey, FObjectKey>, int32>& Pair : Kills)
+	{
+		const TPair<FObjectKey, FObjectKey> Reverse(Pair.Key.Value, Pair.Key.Key);
+		if(Logged.Contains(Reverse)) { continue; }
+		Logged.Add(Pair.Key);
+
+		const UCombatArchetype* A = Cast<UCombatArchetype>(Pair.Key.Key.ResolveObjectPtr());
+		const UCombatArchetype* B = Cast<UCombatArchetype>(Pair.Key.Value.ResolveObjectPtr());
+		if(A == nullptr || B == nullptr) { continue; }
+
+		const int32 KillsA = Pair.Value;
+		const int32* KillsB = Kills.Find(Reverse);
+		const int32 Total = KillsA + (KillsB && A != B ? *KillsB : 0);
+
+		float PredictedWinRate = 0.f;
+		float PredictedDuration = 0.f;
+		SimulateDuels(*A, *B, 1000, PredictedWinRate, PredictedDuration);
+
+		UE_LOG(LogAIMeleeCombat, Log, TEXT("  %s vs %s: %d full simulation kills, %s wins %.0f%% (model %.0f%%, %.1fs per duel)"),
+			*A->GetName(), *B->GetName(), Total, *A->GetName(), Total > 0 ? 100.f * KillsA / Total : 0.f, PredictedWinRate * 100.f, PredictedDuration);
+	}
+}
+
+void UAbstractCombatSubsystem::Deinitialize()
+{
+	Observations.Empty();
+	Kills.Empty();
+
+	Super::Deinitialize();
+}
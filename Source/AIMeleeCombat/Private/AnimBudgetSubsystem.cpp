@@ -0,0 +1,293 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AnimBudgetSubsystem.h"
+#include "AIMeleeCombat.h"
+#include "AIMeleeCombatSettings.h"
+#include "CombatantRegistry.h"
+#include "AI_BaseCharacter.h"
+#include "PlayerCharacter.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Anim Budget Update"), STAT_AnimBudgetUpdate, STATGROUP_AIMeleeCombat);
+DECLARE_CYCLE_STAT(TEXT("Anim Budget Sample Evaluation"), STAT_AnimBudgetSampleEvaluation, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Anim Meshes Every Frame"), STAT_AnimBudgetRate1, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Anim Meshes Every 2 Frames"), STAT_AnimBudgetRate2, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Anim Meshes Every 3-4 Frames"), STAT_AnimBudgetRate4, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Anim Meshes Every 5+ Frames"), STAT_AnimBudgetRate5Plus, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Anim Meshes Off Screen"), STAT_AnimBudgetOffScreen, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Anim Meshes Forced Full Rate (Attacking)"), STAT_AnimBudgetForced, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Anim Graphs Evaluated"), STAT_AnimBudgetEvaluated, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Anim Graphs Interpolated"), STAT_AnimBudgetInterpolated, STATGROUP_AIMeleeCombat);
+
+static TAutoConsoleVariable<int32> CVarAnimBudgetEnable(
+	TEXT("AIMelee.AnimBudget.Enable"),
+	1,
+	TEXT("0: every combatant evaluates its anim graph every frame, 1: update rates come from the Animation Budget buckets"));
+
+static FAutoConsoleCommandWithWorld AnimBudgetReportCommand(
+	TEXT("AIMelee.AnimBudget.Report"),
+	TEXT("Logs how many combatants are at each animation update rate, how many anim graphs were evaluated last frame & their cost"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if(const UAnimBudgetSubsystem* AnimBudget = World ? World->GetSubsystem<UAnimBudgetSubsystem>() : nullptr)
+		{
+			AnimBudget->LogReport();
+		}
+	}));
+
+namespace
+{
+	// Attacking combatants ignore the budget so the weapon trace window sees every frames pose
+	bool IsInAttackWindow(const UCombatantRegistry* Registry, FCombatantHandle Handle, ECombatantKind Kind)
+	{
+		if(Kind == ECombatantKind::ECK_AI)
+		{
+			const AAI_BaseCharacter* AICharacter = Registry->GetAICharacter(Handle);
+			return AICharacter && AICharacter->GetIsAttacking();
+		}
+
+		const APlayerCharacter* PlayerCharacter = Registry->GetPlayerCharacter(Handle);
+		return PlayerCharacter && PlayerCharacter->GetIsAttacking();
+	}
+
+	int32 RateStatIndex(int32 UpdateRate)
+	{
+		return UpdateRate <= 1 ? 0 : UpdateRate == 2 ? 1 : UpdateRate <= 4 ? 2 : 3;
+	}
+}
+
+UAnimBudgetSubsystem::UAnimBudgetSubsystem() :
+	TimeSinceAssignment(0.f),
+	bBudgetActive(false),
+	NumCombatants(0),
+	NumForcedFullRate(0),
+	NumOffScreen(0),
+	NumEvaluated(0),
+	NumInterpolated(0),
+	NumAtRate{ 0, 0, 0, 0 }
+{
+}
+
+TStatId UAnimBudgetSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UAnimBudgetSubsystem, STATGROUP_Tickables);
+}
+
+void UAnimBudgetSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	SCOPE_CYCLE_COUNTER(STAT_AnimBudgetUpdate);
+
+	UCombatantRegistry* Registry = UCombatantRegistry::Get(this);
+	if(Registry == nullptr) { return; }
+
+	if(CVarAnimBudgetEnable.GetValueOnGameThread() == 0)
+	{
+		if(bBudgetActive)
+		{
+			RestoreFullRate(Registry);
+		}
+		return;
+	}
+
+	TimeSinceAssignment += DeltaTime;
+	if(!bBudgetActive || TimeSinceAssignment >= GetDefault<UAIMeleeCombatSettings>()->AnimBudgetUpdateInterval)
+	{
+		TimeSinceAssignment = 0.f;
+		bBudgetActive = true;
+		AssignUpdateRates(Registry);
+	}
+
+	NumCombatants = 0;
+	NumForcedFullRate = 0;
+	NumOffScreen = 0;
+	NumEvaluated = 0;
+	NumInterpolated = 0;
+	FMemory::Memzero(NumAtRate);
+
+	// Checked every frame, an attack can start between two bucket assignments
+	Registry->ForEachCombatant([this, Registry](FCombatantHandle Handle, ACharacter* Character, ECombatantKind Kind)
+	{
+		USkeletalMeshComponent* Mesh = Character ? Character->GetMesh() : nullptr;
+		if(Mesh == nullptr || !Entries.IsValidIndex(Handle.Index)) { return; }
+
+		// Combatants spawned since the last assignment are picked up by the next one
+		FAnimBudgetEntry& Entry = Entries[Handle.Index];
+		if(Entry.Serial != Handle.Serial) { return; }
+
+		const bool bFullRate = IsInAttackWindow(Registry, Handle, Kind);
+		if(bFullRate != Entry.bFullRate)
+		{
+			Entry.bFullRate = bFullRate;
+			Mesh->bEnableUpdateRateOptimizations = !bFullRate;
+		}
+
+		if(!Entry.bApplied)
+		{
+			ApplyUpdateRate(Mesh, Entry);
+		}
+
+		const bool bOnScreen = Mesh->WasRecentlyRendered(0.2f);
+		const int32 UpdateRate = bFullRate ? 1 : (bOnScreen ? Entry.VisibleUpdateRate : Entry.NonRenderedUpdateRate);
+
+		++NumCombatants;
+		++NumAtRate[RateStatIndex(UpdateRate)];
+		NumForcedFullRate += bFullRate ? 1 : 0;
+		NumOffScreen += bOnScreen ? 0 : 1;
+
+		// Skip/interpolate flags are from the meshes last anim tick
+		const FAnimUpdateRateParameters* Params = Mesh->AnimUpdateRateParams;
+		const bool bSkipped = !bFullRate && Params && Params->ShouldSkipEvaluation();
+		NumEvaluated += bSkipped ? 0 : 1;
+		NumInterpolated += (bSkipped && Params->ShouldInterpolateSkippedFrames()) ? 1 : 0;
+	});
+
+	SET_DWORD_STAT(STAT_AnimBudgetRate1, NumAtRate[0]);
+	SET_DWORD_STAT(STAT_AnimBudgetRate2, NumAtRate[1]);
+	SET_DWORD_STAT(STAT_AnimBudgetRate4, NumAtRate[2]);
+	SET_DWORD_STAT(STAT_AnimBudgetRate5Plus, NumAtRate[3]);
+	SET_DWORD_STAT(STAT_AnimBudgetOffScreen, NumOffScreen);
+	SET_DWORD_STAT(STAT_AnimBudgetForced, NumForcedFullRate);
+	SET_DWORD_STAT(STAT_AnimBudgetEvaluated, NumEvaluated);
+	SET_DWORD_STAT(STAT_AnimBudgetInterpolated, NumInterpolated);
+}
+
+void UAnimBudgetSubsystem::AssignUpdateRates(UCombatantRegistry* Registry)
+{
+	const UAIMeleeCombatSettings* Settings = GetDefault<UAIMeleeCombatSettings>();
+	if(Settings->AnimBudgetBuckets.Num() == 0) { return; }
+
+	TArray<FVector, TInlineAllocator<4>> ViewLocations;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if(const APlayerController* PlayerController = It->Get())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			ViewLocations.Add(ViewLocation);
+		}
+	}
+
+	Registry->ForEachCombatant([this, Settings, &ViewLocations](FCombatantHandle Handle, ACharacter* Character, ECombatantKind Kind)
+	{
+		USkeletalMeshComponent* Mesh = Character ? Character->GetMesh() : nullptr;
+		if(Mesh == nullptr) { return; }
+
+		if(Entries.Num() <= Handle.Index)
+		{
+			Entries.SetNum(Handle.Index + 1);
+		}
+
+		// New combatant in this slot
+		FAnimBudgetEntry& Entry = Entries[Handle.Index];
+		if(Entry.Serial != Handle.Serial)
+		{
+			Entry = FAnimBudgetEntry();
+			Entry.Serial = Handle.Serial;
+			Mesh->bEnableUpdateRateOptimizations = true;
+		}
+
+		float NearestDistanceSquared = ViewLocations.Num() > 0 ? MAX_flt : 0.f;
+		for (const FVector& ViewLocation : ViewLocations)
+		{
+			NearestDistanceSquared = FMath::Min(NearestDistanceSquared, FVector::DistSquared(ViewLocation, Character->GetActorLocation()));
+		}
+
+		const FAnimBudgetBucket* Bucket = &Settings->AnimBudgetBuckets.Last();
+		for (const FAnimBudgetBucket& Candidate : Settings->AnimBudgetBuckets)
+		{
+			if(NearestDistanceSquared <= FMath::Square(Candidate.MaxDistance))
+			{
+				Bucket = &Candidate;
+				break;
+			}
+		}
+
+		if(Entry.VisibleUpdateRate != Bucket->VisibleUpdateRate || Entry.NonRenderedUpdateRate != Bucket->NonRenderedUpdateRate)
+		{
+			Entry.VisibleUpdateRate = FMath::Max(1, Bucket->VisibleUpdateRate);
+			Entry.NonRenderedUpdateRate = FMath::Max(1, Bucket->NonRenderedUpdateRate);
+			Entry.bApplied = false;
+		}
+
+		if(!Entry.bApplied)
+		{
+			ApplyUpdateRate(Mesh, Entry);
+		}
+	});
+}
+
+void UAnimBudgetSubsystem::ApplyUpdateRate(USkeletalMeshComponent* Mesh, FAnimBudgetEntry& Entry) const
+{
+	// Created by the engine on the first anim tick after update rate optimizations are enabled, retried until then
+	FAnimUpdateRateParameters* Params = Mesh->AnimUpdateRateParams;
+	if(Params == nullptr) { return; }
+
+	// Every LOD maps to the buckets frame skip, so the rate comes from our distance buckets instead of screen size
+	Params->bShouldUseLodMap = true;
+	Params->LODToFrameSkipMap.Reset();
+	for (int32 LODIndex = 0; LODIndex < FMath::Max(1, Mesh->GetNumLODs()); ++LODIndex)
+	{
+		Params->LODToFrameSkipMap.Add(LODIndex, Entry.VisibleUpdateRate - 1);
+	}
+	Params->BaseNonRenderedUpdateRate = Entry.NonRenderedUpdateRate;
+	Params->MaxEvalRateForInterpolation = GetDefault<UAIMeleeCombatSettings>()->MaxInterpolatedUpdateRate;
+
+	Entry.bApplied = true;
+}
+
+void UAnimBudgetSubsystem::RestoreFullRate(UCombatantRegistry* Registry)
+{
+	Registry->ForEachCombatant([](FCombatantHandle Handle, ACharacter* Character, ECombatantKind Kind)
+	{
+		if(USkeletalMeshComponent* Mesh = Character ? Character->GetMesh() : nullptr)
+		{
+			Mesh->bEnableUpdateRateOptimizations = false;
+		}
+	});
+
+	// Forces a fresh assignment when the budget is turned back on
+	Entries.Reset();
+	bBudgetActive = false;
+}
+
+double UAnimBudgetSubsystem::MeasureEvaluationMs(int32 MaxSamples) const
+{
+	const UCombatantRegistry* Registry = UCombatantRegistry::Get(this);
+	if(Registry == nullptr) { return 0.0; }
+
+	SCOPE_CYCLE_COUNTER(STAT_AnimBudgetSampleEvaluation);
+
+	double TotalSeconds = 0.0;
+	int32 NumSamples = 0;
+	Registry->ForEachCombatant([&TotalSeconds, &NumSamples, MaxSamples](FCombatantHandle Handle, ACharacter* Character, ECombatantKind Kind)
+	{
+		USkeletalMeshComponent* Mesh = Character ? Character->GetMesh() : nullptr;
+		if(NumSamples >= MaxSamples || Mesh == nullptr || Mesh->GetAnimInstance() == nullptr) { return; }
+
+		// No tick function so the evaluation runs inline on this thread instead of being handed to the anim workers
+		const double StartTime = FPlatformTime::Seconds();
+		Mesh->TickAnimation(0.f, false);
+		Mesh->RefreshBoneTransforms();
+		TotalSeconds += FPlatformTime::Seconds() - StartTime;
+		++NumSamples;
+	});
+
+	return NumSamples > 0 ? TotalSeconds * 1000.0 / NumSamples : 0.0;
+}
+
+void UAnimBudgetSubsystem::LogReport() const
+{
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("Anim budget: %d combatants, %d off screen, %d forced full rate (attacking)"), NumCombatants, NumOffScreen, NumForcedFullRate);
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("  update rate 1: %d, 2: %d, 3-4: %d, 5+: %d"), NumAtRate[0], NumAtRate[1], NumAtRate[2], NumAtRate[3]);
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("  anim graphs evaluated last frame: %d / %d (%d interpolated)"), NumEvaluated, NumCombatants, NumInterpolated);
+
+	// Interpolated frames only blend the two cached poses & are left out of the estimate
+	const double EvaluationMs = MeasureEvaluationMs(32);
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("  anim cost: %.3f ms per graph evaluation, ~%.2f ms last frame (%.2f ms with every graph evaluated)"),
+		EvaluationMs, EvaluationMs * NumEvaluated, EvaluationMs * NumCombatants);
+}
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AnimNotifyState_DamageWindow.h"
+#include "Components/SkeletalMeshComponent.h"
+
+void UAnimNotifyState_DamageWindow::NotifyBegin(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, float TotalDuration, const FAnimNotifyEventReference& EventReference)
+{
+	Super::NotifyBegin(MeshComp, Animation, TotalDuration, EventReference);
+
+	if(ICombatInterface* Combatant = GetCombatant(MeshComp))
+	{
+		Combatant->BeginDamageWindow();
+		Combatant->TickDamageWindow();
+	}
+}
+
+void UAnimNotifyState_DamageWindow::NotifyTick(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, float FrameDeltaTime, const FAnimNotifyEventReference& EventReference)
+{
+	Super::NotifyTick(MeshComp, Animation, FrameDeltaTime, EventReference);
+
+	if(ICombatInterface* Combatant = GetCombatant(MeshComp))
+	{
+		Combatant->TickDamageWindow();
+	}
+}
+
+void UAnimNotifyState_DamageWindow::NotifyEnd(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, const FAnimNotifyEventReference& EventReference)
+{
+	Super::NotifyEnd(MeshComp, Animation, EventReference);
+
+	if(ICombatInterface* Combatant = GetCombatant(MeshComp))
+	{
+		Combatant->EndDamageWindow();
+	}
+}
+
+ICombatInterface* UAnimNotifyState_DamageWindow::GetCombatant(const USkeletalMeshComponent* MeshComp)
+{
+	return MeshComp ? Cast<ICombatInterface>(MeshComp->GetOwner()) : nullptr;
+}
+
+FString UAnimNotifyState_DamageWindow::GetNotifyName_Implementation() const
+{
+	return TEXT("Damage Window");
+}
@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AnimNotify_ComboAdvance.h"
+#include "CombatInterface.h"
+#include "Components/SkeletalMeshComponent.h"
+
+void UAnimNotify_ComboAdvance::Notify(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, const FAnimNotifyEventReference& EventReference)
+{
+	Super::Notify(MeshComp, Animation, EventReference);
+
+	if(ICombatInterface* Combatant = MeshComp ? Cast<ICombatInterface>(MeshComp->GetOwner()) : nullptr)
+	{
+		Combatant->AdvanceCombo();
+	}
+}
+
+FString UAnimNotify_ComboAdvance::GetNotifyName_Implementation() const
+{
+	return TEXT("Combo Advance");
+}
@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AnimNotify_EndAction.h"
+#include "CombatInterface.h"
+#include "Components/SkeletalMeshComponent.h"
+
+void UAnimNotify_EndAction::Notify(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, const FAnimNotifyEventReference& EventReference)
+{
+	Super::Notify(MeshComp, Animation, EventReference);
+
+	if(ICombatInterface* Combatant = MeshComp ? Cast<ICombatInterface>(MeshComp->GetOwner()) : nullptr)
+	{
+		Combatant->EndAction();
+	}
+}
+
+FString UAnimNotify_EndAction::GetNotifyName_Implementation() const
+{
+	return TEXT("End Action");
+}
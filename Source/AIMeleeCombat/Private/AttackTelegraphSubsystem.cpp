@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AttackTelegraphSubsystem.h"
+#include "AIMeleeCombat.h"
+#include "AIMeleeCombatSettings.h"
+#include "AI_BaseCharacter.h"
+#include "AI_UtilityComponent.h"
+#include "CombatAssetStreamer.h"
+#include "CombatArchetype.h"
+#include "Components/CapsuleComponent.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Attack Telegraphs"), STAT_AttackTelegraphs, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Telegraph Defenders Rescored"), STAT_TelegraphDefenders, STATGROUP_AIMeleeCombat);
+DECLARE_CYCLE_STAT(TEXT("Telegraph Broadcast"), STAT_TelegraphBroadcast, STATGROUP_AIMeleeCombat);
+
+static FAutoConsoleCommandWithWorld TelegraphReportCommand(
+	TEXT("AIMelee.Telegraph.Report"),
+	TEXT("Logs how many attacks were telegraphed, how many defenders were rescored & how early they reacted"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if(const UAttackTelegraphSubsystem* Telegraphs = World ? World->GetSubsystem<UAttackTelegraphSubsystem>() : nullptr)
+		{
+			Telegraphs->LogReport();
+		}
+	}));
+
+UAttackTelegraphSubsystem* UAttackTelegraphSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UAttackTelegraphSubsystem>() : nullptr;
+}
+
+void UAttackTelegraphSubsystem::BroadcastAttack(const ACharacter* Attacker, FCombatantHandle AttackerHandle, const UAnimMontage* Montage, FName Section)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TelegraphBroadcast);
+
+	const UCombatantRegistry* CombatantRegistry = UCombatantRegistry::Get(this);
+	if(Attacker == nullptr || Montage == nullptr || CombatantRegistry == nullptr) { return; }
+
+	INC_DWORD_STAT(STAT_AttackTelegraphs);
+	++NumBroadcasts;
+
+	FAttackTelegraph Telegraph;
+	Telegraph.Attacker = AttackerHandle;
+	Telegraph.Origin = Attacker->GetActorLocation();
+
+	// Timing table built when the montage streamed in, the default delay covers montages without a damage window
+	const float Now = GetWorld()->GetTimeSeconds();
+	UCombatAssetStreamer* Streamer = UCombatAssetStreamer::Get(this);
+	if(const FDamageWindowTiming* DamageWindow = Streamer ? Streamer->FindDamageWindow(Montage, Section) : nullptr)
+	{
+		Telegraph.ImpactTime = Now + DamageWindow->Start;
+		Telegraph.ImpactEndTime = Now + DamageWindow->End;
+	}
+	else
+	{
+		Telegraph.ImpactTime = Telegraph.ImpactEndTime = Now + GetDefault<UAIMeleeCombatSettings>()->TelegraphDefaultImpactDelay;
+	}
+
+	const UAIMeleeCombatSettings* Settings = GetDefault<UAIMeleeCombatSettings>();
+	const float Reach = GetAttackReach(Attacker, Montage);
+	const FVector Facing = Attacker->GetActorForwardVector().GetSafeNormal2D();
+	const float MinFacingDot = FMath::Cos(FMath::DegreesToRadians(Settings->TelegraphConeHalfAngle));
+
+	// Broadphase query over pawns, so only the AI near the attacker are looked at
+	TArray<FOverlapResult> Overlaps;
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(AttackTelegraph), false, Attacker);
+	GetWorld()->OverlapMultiByObjectType(Overlaps, Telegraph.Origin, FQuat::Identity, FCollisionObjectQueryParams(ECC_Pawn),
+		FCollisionShape::MakeSphere(Settings->TelegraphRadius), QueryParams);
+
+	for (const FOverlapResult& Overlap : Overlaps)
+	{
+		// Only the capsule counts, so a defender with other pawn components is looked up once
+		const AActor* OverlapActor = Overlap.GetActor();
+		if(OverlapActor == nullptr || Overlap.GetComponent() != OverlapActor->GetRootComponent()) { continue; }
+
+		const FCombatantHandle DefenderHandle = CombatantRegistry->FindHandle(OverlapActor);
+		if(!CombatantRegistry->IsAlive(DefenderHandle) || !CombatantRegistry->AreEnemies(DefenderHandle, AttackerHandle)) { continue; }
+
+		const AAI_BaseCharacter* Defender = CombatantRegistry->GetAICharacter(DefenderHandle);
+		if(Defender == nullptr || Defender->GetUtilityComponent() == nullptr) { continue; }
+
+		// Bystanders behind the attacker or out of its reach would block or dodge an attack that can't hit them
+		if(Defender->GetEnemyHandle() != AttackerHandle)
+		{
+			const FVector ToDefender = (Defender->GetActorLocation() - Telegraph.Origin) * FVector(1.f, 1.f, 0.f);
+			const float DefenderReach = Reach + Defender->GetCapsuleComponent()->GetScaledCapsuleRadius();
+			if(ToDefender.SizeSquared() > FMath::Square(DefenderReach)) { continue; }
+			if(!ToDefender.IsNearlyZero() && FVector::DotProduct(Facing, ToDefender.GetUnsafeNormal()) < MinFacingDot) { continue; }
+		}
+
+		INC_DWORD_STAT(STAT_TelegraphDefenders);
+		++NumDefendersNotified;
+
+		Defender->GetUtilityComponent()->OnAttackTelegraphed(Telegraph);
+	}
+}
+
+float UAttackTelegraphSubsystem::GetAttackReach(const ACharacter* Attacker, const UAnimMontage* Montage) const
+{
+	const AAI_BaseCharacter* AIAttacker = Cast<AAI_BaseCharacter>(Attacker);
+	const UCombatArchetype* Archetype = AIAttacker ? AIAttacker->GetArchetype() : nullptr;
+	if(Archetype == nullptr)
+	{
+		return GetDefault<UAIMeleeCombatSettings>()->TelegraphRadius;
+	}
+
+	return Montage == Archetype->RangedAttackMontage.Get() ? Archetype->RangedAttackRange : Archetype->AttackRange;
+}
+
+void UAttackTelegraphSubsystem::RecordDefense(float SecondsBeforeImpact)
+{
+	++NumReactions;
+	NumLateReactions += SecondsBeforeImpact < 0.f ? 1 : 0;
+	ReactionLeadSeconds += SecondsBeforeImpact;
+}
+
+void UAttackTelegraphSubsystem::LogReport() const
+{
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("%d attacks telegraphed, %d defenders rescored (%.2f per attack), %d blocks/dodges started %.0f ms before impact on average (%d after impact)"),
+		NumBroadcasts, NumDefendersNotified, NumBroadcasts > 0 ? static_cast<float>(NumDefendersNotified) / NumBroadcasts : 0.f,
+		NumReactions, NumReactions > 0 ? ReactionLeadSeconds / NumReactions * 1000.0 : 0.0, NumLateReactions);
+}
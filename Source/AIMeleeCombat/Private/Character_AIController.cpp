@@ -8,8 +8,11 @@
 #include "Perception/AISenseConfig_Sight.h"
 #include "Perception/AIPerceptionStimuliSourceComponent.h"
 #include "Perception/AIPerceptionComponent.h"
+#include "Perception/AISense_Sight.h"
+#include "CombatantRegistry.h"
 
-ACharacter_AIController::ACharacter_AIController()
+ACharacter_AIController::ACharacter_AIController() :
+	PerceptionInterval(0.f)
 {
 	NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(this);
 	AIPerception();
@@ -28,6 +31,33 @@ void ACharacter_AIController::OnPossess(APawn* InPawn)
 	if(InPawn == nullptr) { return; }
 
 	AICharacter = Cast<AAI_BaseCharacter>(InPawn);
+	CombatantRegistry = UCombatantRegistry::Get(this);
+
+	// Listener team is cached by the perception system, refresh it now that we have the pawns team
+	if(GetPerceptionComponent())
+	{
+		GetPerceptionComponent()->RequestStimuliListenerUpdate();
+	}
+}
+
+FGenericTeamId ACharacter_AIController::GetGenericTeamId() const
+{
+	return AICharacter ? AICharacter->GetGenericTeamId() : Super::GetGenericTeamId();
+}
+
+void ACharacter_AIController::SetGenericTeamId(const FGenericTeamId& NewTeamID)
+{
+	Super::SetGenericTeamId(NewTeamID);
+
+	if(AICharacter)
+	{
+		AICharacter->SetGenericTeamId(NewTeamID);
+	}
+
+	if(GetPerceptionComponent())
+	{
+		GetPerceptionComponent()->RequestStimuliListenerUpdate();
+	}
 }
 
 //void ACharacter_AIController::PatrolArea()
@@ -51,9 +81,74 @@ void ACharacter_AIController::OnPossess(APawn* InPawn)
 
 void ACharacter_AIController::OnPerceptionUpdated(AActor* Actor, FAIStimulus const Stimulus)
 {
-	if(AICharacter)
+	if(AICharacter == nullptr) { return; }
+
+	SetEnemyTarget(Actor);
+}
+
+void ACharacter_AIController::SetPerceptionInterval(float Interval)
+{
+	if(Interval == PerceptionInterval) { return; }
+
+	PerceptionInterval = Interval;
+	GetWorldTimerManager().ClearTimer(PerceptionTimerHandle);
+	GetWorldTimerManager().ClearTimer(PerceptionWindowHandle);
+
+	// Significant AI (or an interval no longer than the window) keep sight on all the time
+	if(PerceptionInterval <= PerceptionWindow)
+	{
+		SetSightEnabled(true);
+		return;
+	}
+
+	// Less significant AI only run their sight queries for one window every PerceptionInterval, what they already see is kept while it is off
+	OpenPerceptionWindow();
+	GetWorldTimerManager().SetTimer(PerceptionTimerHandle, this, &ACharacter_AIController::OpenPerceptionWindow, PerceptionInterval, true);
+}
+
+void ACharacter_AIController::OpenPerceptionWindow()
+{
+	SetSightEnabled(true);
+	GetWorldTimerManager().SetTimer(PerceptionWindowHandle, this, &ACharacter_AIController::ClosePerceptionWindow, PerceptionWindow, false);
+}
+
+void ACharacter_AIController::ClosePerceptionWindow()
+{
+	SetSightEnabled(false);
+}
+
+void ACharacter_AIController::SetSightEnabled(bool bEnabled)
+{
+	// Disabling the sense removes this listeners sight queries, so nothing is traced for it until it is enabled again
+	if(GetPerceptionComponent())
 	{
-		SetEnemyTarget(Actor);
+		GetPerceptionComponent()->SetSenseEnabled(UAISense_Sight::StaticClass(), bEnabled);
+	}
+}
+
+void ACharacter_AIController::GetPerceivedEnemies(TArray<FCombatantHandle>& OutEnemies, int32 MaxEnemies) const
+{
+	OutEnemies.Reset();
+	if(AICharacter == nullptr || CombatantRegistry == nullptr || GetPerceptionComponent() == nullptr) { return; }
+
+	TArray<AActor*> PerceivedActors;
+	GetPerceptionComponent()->GetCurrentlyPerceivedActors(UAISense_Sight::StaticClass(), PerceivedActors);
+
+	const FVector Location = AICharacter->GetActorLocation();
+	PerceivedActors.Sort([&Location](const AActor& A, const AActor& B)
+	{
+		return FVector::DistSquared(A.GetActorLocation(), Location) < FVector::DistSquared(B.GetActorLocation(), Location);
+	});
+
+	for (const AActor* Actor : PerceivedActors)
+	{
+		if(OutEnemies.Num() >= MaxEnemies) { break; }
+
+		const FCombatantHandle Handle = CombatantRegistry->FindHandle(Actor);
+		if(CombatantRegistry->IsAlive(Handle) && AICharacter->IsEnemy(Handle))
+		{
+			OutEnemies.Add(Handle);
+		}
 	}
 }
 
@@ -68,6 +163,11 @@ void ACharacter_AIController::AIPerception()
 	SightPerception->SetMaxAge(0);
 	SightPerception->AutoSuccessRangeFromLastSeenLocation = SightPerception->SightRadius + 500.0f;
 
+	// Only enemies (solved by the team attitude matrix) are reported, friendlies & neutrals are filtered out by the sight sense itself
+	SightPerception->DetectionByAffiliation.bDetectEnemies = true;
+	SightPerception->DetectionByAffiliation.bDetectNeutrals = false;
+	SightPerception->DetectionByAffiliation.bDetectFriendlies = false;
+
 	// adds SightPerception Config to PerceptionComponent
 	GetPerceptionComponent()->SetDominantSense(*SightPerception->GetSenseImplementation());
 	GetPerceptionComponent()->OnTargetPerceptionUpdated.AddDynamic(this, &ACharacter_AIController::OnPerceptionUpdated);
@@ -76,10 +176,14 @@ void ACharacter_AIController::AIPerception()
 
 void ACharacter_AIController::SetEnemyTarget(AActor* Target)
 {
-	if(AICharacter)
+	if(AICharacter && CombatantRegistry)
 	{
-		if(AICharacter->IsEnemy(Target))
+		// Handle lookup instead of casting the perceived actor to the player/AI class
+		const FCombatantHandle TargetHandle = CombatantRegistry->FindHandle(Target);
+		if(AICharacter->IsEnemy(TargetHandle))
 		{
+			AICharacter->SetEnemy(TargetHandle);
+
 			// Sets enemy detected to true if the target within sight radius is an enemy
 			AICharacter->SetEnemyDetected(true);
 		}
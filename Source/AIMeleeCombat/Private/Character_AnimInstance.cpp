@@ -11,71 +11,57 @@
 UCharacter_AnimInstance::UCharacter_AnimInstance() :
 	Speed(0.f),
 	Direction(0.f),
-	bIsAccelerating(false)
+	bIsAccelerating(false),
+	OwnerVelocity(FVector::ZeroVector),
+	OwnerAcceleration(FVector::ZeroVector),
+	OwnerRotation(FRotator::ZeroRotator)
 {
 }
 
 // BeginPlay()
 void UCharacter_AnimInstance::NativeInitializeAnimation()
 {
-	AICharacter = Cast<AAI_BaseCharacter>(TryGetPawnOwner());
-	PlayerCharacter = Cast<APlayerCharacter>(TryGetPawnOwner());
+	Super::NativeInitializeAnimation();
+
+	// Owner type is resolved once here instead of being retried every frame
+	OwnerCharacter = Cast<ACharacter>(TryGetPawnOwner());
+	OwnerMovement = OwnerCharacter ? OwnerCharacter->GetCharacterMovement() : nullptr;
+	AICharacter = Cast<AAI_BaseCharacter>(OwnerCharacter);
+	PlayerCharacter = AICharacter ? nullptr : Cast<APlayerCharacter>(OwnerCharacter);
 }
 
-// Tick()
 void UCharacter_AnimInstance::UpdateAnimationProperties(float DeltaTime)
 {
-	if(AICharacter == nullptr)
-	{
-		AICharacter = Cast<AAI_BaseCharacter>(TryGetPawnOwner());
-	}
+}
 
-	if(PlayerCharacter == nullptr)
-	{
-		PlayerCharacter = Cast<APlayerCharacter>(TryGetPawnOwner());
-	}
+// Tick() (game thread)
+void UCharacter_AnimInstance::NativeUpdateAnimation(float DeltaSeconds)
+{
+	Super::NativeUpdateAnimation(DeltaSeconds);
 
-	if(AICharacter)
-	{
-		// Set Speed based on Characters current Velocity
-		FVector Velocity{ AICharacter->GetVelocity() };
-		Velocity.Z = 0;
-		Speed = Velocity.Size();
+	if(OwnerCharacter == nullptr || OwnerMovement == nullptr) { return; }
 
-		// Check to see if Character is accelerating (used for transitioning anim state between idle/run)
-		if(AICharacter->GetCharacterMovement()->GetCurrentAcceleration().Size() > 0)
-		{
-			bIsAccelerating = true;
-		}
-		else
-		{
-			bIsAccelerating = false;
-		}
+	OwnerVelocity = OwnerCharacter->GetVelocity();
+	OwnerAcceleration = OwnerMovement->GetCurrentAcceleration();
+	OwnerRotation = OwnerCharacter->GetActorRotation();
+}
 
-		// Gets characters current velocity to determine direction to apply (used for strafing when choosing which animation to play in the Anim Blend Space)
-		FRotator MovementRotation = UKismetMathLibrary::MakeRotFromX(AICharacter->GetVelocity());
-		Direction = UKismetMathLibrary::NormalizedDeltaRotator(MovementRotation, AICharacter->GetActorRotation()).Yaw;
-	}
+// Tick() (animation worker thread, must not touch the owner)
+void UCharacter_AnimInstance::NativeThreadSafeUpdateAnimation(float DeltaSeconds)
+{
+	Super::NativeThreadSafeUpdateAnimation(DeltaSeconds);
+
+	if(OwnerCharacter == nullptr) { return; }
 
-	if(PlayerCharacter)
-	{
-		// Set Speed based on Characters current Velocity
-		FVector Velocity{ PlayerCharacter->GetVelocity() };
-		Velocity.Z = 0;
-		Speed = Velocity.Size();
+	// Set Speed based on Characters current Velocity
+	FVector Velocity{ OwnerVelocity };
+	Velocity.Z = 0;
+	Speed = Velocity.Size();
 
-		// Check to see if Character is accelerating (used for transitioning anim state between idle/run)
-		if(PlayerCharacter->GetCharacterMovement()->GetCurrentAcceleration().Size() > 0)
-		{
-			bIsAccelerating = true;
-		}
-		else
-		{
-			bIsAccelerating = false;
-		}
+	// Check to see if Character is accelerating (used for transitioning anim state between idle/run)
+	bIsAccelerating = OwnerAcceleration.SizeSquared() > 0;
 
-		// Gets characters current velocity to determine direction to apply (used for strafing when choosing which animation to play in the Anim Blend Space)
-		FRotator MovementRotation = UKismetMathLibrary::MakeRotFromX(PlayerCharacter->GetVelocity());
-		Direction = UKismetMathLibrary::NormalizedDeltaRotator(MovementRotation, PlayerCharacter->GetActorRotation()).Yaw;
-	}
-}
\ No newline at end of file
+	// Gets characters current velocity to determine direction to apply (used for strafing when choosing which animation to play in the Anim Blend Space)
+	const FRotator MovementRotation = UKismetMathLibrary::MakeRotFromX(OwnerVelocity);
+	Direction = UKismetMathLibrary::NormalizedDeltaRotator(MovementRotation, OwnerRotation).Yaw;
+}
@@ -0,0 +1,181 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatArchetype.h"
+#include "AIMeleeCombat.h"
+#include "AI_BaseCharacter.h"
+#include "AI_UtilityComponent.h"
+#include "Engine/DataTable.h"
+#include "Curves/CurveFloat.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#if WITH_EDITOR
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Misc/PackageName.h"
+#endif
+
+static FAutoConsoleCommandWithWorld ArchetypeReportCommand(
+	TEXT("AIMelee.Archetype.Report"),
+	TEXT("Logs the per instance size of the AI classes & how many AI share each combat archetype"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if(World == nullptr) { return; }
+
+		TMap<const UCombatArchetype*, int32> InstancesPerArchetype;
+		TMap<const UClass*, int32> InstancesPerClass;
+		for (TActorIterator<AAI_BaseCharacter> It(World); It; ++It)
+		{
+			InstancesPerArchetype.FindOrAdd(It->GetArchetype())++;
+			InstancesPerClass.FindOrAdd(It->GetClass())++;
+		}
+
+		UE_LOG(LogAIMeleeCombat, Log, TEXT("AAI_BaseCharacter: %d bytes, UAI_UtilityComponent: %d bytes, UCombatArchetype: %d bytes"),
+			AAI_BaseCharacter::StaticClass()->GetPropertiesSize(), UAI_UtilityComponent::StaticClass()->GetPropertiesSize(), UCombatArchetype::StaticClass()->GetPropertiesSize());
+
+		for (const TPair<const UClass*, int32>& Class : InstancesPerClass)
+		{
+			UE_LOG(LogAIMeleeCombat, Log, TEXT("  %s: %d instances x %d bytes"), *Class.Key->GetName(), Class.Value, Class.Key->GetPropertiesSize());
+		}
+		for (const TPair<const UCombatArchetype*, int32>& Archetype : InstancesPerArchetype)
+		{
+			UE_LOG(LogAIMeleeCombat, Log, TEXT("  %s: shared by %d instances"), Archetype.Key ? *Archetype.Key->GetPathName() : TEXT("None"), Archetype.Value);
+		}
+	}));
+
+#if WITH_EDITOR
+// Turns the deprecated per instance values of placed AI into saved archetype assets, so cooked builds never need a stand in
+static FAutoConsoleCommandWithWorld MigrateLegacyArchetypesCommand(
+	TEXT("AIMelee.Archetype.MigrateLegacy"),
+	TEXT("Creates a UCombatArchetype asset under /Game/AI/Archetypes for every set of old per instance values on placed AI without an archetype & assigns it (save the level & new assets afterwards)"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if(World == nullptr || World->IsGameWorld())
+		{
+			UE_LOG(LogAIMeleeCombat, Warning, TEXT("AIMelee.Archetype.MigrateLegacy only runs on an editor world"));
+			return;
+		}
+
+		TArray<UCombatArchetype*> Created;
+		int32 NumMigrated = 0;
+		for (TActorIterator<AAI_BaseCharacter> It(World); It; ++It)
+		{
+			AAI_BaseCharacter* AICharacter = *It;
+			if(AICharacter->GetArchetype()) { continue; }
+
+			// AI with the same old values share one asset, like they would have if they had been made with archetypes
+			UCombatArchetype* const* Match = Created.FindByPredicate([AICharacter](const UCombatArchetype* Candidate)
+			{
+				return AICharacter->MatchesLegacyArchetype(*Candidate);
+			});
+
+			UCombatArchetype* Archetype = Match ? *Match : nullptr;
+			if(Archetype == nullptr)
+			{
+				FString AssetName = AICharacter->GetClass()->GetName();
+				AssetName.RemoveFromEnd(TEXT("_C"));
+				AssetName += TEXT("_Archetype");
+
+				FString PackageName = TEXT("/Game/AI/Archetypes/") + AssetName;
+				for (int32 Suffix = 1; FindPackage(nullptr, *PackageName) || FPackageName::DoesPackageExist(PackageName); ++Suffix)
+				{
+					PackageName = FString::Printf(TEXT("/Game/AI/Archetypes/%s_%d"), *AssetName, Suffix);
+				}
+
+				UPackage* Package = CreatePackage(*PackageName);
+				Archetype = AICharacter->BuildLegacyArchetype(Package, *FPackageName::GetShortName(PackageName), RF_Public | RF_Standalone);
+				Archetype->BakeConsiderations();
+				FAssetRegistryModule::AssetCreated(Archetype);
+				Package->MarkPackageDirty();
+				Created.Add(Archetype);
+			}
+
+			AICharacter->Modify();
+			AICharacter->SetArchetype(Archetype);
+			++NumMigrated;
+		}
+
+		UE_LOG(LogAIMeleeCombat, Log, TEXT("Migrated %d AI to %d new combat archetypes, save the level & the new assets"), NumMigrated, Created.Num());
+	}));
+#endif
+
+UCombatArchetype::UCombatArchetype() :
+	MaxHealth(300.f),
+	AttackRange(250.f),
+	RangedAttackRange(350.f),
+	bIsAggressive(false),
+	ProjectileSpeed(2500.f),
+	ProjectileDamage(20.f),
+	ProjectileRadius(8.f),
+	ProjectileGravityScale(0.f),
+	AbstractDamagePerSecond(15.f),
+	AbstractBlockChance(0.2f),
+	AbstractDodgeChance(0.1f),
+	bCanPatrol(false),
+	PatrolRadius(1000.f),
+	CombatBehaviorData(nullptr),
+	bUseCombatPlanner(false)
+{
+}
+
+FPrimaryAssetId UCombatArchetype::GetPrimaryAssetId() const
+{
+	return FPrimaryAssetId(TEXT("CombatArchetype"), GetFName());
+}
+
+void UCombatArchetype::PostLoad()
+{
+	Super::PostLoad();
+
+	BakeConsiderations();
+}
+
+#if WITH_EDITOR
+void UCombatArchetype::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	BakeConsiderations();
+}
+#endif
+
+void UCombatArchetype::BakeConsiderations()
+{
+	for (int32 AbilityIndex = 0; AbilityIndex < static_cast<int32>(EUtilityAbility::EUA_MAX); ++AbilityIndex)
+	{
+		const FUtilityConsiderationSet* Set = Considerations.Find(static_cast<EUtilityAbility>(AbilityIndex));
+		if(Set == nullptr)
+		{
+			BakedConsiderations[AbilityIndex] = FBakedConsiderationSet();
+			continue;
+		}
+
+		// Curve assets may not have finished loading when the archetype is post loaded
+		for (const FUtilityConsideration& Consideration : Set->Considerations)
+		{
+			if(Consideration.Curve)
+			{
+				Consideration.Curve->ConditionalPostLoad();
+			}
+		}
+		BakedConsiderations[AbilityIndex].Bake(*Set);
+	}
+}
+
+void UCombatArchetype::GetMontagePaths(TArray<FSoftObjectPath>& OutPaths) const
+{
+	for (const TSoftObjectPtr<UAnimMontage>* Montage : { &AttackMontage, &RangedAttackMontage, &UltimateAttackMontage, &BlockingMontage, &DodgingMontage, &DeathMontage })
+	{
+		if(!Montage->IsNull())
+		{
+			OutPaths.AddUnique(Montage->ToSoftObjectPath());
+		}
+	}
+}
+
+const FCombatBehavior* UCombatArchetype::FindCombatBehavior() const
+{
+	if(CombatBehaviorData == nullptr) { return nullptr; }
+
+	const FString ContextString = RowName.ToString();
+	return CombatBehaviorData->FindRow<FCombatBehavior>(RowName, ContextString, true);
+}
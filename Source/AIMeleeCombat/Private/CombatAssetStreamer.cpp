@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatAssetStreamer.h"
+#include "AIMeleeCombat.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "Animation/AnimMontage.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Streamed Asset Sets"), STAT_StreamedAssetSets, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Montage Timing Tables"), STAT_MontageTimingTables, STATGROUP_AIMeleeCombat);
+
+static FAutoConsoleCommandWithWorld StreamingReportCommand(
+	TEXT("AIMelee.Streaming.Report"),
+	TEXT("Logs the streamed combat montages with their reference counts, load times & resident sizes"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if(const UCombatAssetStreamer* Streamer = World ? World->GetSubsystem<UCombatAssetStreamer>() : nullptr)
+		{
+			Streamer->LogReport();
+		}
+	}));
+
+UCombatAssetStreamer* UCombatAssetStreamer::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UCombatAssetStreamer>() : nullptr;
+}
+
+void UCombatAssetStreamer::Acquire(const UObject* Owner, const TArray<FSoftObjectPath>& Assets, FSimpleDelegate OnLoaded)
+{
+	if(Owner == nullptr) { return; }
+
+	const FObjectKey OwnerKey(Owner);
+	FStreamedAssets* Streamed = StreamedAssets.Find(OwnerKey);
+	if(Streamed == nullptr)
+	{
+		Streamed = &StreamedAssets.Add(OwnerKey);
+		Streamed->OwnerName = Owner->GetName();
+		Streamed->RequestTime = FPlatformTime::Seconds();
+
+		if(Assets.Num() > 0)
+		{
+			Streamed->Handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Assets,
+				FStreamableDelegate::CreateUObject(this, &UCombatAssetStreamer::OnAssetsLoaded, OwnerKey), FStreamableManager::AsyncLoadHighPriority);
+		}
+
+		SET_DWORD_STAT(STAT_StreamedAssetSets, StreamedAssets.Num());
+
+		// Already resident (or nothing to load), the delegate above has either fired already or won't fire at all
+		if(!Streamed->Handle.IsValid() || Streamed->Handle->HasLoadCompleted())
+		{
+			Streamed->bLoaded = true;
+			if(Streamed->Handle.IsValid())
+			{
+				BuildMontageTimings(*Streamed->Handle);
+			}
+		}
+	}
+
+	++Streamed->RefCount;
+
+	if(OnLoaded.IsBound())
+	{
+		if(Streamed->bLoaded)
+		{
+			OnLoaded.Execute();
+		}
+		else
+		{
+			Streamed->WaitingForLoad.Add(MoveTemp(OnLoaded));
+		}
+	}
+}
+
+void UCombatAssetStreamer::OnAssetsLoaded(FObjectKey Owner)
+{
+	FStreamedAssets* Streamed = StreamedAssets.Find(Owner);
+	if(Streamed == nullptr || Streamed->bLoaded) { return; }
+
+	Streamed->bLoaded = true;
+	Streamed->LoadSeconds = FPlatformTime::Seconds() - Streamed->RequestTime;
+
+	if(Streamed->Handle.IsValid())
+	{
+		BuildMontageTimings(*Streamed->Handle);
+	}
+
+	// Moved out first as a callback may acquire or release other asset sets
+	TArray<FSimpleDelegate> WaitingForLoad = MoveTemp(Streamed->WaitingForLoad);
+	for (FSimpleDelegate& Delegate : WaitingForLoad)
+	{
+		Delegate.ExecuteIfBound();
+	}
+}
+
+void UCombatAssetStreamer::Release(const UObject* Owner)
+{
+	const FObjectKey OwnerKey(Owner);
+	FStreamedAssets* Streamed = StreamedAssets.Find(OwnerKey);
+	if(Streamed == nullptr || --Streamed->RefCount > 0) { return; }
+
+	if(Streamed->Handle.IsValid())
+	{
+		Streamed->Handle->ReleaseHandle();
+	}
+	StreamedAssets.Remove(OwnerKey);
+
+	SET_DWORD_STAT(STAT_StreamedAssetSets, StreamedAssets.Num());
+}
+
+void UCombatAssetStreamer::BuildMontageTimings(const FStreamableHandle& Handle)
+{
+	TArray<UObject*> LoadedAssets;
+	Handle.GetLoadedAssets(LoadedAssets);
+	for (const UObject* Asset : LoadedAssets)
+	{
+		const UAnimMontage* Montage = Cast<UAnimMontage>(Asset);
+		if(Montage && !MontageTimings.Contains(FObjectKey(Montage)))
+		{
+			MontageTimings.Add(FObjectKey(Montage), FMontageTimingTable::Build(Montage));
+		}
+	}
+
+	SET_DWORD_STAT(STAT_MontageTimingTables, MontageTimings.Num());
+}
+
+const FDamageWindowTiming* UCombatAssetStreamer::FindDamageWindow(const UAnimMontage* Montage, FName Section)
+{
+	if(Montage == nullptr) { return nullptr; }
+
+	const FObjectKey MontageKey(Montage);
+	const FMontageTimingTable* Table = MontageTimings.Find(MontageKey);
+	if(Table == nullptr)
+	{
+		Table = &MontageTimings.Add(MontageKey, FMontageTimingTable::Build(Montage));
+		SET_DWORD_STAT(STAT_MontageTimingTables, MontageTimings.Num());
+	}
+
+	return Table->FindSection(Section);
+}
+
+bool UCombatAssetStreamer::IsLoaded(const UObject* Owner) const
+{
+	const FStreamedAssets* Streamed = StreamedAssets.Find(FObjectKey(Owner));
+	return Streamed && Streamed->bLoaded;
+}
+
+void UCombatAssetStreamer::LogReport() const
+{
+	int64 TotalBytes = 0;
+	for (const TPair<FObjectKey, FStreamedAssets>& Pair : StreamedAssets)
+	{
+		const FStreamedAssets& Streamed = Pair.Value;
+
+		int64 ResidentBytes = 0;
+		int32 NumAssets = 0;
+		if(Streamed.Handle.IsValid())
+		{
+			TArray<UObject*> LoadedAssets;
+			Streamed.Handle->GetLoadedAssets(LoadedAssets);
+			for (const UObject* Asset : LoadedAssets)
+			{
+				ResidentBytes += Asset ? Asset->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal) : 0;
+			}
+			NumAssets = LoadedAssets.Num();
+		}
+		TotalBytes += ResidentBytes;
+
+		UE_LOG(LogAIMeleeCombat, Log, TEXT("%s: %d refs, %s, %d assets, %.1f KB resident, loaded in %.1f ms"),
+			*Streamed.OwnerName, Streamed.RefCount, Streamed.bLoaded ? TEXT("loaded") : TEXT("loading"), NumAssets, ResidentBytes / 1024.0, Streamed.LoadSeconds * 1000.0);
+	}
+
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("%d streamed asset sets, %.1f KB resident, %d montage timing tables"), StreamedAssets.Num(), TotalBytes / 1024.0, MontageTimings.Num());
+}
+
+void UCombatAssetStreamer::Deinitialize()
+{
+	for (TPair<FObjectKey, FStreamedAssets>& Pair : StreamedAssets)
+	{
+		if(Pair.Value.Handle.IsValid())
+		{
+			Pair.Value.Handle->ReleaseHandle();
+		}
+	}
+	StreamedAssets.Empty();
+	MontageTimings.Empty();
+
+	Super::Deinitialize();
+}
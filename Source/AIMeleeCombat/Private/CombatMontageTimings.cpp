@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatMontageTimings.h"
+#include "AnimNotifyState_DamageWindow.h"
+#include "Animation/AnimMontage.h"
+
+FMontageTimingTable FMontageTimingTable::Build(const UAnimMontage* Montage)
+{
+	FMontageTimingTable Table;
+	if(Montage == nullptr) { return Table; }
+
+	const float RateScale = Montage->RateScale > 0.f ? Montage->RateScale : 1.f;
+
+	for (const FAnimNotifyEvent& Notify : Montage->Notifies)
+	{
+		if(!Cast<UAnimNotifyState_DamageWindow>(Notify.NotifyStateClass)) { continue; }
+
+		const float TriggerTime = Notify.GetTriggerTime();
+		const int32 SectionIndex = Montage->GetSectionIndexFromPosition(TriggerTime);
+		if(SectionIndex == INDEX_NONE) { continue; }
+
+		float SectionStart = 0.f;
+		float SectionEnd = 0.f;
+		Montage->GetSectionStartAndEndTime(SectionIndex, SectionStart, SectionEnd);
+
+		const float Start = (TriggerTime - SectionStart) / RateScale;
+		const float End = (FMath::Min(Notify.GetEndTriggerTime(), SectionEnd) - SectionStart) / RateScale;
+
+		// Sections with more than one window (combo hits) keep the span from the first opening to the last closing
+		const FName SectionName = Montage->GetSectionName(SectionIndex);
+		if(FDamageWindowTiming* Existing = Table.Sections.Find(SectionName))
+		{
+			Existing->Start = FMath::Min(Existing->Start, Start);
+			Existing->End = FMath::Max(Existing->End, End);
+		}
+		else
+		{
+			Table.Sections.Add(SectionName, FDamageWindowTiming{ Start, End });
+		}
+	}
+
+	return Table;
+}
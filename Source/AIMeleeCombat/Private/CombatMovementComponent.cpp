@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatMovementComponent.h"
+#include "AIMeleeCombat.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Facing Updates (Movement)"), STAT_FacingMovementUpdates, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Facing Updates (Actor Tick)"), STAT_FacingTickUpdates, STATGROUP_AIMeleeCombat);
+
+namespace
+{
+	// Totals since the last AIMelee.Facing.Report
+	int64 MovementFacingUpdates = 0;
+	int64 TickFacingUpdates = 0;
+	uint64 ReportStartFrame = 0;
+}
+
+static FAutoConsoleCommand FacingReportCommand(
+	TEXT("AIMelee.Facing.Report"),
+	TEXT("Logs the component transform updates made for facing per frame since the last report (toggle AIMelee.Facing.UseMovement between reports to compare)"),
+	FConsoleCommandDelegate::CreateStatic(&UCombatMovementComponent::LogReport));
+
+UCombatMovementComponent::UCombatMovementComponent() :
+	FacingTurnRate(0.f)
+{
+}
+
+void UCombatMovementComponent::SetFacingTarget(const AActor* Target)
+{
+	FacingTarget = Target;
+}
+
+void UCombatMovementComponent::PhysicsRotation(float DeltaTime)
+{
+	const AActor* Target = FacingTarget.Get();
+	if(Target == nullptr || UpdatedComponent == nullptr)
+	{
+		Super::PhysicsRotation(DeltaTime);
+		return;
+	}
+
+	const FRotator CurrentRotation = UpdatedComponent->GetComponentRotation();
+	const FVector ToTarget = Target->GetActorLocation() - UpdatedComponent->GetComponentLocation();
+	if(ToTarget.IsNearlyZero()) { return; }
+
+	const float TargetYaw = ToTarget.Rotation().Yaw;
+	FRotator DesiredRotation = CurrentRotation;
+	DesiredRotation.Yaw = FacingTurnRate > 0.f ? FMath::FixedTurn(CurrentRotation.Yaw, TargetYaw, FacingTurnRate * DeltaTime) : TargetYaw;
+
+	if(CurrentRotation.Equals(DesiredRotation, FacingTolerance)) { return; }
+
+	// Runs inside PerformMovements scoped movement update, so the transform & overlaps are updated once with the rest of the move
+	MoveUpdatedComponent(FVector::ZeroVector, DesiredRotation, false);
+
+	INC_DWORD_STAT(STAT_FacingMovementUpdates);
+	++MovementFacingUpdates;
+}
+
+void UCombatMovementComponent::CountTickFacingUpdate()
+{
+	INC_DWORD_STAT(STAT_FacingTickUpdates);
+	++TickFacingUpdates;
+}
+
+void UCombatMovementComponent::LogReport()
+{
+	const uint64 NumFrames = FMath::Max<uint64>(GFrameCounter - ReportStartFrame, 1);
+
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("Facing over %llu frames: %.2f rotations/frame inside the movement update, %.2f separate SetWorldRotation updates/frame from actor tick"),
+		NumFrames, static_cast<double>(MovementFacingUpdates) / NumFrames, static_cast<double>(TickFacingUpdates) / NumFrames);
+
+	MovementFacingUpdates = 0;
+	TickFacingUpdates = 0;
+	ReportStartFrame = GFrameCounter;
+}
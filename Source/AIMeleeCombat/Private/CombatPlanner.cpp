@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatPlanner.h"
+
+namespace CombatDomain
+{
+	constexpr uint16 Bit(ECombatFact Fact) { return FCombatWorldState::Mask(Fact); }
+
+	constexpr uint16 EnemyDetected = Bit(ECombatFact::EnemyDetected);
+	constexpr uint16 InAttackRange = Bit(ECombatFact::InAttackRange);
+	constexpr uint16 InRangedAttackRange = Bit(ECombatFact::InRangedAttackRange);
+	constexpr uint16 EnemyAttacking = Bit(ECombatFact::EnemyAttacking);
+	constexpr uint16 CanStrafe = Bit(ECombatFact::CanStrafe);
+	constexpr uint16 CanBlock = Bit(ECombatFact::CanBlock);
+	constexpr uint16 CanDodge = Bit(ECombatFact::CanDodge);
+	constexpr uint16 Aggressive = Bit(ECombatFact::Aggressive);
+	constexpr uint16 HasRangedAttack = Bit(ECombatFact::HasRangedAttack);
+	constexpr uint16 HasUltimateAttack = Bit(ECombatFact::HasUltimateAttack);
+
+	// Primitive tasks are the utility abilities (same indices), compound tasks follow them
+	enum class ETask : uint8
+	{
+		Seek, Strafe, Attack, RangedAttack, UltimateAttack, Dodge, Block,
+		Engage, Approach, Defend, Finisher,
+		None
+	};
+
+	constexpr int32 NumPrimitives = static_cast<int32>(ETask::Engage);
+	static_assert(NumPrimitives == static_cast<int32>(EUtilityAbility::EUA_MAX), "Primitive tasks must match EUtilityAbility");
+
+	struct FPrimitive
+	{
+		uint16 Required;
+		uint16 Forbidden;
+		uint16 Added;
+		uint16 Removed;
+		bool bDurative;
+	};
+
+	// Indexed by EUtilityAbility, same requirements as the step conditions of the utility scores
+	constexpr FPrimitive Primitives[NumPrimitives] =
+	{
+		//                  Required                                              Forbidden      Added          Removed                       Durative
+		/* Seek */        { EnemyDetected | Aggressive,                          InAttackRange, InAttackRange, InRangedAttackRange,          true },
+		/* Strafe */      { EnemyDetected | CanStrafe,                           0,             0,             CanStrafe,                    false },
+		/* Attack */      { EnemyDetected | InAttackRange,                       0,             0,             0,                            false },
+		/* Ranged */      { EnemyDetected | InRangedAttackRange | HasRangedAttack, 0,           0,             0,                            false },
+		/* Ultimate */    { EnemyDetected | InAttackRange | HasUltimateAttack,   0,             0,             0,                            false },
+		/* Dodge */       { CanDodge,                                            0,             0,             CanDodge | EnemyAttacking,    false },
+		/* Block */       { CanBlock,                                            0,             0,             CanBlock | EnemyAttacking,    false },
+	};
+
+	constexpr int32 MaxSubtasks = 3;
+
+	struct FMethod
+	{
+		ETask Task;
+		const TCHAR* Name;
+		uint16 Required;
+		uint16 Forbidden;
+		ETask Subtasks[MaxSubtasks];
+	};
+
+	// Methods of each compound task in the order they are tried, the first one that fully decomposes wins
+	const FMethod Methods[] =
+	{
+		{ ETask::Engage, TEXT("Defend"), EnemyAttacking, 0, { ETask::Defend, ETask::None, ETask::None } },
+		// The strafe is a feint, stepping out of rhythm before the finisher
+		{ ETask::Engage, TEXT("StrikeFeintFinish"), EnemyDetected | InAttackRange, 0, { ETask::Attack, ETask::Strafe, ETask::Finisher } },
+		{ ETask::Engage, TEXT("StrikeFinish"), EnemyDetected | InAttackRange, 0, { ETask::Attack, ETask::Finisher, ETask::None } },
+		{ ETask::Engage, TEXT("ApproachAndStrike"), EnemyDetected | Aggressive, InAttackRange, { ETask::Approach, ETask::Attack, ETask::Finisher } },
+		{ ETask::Engage, TEXT("Poke"), EnemyDetected | InRangedAttackRange, 0, { ETask::RangedAttack, ETask::None, ETask::None } },
+
+		{ ETask::Approach, TEXT("Flank"), CanStrafe, 0, { ETask::Strafe, ETask::Seek, ETask::None } },
+		{ ETask::Approach, TEXT("Direct"), 0, 0, { ETask::Seek, ETask::None, ETask::None } },
+
+		{ ETask::Defend, TEXT("Block"), CanBlock, 0, { ETask::Block, ETask::None, ETask::None } },
+		{ ETask::Defend, TEXT("Dodge"), CanDodge, 0, { ETask::Dodge, ETask::None, ETask::None } },
+
+		{ ETask::Finisher, TEXT("Ultimate"), HasUltimateAttack, 0, { ETask::UltimateAttack, ETask::None, ETask::None } },
+		{ ETask::Finisher, TEXT("Combo"), 0, 0, { ETask::Attack, ETask::None, ETask::None } },
+	};
+
+	// Compound tasks only nest a couple of levels, this just stops a bad method table recursing forever
+	constexpr int32 MaxDepth = 4;
+
+	bool Decompose(ETask Task, FCombatWorldState& State, FCombatPlan& Plan, int32 Depth)
+	{
+		const int32 TaskIndex = static_cast<int32>(Task);
+		if(TaskIndex < NumPrimitives)
+		{
+			const FPrimitive& Primitive = Primitives[TaskIndex];
+			if(!State.Meets(Primitive.Required, Primitive.Forbidden)) { return false; }
+
+			FCombatPlanStep& Step = Plan.Steps.AddDefaulted_GetRef();
+			Step.Ability = static_cast<EUtilityAbility>(TaskIndex);
+			Step.Required = Primitive.Required;
+			Step.Forbidden = Primitive.Forbidden;
+			Step.Added = Primitive.Added;
+			Step.Removed = Primitive.Removed;
+			Step.bDurative = Primitive.bDurative;
+
+			State.Apply(Primitive.Added, Primitive.Removed);
+			return true;
+		}
+
+		if(Depth >= MaxDepth) { return false; }
+
+		for (const FMethod& Method : Methods)
+		{
+			if(Method.Task != Task || !State.Meets(Method.Required, Method.Forbidden)) { continue; }
+
+			// Backtracks to the state before this method if one of its subtasks can't be decomposed
+			const FCombatWorldState SavedState = State;
+			const int32 SavedNumSteps = Plan.Steps.Num();
+
+			bool bDecomposed = true;
+			for (const ETask Subtask : Method.Subtasks)
+			{
+				if(Subtask != ETask::None && !Decompose(Subtask, State, Plan, Depth + 1))
+				{
+					bDecomposed = false;
+					break;
+				}
+			}
+
+			if(bDecomposed)
+			{
+				if(Depth == 0)
+				{
+					Plan.MethodName = Method.Name;
+				}
+				return true;
+			}
+
+			State = SavedState;
+			Plan.Steps.SetNum(SavedNumSteps, false);
+		}
+		return false;
+	}
+}
+
+bool FCombatPlanner::Plan(FCombatWorldState State, FCombatPlan& OutPlan)
+{
+	OutPlan.Steps.Reset();
+	OutPlan.MethodName = TEXT("None");
+
+	return CombatDomain::Decompose(CombatDomain::ETask::Engage, State, OutPlan, 0) && OutPlan.Steps.Num() > 0;
+}
@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatPlannerSubsystem.h"
+#include "AIMeleeCombat.h"
+#include "CombatArchetype.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Planner Plan"), STAT_PlannerPlan, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plan Cache Hits"), STAT_PlanCacheHits, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plan Cache Misses"), STAT_PlanCacheMisses, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Plan Replans"), STAT_PlanReplans, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Cached Plans"), STAT_CachedPlans, STATGROUP_AIMeleeCombat);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Plan Cache Hit Rate"), STAT_PlanCacheHitRate, STATGROUP_AIMeleeCombat);
+
+static FAutoConsoleCommandWithWorld PlannerReportCommand(
+	TEXT("AIMelee.Planner.Report"),
+	TEXT("Logs the number of cached combat plans, the plan cache hit rate, replans & average planning time"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if(const UCombatPlannerSubsystem* Planner = World ? World->GetSubsystem<UCombatPlannerSubsystem>() : nullptr)
+		{
+			Planner->LogReport();
+		}
+	}));
+
+UCombatPlannerSubsystem* UCombatPlannerSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UCombatPlannerSubsystem>() : nullptr;
+}
+
+TSharedPtr<const FCombatPlan> UCombatPlannerSubsystem::FindOrPlan(const UCombatArchetype* Archetype, FCombatWorldState State)
+{
+	FPlanKey Key;
+	Key.Archetype = FObjectKey(Archetype);
+	Key.StateBits = State.Bits;
+
+	if(const TSharedPtr<const FCombatPlan>* Cached = Plans.Find(Key))
+	{
+		++CacheHits;
+		INC_DWORD_STAT(STAT_PlanCacheHits);
+		SET_FLOAT_STAT(STAT_PlanCacheHitRate, static_cast<double>(CacheHits) / (CacheHits + CacheMisses));
+		return *Cached;
+	}
+
+	++CacheMisses;
+	INC_DWORD_STAT(STAT_PlanCacheMisses);
+
+	TSharedPtr<FCombatPlan> Plan = MakeShared<FCombatPlan>();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_PlannerPlan);
+
+		const double StartTime = FPlatformTime::Seconds();
+		if(!FCombatPlanner::Plan(State, *Plan))
+		{
+			Plan.Reset();
+		}
+		PlanSeconds += FPlatformTime::Seconds() - StartTime;
+	}
+
+	Plans.Add(Key, Plan);
+	SET_DWORD_STAT(STAT_CachedPlans, Plans.Num());
+	SET_FLOAT_STAT(STAT_PlanCacheHitRate, static_cast<double>(CacheHits) / (CacheHits + CacheMisses));
+	return Plan;
+}
+
+void UCombatPlannerSubsystem::RecordReplan()
+{
+	++Replans;
+	INC_DWORD_STAT(STAT_PlanReplans);
+}
+
+void UCombatPlannerSubsystem::LogReport() const
+{
+	const int64 Lookups = CacheHits + CacheMisses;
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("%d cached plans, %lld lookups, %.1f%% hit rate, %lld replans, %.2f us per plan"),
+		Plans.Num(), Lookups, Lookups > 0 ? 100.0 * CacheHits / Lookups : 0.0, Replans, CacheMisses > 0 ? PlanSeconds / CacheMisses * 1000000.0 : 0.0);
+
+	for (const TPair<FPlanKey, TSharedPtr<const FCombatPlan>>& Pair : Plans)
+	{
+		const UCombatArchetype* Archetype = Cast<UCombatArchetype>(Pair.Key.Archetype.ResolveObjectPtr());
+
+		FString Steps;
+		if(Pair.Value.IsValid())
+		{
+			for (const FCombatPlanStep& Step : Pair.Value->Steps)
+			{
+				Steps += FString::Printf(TEXT("%s%s"), Steps.IsEmpty() ? TEXT("") : TEXT(", "), *UEnum::GetDisplayValueAsText(Step.Ability).ToString());
+			}
+		}
+
+		UE_LOG(LogAIMeleeCombat, Log, TEXT("  %s 0x%04x: %s [%s]"), Archetype ? *Archetype->GetName() : TEXT("None"), Pair.Key.StateBits,
+			Pair.Value.IsValid() ? Pair.Value->MethodName : TEXT("no plan"), *Steps);
+	}
+}
+
+void UCombatPlannerSubsystem::Deinitialize()
+{
+	Plans.Empty();
+
+	Super::Deinitialize();
+}
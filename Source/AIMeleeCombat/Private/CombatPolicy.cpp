@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatPolicy.h"
+#include "AIMeleeCombat.h"
+#include "UtilityConsiderations.h"
+#include "Math/VectorRegister.h"
+
+namespace
+{
+	constexpr int32 SimdWidth = 4;
+	constexpr int32 NumPolicyOutputs = static_cast<int32>(EUtilityAbility::EUA_MAX);
+}
+
+bool FCombatPolicyNetwork::Build(const UCombatPolicyModel& Model)
+{
+	Reset();
+
+	int32 LayerInputs = NumInputs;
+	for (int32 LayerIndex = 0; LayerIndex < Model.Layers.Num(); ++LayerIndex)
+	{
+		const FCombatPolicyLayer& Layer = Model.Layers[LayerIndex];
+		const int32 LayerOutputs = Layer.Biases.Num();
+		if(LayerOutputs == 0 || Layer.Weights.Num() != LayerOutputs * LayerInputs)
+		{
+			UE_LOG(LogAIMeleeCombat, Warning, TEXT("%s: layer %d has %d weights & %d biases, expected %d inputs per output"),
+				*Model.GetName(), LayerIndex, Layer.Weights.Num(), LayerOutputs, LayerInputs);
+			Reset();
+			return false;
+		}
+
+		AddLayer(LayerInputs, LayerOutputs,
+			[&Layer, LayerInputs](int32 Output, int32 Input) { return Layer.Weights[Output * LayerInputs + Input]; },
+			[&Layer](int32 Output) { return Layer.Biases[Output]; });
+		LayerInputs = LayerOutputs;
+	}
+
+	if(LayerInputs != NumPolicyOutputs)
+	{
+		UE_LOG(LogAIMeleeCombat, Warning, TEXT("%s: last layer has %d outputs, expected one per ability (%d)"), *Model.GetName(), LayerInputs, NumPolicyOutputs);
+		Reset();
+		return false;
+	}
+	return true;
+}
+
+void FCombatPolicyNetwork::BuildRandom(TArrayView<const int32> HiddenSizes, int32 Seed)
+{
+	Reset();
+
+	FRandomStream Random(Seed);
+	int32 LayerInputs = NumInputs;
+	for (int32 LayerIndex = 0; LayerIndex <= HiddenSizes.Num(); ++LayerIndex)
+	{
+		const int32 LayerOutputs = LayerIndex < HiddenSizes.Num() ? HiddenSizes[LayerIndex] : NumPolicyOutputs;
+		const float Scale = FMath::InvSqrt(static_cast<float>(LayerInputs));
+		AddLayer(LayerInputs, LayerOutputs,
+			[&Random, Scale](int32, int32) { return Random.FRandRange(-Scale, Scale); },
+			[](int32) { return 0.f; });
+		LayerInputs = LayerOutputs;
+	}
+}
+
+void FCombatPolicyNetwork::Reset()
+{
+	Layers.Reset();
+}
+
+void FCombatPolicyNetwork::AddLayer(int32 InNumInputs, int32 InNumOutputs, TFunctionRef<float(int32 Output, int32 Input)> Weight, TFunctionRef<float(int32 Output)> Bias)
+{
+	FPackedLayer& Layer = Layers.AddDefaulted_GetRef();
+	Layer.NumInputs = InNumInputs;
+	Layer.NumOutputs = InNumOutputs;
+	Layer.PaddedOutputs = Align(InNumOutputs, SimdWidth);
+
+	Layer.Weights.SetNumZeroed(InNumInputs * Layer.PaddedOutputs);
+	Layer.Biases.SetNumZeroed(Layer.PaddedOutputs);
+	for (int32 Output = 0; Output < InNumOutputs; ++Output)
+	{
+		Layer.Biases[Output] = Bias(Output);
+		for (int32 Input = 0; Input < InNumInputs; ++Input)
+		{
+			Layer.Weights[Input * Layer.PaddedOutputs + Output] = Weight(Output, Input);
+		}
+	}
+}
+
+void FCombatPolicyNetwork::Evaluate(TArrayView<const float> Inputs, int32 NumAgents, TArray<float>& OutScores) const
+{
+	OutScores.SetNumUninitialized(NumAgents * NumPolicyOutputs);
+	if(!IsValid() || NumAgents == 0 || !ensure(Inputs.Num() >= NumAgents * NumInputs)) { return; }
+
+	// Activations of every agent for the current layer, ping-ponged between the two buffers
+	TArray<float, TAlignedHeapAllocator<16>> Buffers[2];
+	const float* LayerIn = Inputs.GetData();
+	int32 InStride = NumInputs;
+
+	for (int32 LayerIndex = 0; LayerIndex < Layers.Num(); ++LayerIndex)
+	{
+		const FPackedLayer& Layer = Layers[LayerIndex];
+		const bool bHidden = LayerIndex < Layers.Num() - 1;
+
+		TArray<float, TAlignedHeapAllocator<16>>& LayerOut = Buffers[LayerIndex & 1];
+		LayerOut.SetNumUninitialized(NumAgents * Layer.PaddedOutputs);
+
+		const float* Weights = Layer.Weights.GetData();
+		const float* Biases = Layer.Biases.GetData();
+		for (int32 Agent = 0; Agent < NumAgents; ++Agent)
+		{
+			const float* X = LayerIn + Agent * InStride;
+			float* Y = LayerOut.GetData() + Agent * Layer.PaddedOutputs;
+
+			// y = W x + b, 4 outputs at a time, broadcasting each input against its column of weights
+			for (int32 Output = 0; Output < Layer.PaddedOutputs; Output += SimdWidth)
+			{
+				VectorRegister4Float Acc = VectorLoadAligned(Biases + Output);
+				for (int32 Input = 0; Input < Layer.NumInputs; ++Input)
+				{
+					Acc = VectorMultiplyAdd(VectorLoadFloat1(X + Input), VectorLoadAligned(Weights + Input * Layer.PaddedOutputs + Output), Acc);
+				}
+				if(bHidden)
+				{
+					Acc = VectorMax(Acc, VectorZeroFloat());
+				}
+				VectorStoreAligned(Acc, Y + Output);
+			}
+		}
+
+		LayerIn = LayerOut.GetData();
+		InStride = Layer.PaddedOutputs;
+	}
+
+	// Sigmoid outputs in 0-1 like the utility scores, so ChooseBestAbility treats both the same
+	for (int32 Agent = 0; Agent < NumAgents; ++Agent)
+	{
+		for (int32 Ability = 0; Ability < NumPolicyOutputs; ++Ability)
+		{
+			OutScores[Agent * NumPolicyOutputs + Ability] = 1.f / (1.f + FMath::Exp(-LayerIn[Agent * InStride + Ability]));
+		}
+	}
+}
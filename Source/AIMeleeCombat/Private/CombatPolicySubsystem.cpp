@@ -0,0 +1,237 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatPolicySubsystem.h"
+#include "AIMeleeCombat.h"
+#include "AIMeleeCombatSettings.h"
+#include "AI_BaseCharacter.h"
+#include "AI_UtilityComponent.h"
+#include "CombatArchetype.h"
+#include "CombatAssetStreamer.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Policy Evaluations"), STAT_PolicyEvaluations, STATGROUP_AIMeleeCombat);
+DECLARE_CYCLE_STAT(TEXT("Policy Inference"), STAT_PolicyInference, STATGROUP_AIMeleeCombat);
+
+static TAutoConsoleVariable<int32> CVarPolicyEnable(
+	TEXT("AIMelee.Policy.Enable"),
+	1,
+	TEXT("0: the utility scores pick abilities, 1: the policy network picks them once its model has loaded"));
+
+static FAutoConsoleCommandWithWorld PolicyBenchmarkCommand(
+	TEXT("AIMelee.Policy.Benchmark"),
+	TEXT("Times utility scoring against batched policy inference for 100 & 1000 generated AI (random weights if no model is loaded)"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&UCombatPolicySubsystem::RunBenchmark));
+
+UCombatPolicySubsystem* UCombatPolicySubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UCombatPolicySubsystem>() : nullptr;
+}
+
+void UCombatPolicySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const FSoftObjectPath& ModelPath = GetDefault<UAIMeleeCombatSettings>()->PolicyModel;
+	if(ModelPath.IsNull()) { return; }
+
+	if(UCombatAssetStreamer* Streamer = Cast<UCombatAssetStreamer>(Collection.InitializeDependency(UCombatAssetStreamer::StaticClass())))
+	{
+		Streamer->Acquire(this, { ModelPath }, FSimpleDelegate::CreateUObject(this, &UCombatPolicySubsystem::OnModelLoaded));
+	}
+}
+
+void UCombatPolicySubsystem::OnModelLoaded()
+{
+	Model = Cast<UCombatPolicyModel>(GetDefault<UAIMeleeCombatSettings>()->PolicyModel.ResolveObject());
+	if(Model == nullptr)
+	{
+		UE_LOG(LogAIMeleeCombat, Warning, TEXT("Policy model %s isn't a UCombatPolicyModel, the utility scores pick abilities"), *GetDefault<UAIMeleeCombatSettings>()->PolicyModel.ToString());
+		return;
+	}
+
+	if(Network.Build(*Model))
+	{
+		UE_LOG(LogAIMeleeCombat, Log, TEXT("Policy model %s loaded, %d layers"), *Model->GetName(), Model->Layers.Num());
+	}
+}
+
+TStatId UCombatPolicySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatPolicySubsystem, STATGROUP_Tickables);
+}
+
+bool UCombatPolicySubsystem::IsPolicyReady() const
+{
+	return Network.IsValid() && CVarPolicyEnable.GetValueOnGameThread() != 0;
+}
+
+void UCombatPolicySubsystem::RequestEvaluation(UAI_UtilityComponent* Utility)
+{
+	PendingRequests.AddUnique(Utility);
+}
+
+void UCombatPolicySubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if(PendingRequests.Num() == 0) { return; }
+
+	// Gathered first so the whole frame is one inference call
+	TArray<UAI_UtilityComponent*, TInlineAllocator<64>> Agents;
+	TArray<uint8, TInlineAllocator<64>> FeasibleMasks;
+	Inputs.Reset();
+	for (const TWeakObjectPtr<UAI_UtilityComponent>& Request : PendingRequests)
+	{
+		UAI_UtilityComponent* Utility = Request.Get();
+		if(Utility == nullptr || Utility->AICharacter == nullptr || Utility->S_CombatBehavior == nullptr || Utility->AICharacter->IsDead()) { continue; }
+
+		// The AI started something else (or a telegraphed attack scheduled a defense) since it asked
+		if(Utility->AICharacter->GetCombatState() != ECombatState::ECS_Unoccupied || GetWorld()->GetTimerManager().IsTimerActive(Utility->DefenseTimer)) { continue; }
+
+		Utility->Targets.Reset();
+		Utility->Targets.Add(Utility->MakeTarget(Utility->AICharacter->GetEnemyHandle(), Utility->AICharacter->GetEnemyDetected()));
+
+		const FUtilityAgentState AgentState = Utility->MakeAgentState();
+		const int32 Offset = Inputs.AddUninitialized(FCombatPolicyNetwork::NumInputs);
+		UAI_UtilityComponent::MakePolicyInputs(AgentState, Utility->Targets[0], &Inputs[Offset]);
+		Agents.Add(Utility);
+
+		// Abilities the built in step conditions rule out (out of range, on cooldown, no attack to defend against), whatever the network says
+		uint8 FeasibleMask = 0;
+		for (int32 Ability = 0; Ability < UAI_UtilityComponent::NumAbilities; ++Ability)
+		{
+			FeasibleMask |= UAI_UtilityComponent::StepScore(AgentState, Ability, Utility->Targets[0]) > 0.f ? 1 << Ability : 0;
+		}
+		FeasibleMasks.Add(FeasibleMask);
+	}
+	PendingRequests.Reset();
+
+	if(Agents.Num() == 0 || !Network.IsValid()) { return; }
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_PolicyInference);
+		Network.Evaluate(Inputs, Agents.Num(), Scores);
+	}
+	INC_DWORD_STAT_BY(STAT_PolicyEvaluations, Agents.Num());
+
+	for (int32 Index = 0; Index < Agents.Num(); ++Index)
+	{
+		UAI_UtilityComponent* Utility = Agents[Index];
+		Utility->AbilitiesAvailable.Reset();
+		Utility->AbilitiesAvailable.Append(Scores.GetData() + Index * UAI_UtilityComponent::NumAbilities, UAI_UtilityComponent::NumAbilities);
+		for (int32 Ability = 0; Ability < UAI_UtilityComponent::NumAbilities; ++Ability)
+		{
+			if((FeasibleMasks[Index] & (1 << Ability)) == 0)
+			{
+				Utility->AbilitiesAvailable[Ability] = 0.f;
+			}
+		}
+
+		// The policy only sees the current target, so ChooseBestAbility has nothing to switch to
+		Utility->BestTargets.Init(INDEX_NONE, UAI_UtilityComponent::NumAbilities);
+		Utility->LastPairsEvaluated = 0;
+		Utility->ChooseBestAbility();
+	}
+}
+
+void UCombatPolicySubsystem::Deinitialize()
+{
+	if(UCombatAssetStreamer* Streamer = UCombatAssetStreamer::Get(this))
+	{
+		Streamer->Release(this);
+	}
+
+	PendingRequests.Empty();
+	Network.Reset();
+	Model = nullptr;
+
+	Super::Deinitialize();
+}
+
+void UCombatPolicySubsystem::RunBenchmark(UWorld* World)
+{
+	if(World == nullptr) { return; }
+
+	const UAI_UtilityComponent* Template = nullptr;
+	for (TActorIterator<AAI_BaseCharacter> It(World); It && Template == nullptr; ++It)
+	{
+		const UAI_UtilityComponent* Candidate = It->GetUtilityComponent();
+		Template = Candidate && Candidate->S_CombatBehavior ? Candidate : nullptr;
+	}
+	if(Template == nullptr)
+	{
+		UE_LOG(LogAIMeleeCombat, Warning, TEXT("AIMelee.Policy.Benchmark needs an AI with a combat behavior in the world"));
+		return;
+	}
+
+	// The loaded model if there is one, otherwise a network of a typical size
+	FCombatPolicyNetwork RandomNetwork;
+	const UCombatPolicySubsystem* Policy = Get(World);
+	const bool bLoadedModel = Policy && Policy->Network.IsValid();
+	if(!bLoadedModel)
+	{
+		RandomNetwork.BuildRandom({ 32, 32 }, 1234);
+	}
+	const FCombatPolicyNetwork& Network = bLoadedModel ? Policy->Network : RandomNetwork;
+
+	constexpr int32 NumIterations = 100;
+	const FUtilityAgentState TemplateAgent = Template->MakeAgentState();
+	const float RangedAttackRange = TemplateAgent.Ranges.RangedAttackRange;
+
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("Policy benchmark (%s)"), bLoadedModel ? TEXT("loaded model") : TEXT("random 32x32 network, no model loaded"));
+
+	for (const int32 NumAgents : { 100, 1000 })
+	{
+		// Same generated agents for both selectors
+		FRandomStream Random(NumAgents);
+		TArray<FUtilityAgentState> Agents;
+		TArray<TArray<FUtilityTarget>> AgentTargets;
+		for (int32 Index = 0; Index < NumAgents; ++Index)
+		{
+			FUtilityAgentState& Agent = Agents.Add_GetRef(TemplateAgent);
+			Agent.HealthFraction = Random.FRand();
+			Agent.bCanStrafe = Random.FRand() < 0.5f;
+			Agent.bCanBlock = Random.FRand() < 0.5f;
+			Agent.bCanDodge = Random.FRand() < 0.5f;
+			Agent.bAttackIncoming = Random.FRand() < 0.25f;
+			Agent.bEnemyDetected = true;
+
+			FUtilityTarget& Target = AgentTargets.AddDefaulted_GetRef().AddDefaulted_GetRef();
+			Target.Distance = Random.FRandRange(0.f, RangedAttackRange * 2.f);
+			Target.bDetected = true;
+			Target.bAttacking = Random.FRand() < 0.25f;
+		}
+
+		TArray<float> UtilityScores;
+		TArray<int32> Best;
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+		{
+			for (int32 Index = 0; Index < NumAgents; ++Index)
+			{
+				UAI_UtilityComponent::ScoreTargets(Agents[Index], AgentTargets[Index], true, UtilityScores, Best);
+			}
+		}
+		const double UtilityMs = (FPlatformTime::Seconds() - StartTime) / NumIterations * 1000.0;
+
+		// Includes building the input matrix, as the subsystem does every frame
+		TArray<float> BatchInputs;
+		TArray<float> BatchScores;
+		StartTime = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+		{
+			BatchInputs.SetNumUninitialized(NumAgents * FCombatPolicyNetwork::NumInputs);
+			for (int32 Index = 0; Index < NumAgents; ++Index)
+			{
+				UAI_UtilityComponent::MakePolicyInputs(Agents[Index], AgentTargets[Index][0], &BatchInputs[Index * FCombatPolicyNetwork::NumInputs]);
+			}
+			Network.Evaluate(BatchInputs, NumAgents, BatchScores);
+		}
+		const double PolicyMs = (FPlatformTime::Seconds() - StartTime) / NumIterations * 1000.0;
+
+		UE_LOG(LogAIMeleeCombat, Log, TEXT("  %4d AI: utility %.3f ms, policy %.3f ms per frame"), NumAgents, UtilityMs, PolicyMs);
+	}
+}
@@ -0,0 +1,403 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatProjectileSubsystem.h"
+#include "AIMeleeCombat.h"
+#include "AIMeleeCombatSettings.h"
+#include "CombatAssetStreamer.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/PlayerController.h"
+#include "Kismet/GameplayStatics.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectiles"), STAT_Projectiles, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Hits"), STAT_ProjectileHits, STATGROUP_AIMeleeCombat);
+DECLARE_CYCLE_STAT(TEXT("Projectile Step"), STAT_ProjectileStep, STATGROUP_AIMeleeCombat);
+DECLARE_CYCLE_STAT(TEXT("Projectile Visuals"), STAT_ProjectileVisuals, STATGROUP_AIMeleeCombat);
+
+static FAutoConsoleCommandWithWorld ProjectileReportCommand(
+	TEXT("AIMelee.Projectiles.Report"),
+	TEXT("Logs the projectiles in flight, their hits & the size of the instance pool"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if(const UCombatProjectileSubsystem* Projectiles = World ? World->GetSubsystem<UCombatProjectileSubsystem>() : nullptr)
+		{
+			Projectiles->LogReport();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld ProjectileBenchmarkCommand(
+	TEXT("AIMelee.Projectiles.Benchmark"),
+	TEXT("Launches 5000 harmless projectiles around the player & times the simulation & visual update, they keep flying so stat AIMeleeCombat shows the frame cost"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&UCombatProjectileSubsystem::RunBenchmark));
+
+UCombatProjectileSubsystem::UCombatProjectileSubsystem() :
+	CellSize(500.f),
+	Mesh(nullptr),
+	Instances(nullptr),
+	TimeSinceStep(0.f),
+	NumLaunched(0),
+	NumCombatantHits(0),
+	NumWorldHits(0),
+	NumExpired(0)
+{
+}
+
+UCombatProjectileSubsystem* UCombatProjectileSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UCombatProjectileSubsystem>() : nullptr;
+}
+
+void UCombatProjectileSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const FSoftObjectPath& MeshPath = GetDefault<UAIMeleeCombatSettings>()->ProjectileMesh;
+	if(MeshPath.IsNull()) { return; }
+
+	if(UCombatAssetStreamer* Streamer = Cast<UCombatAssetStreamer>(Collection.InitializeDependency(UCombatAssetStreamer::StaticClass())))
+	{
+		Streamer->Acquire(this, { MeshPath }, FSimpleDelegate::CreateUObject(this, &UCombatProjectileSubsystem::OnMeshLoaded));
+	}
+}
+
+void UCombatProjectileSubsystem::OnMeshLoaded()
+{
+	Mesh = Cast<UStaticMesh>(GetDefault<UAIMeleeCombatSettings>()->ProjectileMesh.ResolveObject());
+	if(Mesh == nullptr)
+	{
+		UE_LOG(LogAIMeleeCombat, Warning, TEXT("Projectile mesh %s isn't a static mesh, projectiles won't be drawn"), *GetDefault<UAIMeleeCombatSettings>()->ProjectileMesh.ToString());
+	}
+}
+
+TStatId UCombatProjectileSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatProjectileSubsystem, STATGROUP_Tickables);
+}
+
+void UCombatProjectileSubsystem::Launch(FCombatantHandle Owner, const FVector& Location, const FVector& Velocity, float Damage, float Radius, float GravityScale)
+{
+	FCombatProjectile& Projectile = Projectiles.AddDefaulted_GetRef();
+	Projectile.Location = FVector3f(Location);
+	Projectile.Velocity = FVector3f(Velocity);
+	Projectile.Gravity = GetWorld()->GetGravityZ() * GravityScale;
+	Projectile.Radius = Radius;
+	Projectile.Damage = Damage;
+	Projectile.Lifetime = GetDefault<UAIMeleeCombatSettings>()->ProjectileLifetime;
+	Projectile.Owner = Owner;
+
+	++NumLaunched;
+	SET_DWORD_STAT(STAT_Projectiles, Projectiles.Num());
+}
+
+void UCombatProjectileSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const UAIMeleeCombatSettings* Settings = GetDefault<UAIMeleeCombatSettings>();
+	const float FixedStep = FMath::Max(Settings->ProjectileStep, KINDA_SMALL_NUMBER);
+
+	// Fixed steps so hits don't depend on the frame rate, the time of any steps over the limit is dropped rather than spiralling on slow frames
+	TimeSinceStep = FMath::Min(TimeSinceStep + DeltaTime, FixedStep * FMath::Max(Settings->ProjectileMaxSteps, 1));
+	while (TimeSinceStep >= FixedStep)
+	{
+		Step(FixedStep);
+		TimeSinceStep -= FixedStep;
+	}
+
+	UpdateVisuals(TimeSinceStep);
+}
+
+void UCombatProjectileSubsystem::BuildHitVolumes()
+{
+	// Only the cells combatants stand in this step, emptied cells left in the map would pile up as combatants move around the level
+	HitVolumes.Reset();
+	VolumeGrid.Reset();
+
+	const UCombatantRegistry* Registry = UCombatantRegistry::Get(this);
+	if(Registry == nullptr) { return; }
+
+	CellSize = FMath::Max(GetDefault<UAIMeleeCombatSettings>()->ProjectileGridCellSize, 100.f);
+	Registry->ForEachCombatant([this, Registry](FCombatantHandle Handle, const ACharacter* Character, ECombatantKind Kind)
+	{
+		if(Character == nullptr || !Registry->IsAlive(Handle)) { return; }
+
+		const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+		FHitVolume& Volume = HitVolumes.AddDefaulted_GetRef();
+		Volume.Center = Capsule->GetComponentLocation();
+		Volume.Radius = Capsule->GetScaledCapsuleRadius();
+		Volume.HalfHeight = Capsule->GetScaledCapsuleHalfHeight();
+		Volume.Handle = Handle;
+
+		// Every cell the capsule overlaps, so a sweep only has to look at the cells around its own segment
+		const FIntPoint Min = GetCell(Volume.Center - FVector(Volume.Radius));
+		const FIntPoint Max = GetCell(Volume.Center + FVector(Volume.Radius));
+		for (int32 X = Min.X; X <= Max.X; ++X)
+		{
+			for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+			{
+				VolumeGrid.FindOrAdd(FIntPoint(X, Y)).Add(HitVolumes.Num() - 1);
+			}
+		}
+	});
+}
+
+int32 UCombatProjectileSubsystem::SweepHitVolumes(const FCombatProjectile& Projectile, const FVector& Start, const FVector& End, float& OutTime) const
+{
+	const UCombatantRegistry* Registry = UCombatantRegistry::Get(this);
+
+	int32 HitVolume = INDEX_NONE;
+	OutTime = 1.f;
+
+	// Segments are short (one step of flight) so they rarely cover more than one or two cells
+	const FIntPoint Min = GetCell(Start.ComponentMin(End) - FVector(Projectile.Radius));
+	const FIntPoint Max = GetCell(Start.ComponentMax(End) + FVector(Projectile.Radius));
+	for (int32 X = Min.X; X <= Max.X; ++X)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+		{
+			const TArray<int32, TInlineAllocator<4>>* Cell = VolumeGrid.Find(FIntPoint(X, Y));
+			if(Cell == nullptr) { continue; }
+
+			for (const int32 VolumeIndex : *Cell)
+			{
+				const FHitVolume& Volume = HitVolumes[VolumeIndex];
+
+				// Shooters can't hit themselves or their allies, ownerless projectiles are stopped by anyone
+				if(Projectile.Owner.IsValid() && (Volume.Handle == Projectile.Owner || (Registry && !Registry->AreEnemies(Projectile.Owner, Volume.Handle)))) { continue; }
+
+				// Capsule as its core segment, hit when the projectile passes within the capsule radius of it
+				const FVector Offset(0.f, 0.f, FMath::Max(Volume.HalfHeight - Volume.Radius, 0.f));
+				FVector OnProjectile;
+				FVector OnCapsule;
+				FMath::SegmentDistToSegmentSafe(Start, End, Volume.Center - Offset, Volume.Center + Offset, OnProjectile, OnCapsule);
+				if(FVector::DistSquared(OnProjectile, OnCapsule) > FMath::Square(Volume.Radius + Projectile.Radius)) { continue; }
+
+				const float SegmentLength = FVector::Dist(Start, End);
+				const float Time = SegmentLength > KINDA_SMALL_NUMBER ? FVector::Dist(Start, OnProjectile) / SegmentLength : 0.f;
+				if(Time < OutTime || HitVolume == INDEX_NONE)
+				{
+					HitVolume = VolumeIndex;
+					OutTime = Time;
+				}
+			}
+		}
+	}
+
+	return HitVolume;
+}
+
+void UCombatProjectileSubsystem::Step(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProjectileStep);
+
+	if(Projectiles.Num() == 0) { return; }
+
+	BuildHitVolumes();
+
+	const UWorld* World = GetWorld();
+	FCollisionObjectQueryParams WorldObjects;
+	WorldObjects.AddObjectTypesToQuery(ECC_WorldStatic);
+	WorldObjects.AddObjectTypesToQuery(ECC_WorldDynamic);
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ProjectileSweep), false);
+
+	// Integrate & sweep every projectile in parallel (the grid & scene queries are read only), hits are applied afterwards on the game thread
+	Hits.SetNumUninitialized(Projectiles.Num());
+	ParallelFor(Projectiles.Num(), [&](int32 Index)
+	{
+		FCombatProjectile& Projectile = Projectiles[Index];
+		const FVector Start(Projectile.Location);
+
+		Projectile.Velocity.Z += Projectile.Gravity * DeltaTime;
+		Projectile.Location += Projectile.Velocity * DeltaTime;
+		Projectile.Lifetime -= DeltaTime;
+
+		const FVector End(Projectile.Location);
+
+		FProjectileHit& Hit = Hits[Index];
+		Hit.Volume = SweepHitVolumes(Projectile, Start, End, Hit.Time);
+		Hit.bHit = Hit.Volume != INDEX_NONE;
+
+		// The world only needs checking up to the combatant that was hit, with the projectiles radius so it stops where it touches like the capsule test
+		FHitResult WorldHit;
+		const FVector WorldEnd = Hit.bHit ? FMath::Lerp(Start, End, Hit.Time) : End;
+		if(World->SweepSingleByObjectType(WorldHit, Start, WorldEnd, FQuat::Identity, WorldObjects, FCollisionShape::MakeSphere(Projectile.Radius), QueryParams))
+		{
+			Hit.Volume = INDEX_NONE;
+			Hit.Time = WorldHit.Time;
+			Hit.bHit = true;
+			Projectile.Location = FVector3f(WorldHit.Location);
+		}
+	});
+
+	const UCombatantRegistry* Registry = UCombatantRegistry::Get(this);
+	for (int32 Index = Projectiles.Num() - 1; Index >= 0; --Index)
+	{
+		const FCombatProjectile& Projectile = Projectiles[Index];
+		const FProjectileHit& Hit = Hits[Index];
+		if(Hit.bHit)
+		{
+			if(Hit.Volume != INDEX_NONE)
+			{
+				++NumCombatantHits;
+				INC_DWORD_STAT(STAT_ProjectileHits);
+
+				// Resolved now rather than during the sweep, an earlier hit this step may already have killed either side
+				ACharacter* Target = Registry && Registry->IsAlive(HitVolumes[Hit.Volume].Handle) ? Registry->GetCharacter(HitVolumes[Hit.Volume].Handle) : nullptr;
+				ACharacter* Shooter = Registry ? Registry->GetCharacter(Projectile.Owner) : nullptr;
+				if(Target && Projectile.Damage > 0.f)
+				{
+					UGameplayStatics::ApplyDamage(Target, Projectile.Damage, Shooter ? Shooter->GetController() : nullptr, Shooter, UDamageType::StaticClass());
+				}
+			}
+			else
+			{
+				++NumWorldHits;
+			}
+		}
+		else if(Projectile.Lifetime <= 0.f)
+		{
+			++NumExpired;
+		}
+		else
+		{
+			continue;
+		}
+
+		Projectiles.RemoveAtSwap(Index, 1, false);
+	}
+
+	SET_DWORD_STAT(STAT_Projectiles, Projectiles.Num());
+}
+
+void UCombatProjectileSubsystem::UpdateVisuals(float Remainder)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProjectileVisuals);
+
+	if(Mesh == nullptr) { return; }
+
+	if(Instances == nullptr)
+	{
+		if(Projectiles.Num() == 0) { return; }
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		AActor* VisualsActor = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+		if(VisualsActor == nullptr) { return; }
+
+		Instances = NewObject<UInstancedStaticMeshComponent>(VisualsActor, TEXT("ProjectileInstances"));
+		Instances->SetStaticMesh(Mesh);
+		Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Instances->SetCastShadow(false);
+		Instances->SetMobility(EComponentMobility::Movable);
+		VisualsActor->SetRootComponent(Instances);
+		Instances->RegisterComponent();
+	}
+
+	// The pool only grows to the most projectiles seen at once, instances without a projectile are scaled to nothing
+	const int32 NumInstances = FMath::Max(Instances->GetInstanceCount(), Projectiles.Num());
+	InstanceTransforms.Reset(NumInstances);
+	for (const FCombatProjectile& Projectile : Projectiles)
+	{
+		const FVector Velocity(Projectile.Velocity);
+		InstanceTransforms.Emplace(Velocity.Rotation(), FVector(Projectile.Location) + Velocity * Remainder);
+	}
+	while (InstanceTransforms.Num() < NumInstances)
+	{
+		InstanceTransforms.Emplace(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector);
+	}
+
+	// Grown with hidden instances first so every frame is a single batched update of the whole pool
+	if(NumInstances > Instances->GetInstanceCount())
+	{
+		TArray<FTransform> NewInstances;
+		NewInstances.Init(FTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector), NumInstances - Instances->GetInstanceCount());
+		Instances->AddInstances(NewInstances, false, true);
+	}
+	if(NumInstances > 0)
+	{
+		Instances->BatchUpdateInstancesTransforms(0, InstanceTransforms, true, true, true);
+	}
+}
+
+void UCombatProjectileSubsystem::RunBenchmark(UWorld* World)
+{
+	UCombatProjectileSubsystem* Subsystem = Get(World);
+	if(Subsystem == nullptr) { return; }
+
+	constexpr int32 NumProjectiles = 5000;
+	constexpr int32 NumSteps = 60;
+
+	FVector Origin = FVector::ZeroVector;
+	if(const APlayerController* PlayerController = World->GetFirstPlayerController())
+	{
+		if(const APawn* Pawn = PlayerController->GetPawn())
+		{
+			Origin = Pawn->GetActorLocation();
+		}
+	}
+
+	// Fired outwards from a disc around the player, so they pass through the nearby combatants & walls as real volleys would
+	FRandomStream Random(1234);
+	for (int32 Index = 0; Index < NumProjectiles; ++Index)
+	{
+		const FVector Direction = FVector(Random.FRandRange(-1.f, 1.f), Random.FRandRange(-1.f, 1.f), Random.FRandRange(-0.05f, 0.05f)).GetSafeNormal();
+		const FVector Start = Origin + FVector(Random.FRandRange(-1000.f, 1000.f), Random.FRandRange(-1000.f, 1000.f), 0.f);
+		Subsystem->Launch(FCombatantHandle(), Start, Direction * Random.FRandRange(1500.f, 3000.f), 0.f, 8.f, 0.f);
+	}
+
+	const int32 NumHitsBefore = Subsystem->NumCombatantHits + Subsystem->NumWorldHits;
+	const float FixedStep = FMath::Max(GetDefault<UAIMeleeCombatSettings>()->ProjectileStep, KINDA_SMALL_NUMBER);
+
+	double StepSeconds = 0.0;
+	double VisualSeconds = 0.0;
+	int32 NumProjectileSteps = 0;
+	for (int32 StepIndex = 0; StepIndex < NumSteps; ++StepIndex)
+	{
+		NumProjectileSteps += Subsystem->Projectiles.Num();
+
+		double StartTime = FPlatformTime::Seconds();
+		Subsystem->Step(FixedStep);
+		StepSeconds += FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		Subsystem->UpdateVisuals(0.f);
+		VisualSeconds += FPlatformTime::Seconds() - StartTime;
+	}
+
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("Projectile benchmark: %d projectiles, %d steps of %.1f ms, %d combatant capsules"),
+		NumProjectiles, NumSteps, FixedStep * 1000.f, Subsystem->HitVolumes.Num());
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("  step %.3f ms (%.1f ns per projectile), visuals %.3f ms, %d hits, %d still in flight"),
+		StepSeconds * 1000.0 / NumSteps, NumProjectileSteps > 0 ? StepSeconds * 1e9 / NumProjectileSteps : 0.0, VisualSeconds * 1000.0 / NumSteps,
+		Subsystem->NumCombatantHits + Subsystem->NumWorldHits - NumHitsBefore, Subsystem->Projectiles.Num());
+}
+
+void UCombatProjectileSubsystem::LogReport() const
+{
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("Projectiles: %d in flight (%d KB), %d launched, %d hit combatants, %d hit the world, %d expired, %d pooled instances"),
+		Projectiles.Num(), static_cast<int32>(Projectiles.GetAllocatedSize() / 1024), NumLaunched, NumCombatantHits, NumWorldHits, NumExpired,
+		Instances ? Instances->GetInstanceCount() : 0);
+}
+
+void UCombatProjectileSubsystem::Deinitialize()
+{
+	if(UCombatAssetStreamer* Streamer = UCombatAssetStreamer::Get(this))
+	{
+		Streamer->Release(this);
+	}
+
+	Projectiles.Empty();
+	Hits.Empty();
+	HitVolumes.Empty();
+	VolumeGrid.Empty();
+	InstanceTransforms.Empty();
+	Instances = nullptr;
+	Mesh = nullptr;
+
+	Super::Deinitialize();
+}
@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatSignificanceSubsystem.h"
+#include "AIMeleeCombat.h"
+#include "AIMeleeCombatSettings.h"
+#include "CombatantRegistry.h"
+#include "AI_BaseCharacter.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Significance Update"), STAT_SignificanceUpdate, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Significance Bucket 0"), STAT_SignificanceBucket0, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Significance Bucket 1"), STAT_SignificanceBucket1, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Significance Bucket 2"), STAT_SignificanceBucket2, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Significance Bucket 3+"), STAT_SignificanceBucket3, STATGROUP_AIMeleeCombat);
+
+static FAutoConsoleCommandWithWorld SignificanceReportCommand(
+	TEXT("AIMelee.Significance.Report"),
+	TEXT("Logs how many AI are in each significance bucket"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if(const UCombatSignificanceSubsystem* Significance = World ? World->GetSubsystem<UCombatSignificanceSubsystem>() : nullptr)
+		{
+			Significance->LogReport();
+		}
+	}));
+
+UCombatSignificanceSubsystem::UCombatSignificanceSubsystem() :
+	TimeSinceUpdate(0.f)
+{
+}
+
+TStatId UCombatSignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatSignificanceSubsystem, STATGROUP_Tickables);
+}
+
+void UCombatSignificanceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TimeSinceUpdate += DeltaTime;
+	if(TimeSinceUpdate < GetDefault<UAIMeleeCombatSettings>()->SignificanceUpdateInterval) { return; }
+
+	TimeSinceUpdate = 0.f;
+	UpdateSignificance();
+}
+
+float UCombatSignificanceSubsystem::GetSignificance(FCombatantHandle Handle) const
+{
+	return (Entries.IsValidIndex(Handle.Index) && Entries[Handle.Index].Serial == Handle.Serial) ? Entries[Handle.Index].Score : 0.f;
+}
+
+void UCombatSignificanceSubsystem::UpdateSignificance()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SignificanceUpdate);
+
+	const UAIMeleeCombatSettings* Settings = GetDefault<UAIMeleeCombatSettings>();
+	const UCombatantRegistry* Registry = UCombatantRegistry::Get(this);
+	if(Registry == nullptr || Settings->SignificanceBuckets.Num() == 0) { return; }
+
+	TArray<FVector, TInlineAllocator<4>> ViewLocations;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if(const APlayerController* PlayerController = It->Get())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			ViewLocations.Add(ViewLocation);
+		}
+	}
+
+	NumInBucket.Init(0, Settings->SignificanceBuckets.Num());
+
+	Registry->ForEachCombatant([this, Registry, Settings, &ViewLocations](FCombatantHandle Handle, ACharacter* Character, ECombatantKind Kind)
+	{
+		AAI_BaseCharacter* AICharacter = Registry->GetAICharacter(Handle);
+		if(AICharacter == nullptr || AICharacter->IsDead()) { return; }
+
+		if(Entries.Num() <= Handle.Index)
+		{
+			Entries.SetNum(Handle.Index + 1);
+		}
+
+		FSignificanceEntry& Entry = Entries[Handle.Index];
+		if(Entry.Serial != Handle.Serial)
+		{
+			Entry = FSignificanceEntry();
+			Entry.Serial = Handle.Serial;
+		}
+
+		Entry.Score = ScoreCombatant(AICharacter, ViewLocations);
+
+		const int32 Bucket = PickBucket(Entry.Score, Entry.Bucket);
+		if(Bucket != Entry.Bucket)
+		{
+			Entry.Bucket = Bucket;
+			AICharacter->ApplySignificance(Bucket, Settings->SignificanceBuckets[Bucket]);
+		}
+
+		++NumInBucket[Bucket];
+	});
+
+	SET_DWORD_STAT(STAT_SignificanceBucket0, NumInBucket.IsValidIndex(0) ? NumInBucket[0] : 0);
+	SET_DWORD_STAT(STAT_SignificanceBucket1, NumInBucket.IsValidIndex(1) ? NumInBucket[1] : 0);
+	SET_DWORD_STAT(STAT_SignificanceBucket2, NumInBucket.IsValidIndex(2) ? NumInBucket[2] : 0);
+
+	int32 NumInLowerBuckets = 0;
+	for (int32 Bucket = 3; Bucket < NumInBucket.Num(); ++Bucket)
+	{
+		NumInLowerBuckets += NumInBucket[Bucket];
+	}
+	SET_DWORD_STAT(STAT_SignificanceBucket3, NumInLowerBuckets);
+}
+
+float UCombatSignificanceSubsystem::ScoreCombatant(const AAI_BaseCharacter* AICharacter, const TArray<FVector, TInlineAllocator<4>>& ViewLocations) const
+{
+	const UAIMeleeCombatSettings* Settings = GetDefault<UAIMeleeCombatSettings>();
+
+	float NearestDistance = ViewLocations.Num() > 0 ? MAX_flt : 0.f;
+	for (const FVector& ViewLocation : ViewLocations)
+	{
+		NearestDistance = FMath::Min(NearestDistance, FVector::Dist(ViewLocation, AICharacter->GetActorLocation()));
+	}
+	const float DistanceScore = 1.f - FMath::Clamp(NearestDistance / Settings->SignificanceMaxDistance, 0.f, 1.f);
+
+	// Fighting the player counts fully, fighting another AI counts half
+	float CombatScore = 0.f;
+	if(AICharacter->GetEnemyDetected())
+	{
+		CombatScore = AICharacter->GetEnemyPlayer() ? 1.f : 0.5f;
+	}
+
+	const float VisibilityScore = AICharacter->GetMesh()->WasRecentlyRendered(0.5f) ? 1.f : 0.f;
+
+	const float TotalWeight = Settings->SignificanceDistanceWeight + Settings->SignificanceCombatWeight + Settings->SignificanceVisibilityWeight;
+	if(TotalWeight <= 0.f) { return 1.f; }
+
+	return (DistanceScore * Settings->SignificanceDistanceWeight + CombatScore * Settings->SignificanceCombatWeight + VisibilityScore * Settings->SignificanceVisibilityWeight) / TotalWeight;
+}
+
+int32 UCombatSignificanceSubsystem::PickBucket(float Score, int32 CurrentBucket) const
+{
+	const UAIMeleeCombatSettings* Settings = GetDefault<UAIMeleeCombatSettings>();
+	const TArray<FSignificanceBucket>& Buckets = Settings->SignificanceBuckets;
+
+	int32 Bucket = Buckets.Num() - 1;
+	for (int32 Index = 0; Index < Buckets.Num(); ++Index)
+	{
+		if(Score >= Buckets[Index].MinSignificance)
+		{
+			Bucket = Index;
+			break;
+		}
+	}
+
+	if(!Buckets.IsValidIndex(CurrentBucket) || Bucket == CurrentBucket) { return Bucket; }
+
+	// Only leave the current bucket once the score is clearly past its threshold
+	const float Hysteresis = Settings->SignificanceHysteresis;
+	if(Bucket < CurrentBucket && Score < Buckets[Bucket].MinSignificance + Hysteresis)
+	{
+		return CurrentBucket;
+	}
+	if(Bucket > CurrentBucket && Score > Buckets[CurrentBucket].MinSignificance - Hysteresis)
+	{
+		return CurrentBucket;
+	}
+
+	return Bucket;
+}
+
+void UCombatSignificanceSubsystem::LogReport() const
+{
+	const UAIMeleeCombatSettings* Settings = GetDefault<UAIMeleeCombatSettings>();
+	for (int32 Bucket = 0; Bucket < NumInBucket.Num() && Bucket < Settings->SignificanceBuckets.Num(); ++Bucket)
+	{
+		const FSignificanceBucket& Rates = Settings->SignificanceBuckets[Bucket];
+		UE_LOG(LogAIMeleeCombat, Log, TEXT("Significance bucket %d (>= %.2f): %d AI, think %.2fs, tick %.2fs, sight every %.2fs, movement %.2fs"),
+			Bucket, Rates.MinSignificance, NumInBucket[Bucket], Rates.ThinkInterval, Rates.ActorTickInterval, Rates.PerceptionInterval, Rates.MovementTickInterval);
+	}
+}
@@ -0,0 +1,295 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatSnapshotSubsystem.h"
+#include "AIMeleeCombat.h"
+#include "AIMeleeCombatSettings.h"
+#include "AI_BaseCharacter.h"
+#include "PlayerCharacter.h"
+#include "CombatArchetype.h"
+#include "EngineUtils.h"
+#include "Async/Async.h"
+#include "Misc/QueuedThreadPool.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Utility Jobs"), STAT_UtilityJobs, STATGROUP_AIMeleeCombat);
+DECLARE_CYCLE_STAT(TEXT("Snapshot Publish"), STAT_SnapshotPublish, STATGROUP_AIMeleeCombat);
+DECLARE_CYCLE_STAT(TEXT("Snapshot Sync"), STAT_SnapshotSync, STATGROUP_AIMeleeCombat);
+DECLARE_CYCLE_STAT(TEXT("Utility Job"), STAT_UtilityJob, STATGROUP_AIMeleeCombat);
+
+static TAutoConsoleVariable<int32> CVarUtilityAsync(
+	TEXT("AIMelee.Utility.Async"),
+	1,
+	TEXT("0: UpdateScore scores on the game thread, 1: scoring runs as task graph jobs over the combat snapshot & is applied the next frame"));
+
+static FAutoConsoleCommandWithWorld ParallelBenchmarkCommand(
+	TEXT("AIMelee.Utility.ParallelBenchmark"),
+	TEXT("Times utility evaluation of a generated snapshot (4096 AI x 8 targets) on 1, 2, 4, 8 & 16 worker threads"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&UCombatSnapshotSubsystem::RunScalingBenchmark));
+
+UCombatSnapshotSubsystem* UCombatSnapshotSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UCombatSnapshotSubsystem>() : nullptr;
+}
+
+TStatId UCombatSnapshotSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCombatSnapshotSubsystem, STATGROUP_Tickables);
+}
+
+bool UCombatSnapshotSubsystem::IsAsyncEvaluationEnabled() const
+{
+	return CVarUtilityAsync.GetValueOnGameThread() != 0;
+}
+
+void UCombatSnapshotSubsystem::RequestEvaluation(UAI_UtilityComponent* Utility)
+{
+	PendingRequests.AddUnique(Utility);
+}
+
+void UCombatSnapshotSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Written while last frames jobs are still reading the front buffer
+	FCombatSnapshot& BackSnapshot = Snapshots[1 - FrontIndex];
+	PublishSnapshot(BackSnapshot);
+
+	SyncAndApply();
+
+	FrontIndex = 1 - FrontIndex;
+	LaunchJobs(Snapshots[FrontIndex], GetDefault<UAIMeleeCombatSettings>()->UtilityJobBatchSize, InFlight);
+
+	SET_DWORD_STAT(STAT_UtilityJobs, Snapshots[FrontIndex].Jobs.Num());
+}
+
+void UCombatSnapshotSubsystem::PublishSnapshot(FCombatSnapshot& Snapshot)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SnapshotPublish);
+
+	Snapshot.Jobs.Reset();
+	Snapshot.Combatants.Reset();
+	Snapshot.bPrune = UAI_UtilityComponent::IsPruningEnabled();
+
+	// Nothing to score, skip copying the combatants too
+	if(PendingRequests.Num() == 0) { return; }
+
+	if(const UCombatantRegistry* CombatantRegistry = UCombatantRegistry::Get(this))
+	{
+		CombatantRegistry->ForEachCombatant([&Snapshot, CombatantRegistry](FCombatantHandle Handle, ACharacter* Character, ECombatantKind Kind)
+		{
+			if(Snapshot.Combatants.Num() <= Handle.Index)
+			{
+				Snapshot.Combatants.SetNum(Handle.Index + 1);
+			}
+
+			FCombatantSnapshot& Combatant = Snapshot.Combatants[Handle.Index];
+			Combatant.Serial = Handle.Serial;
+			Combatant.bAlive = CombatantRegistry->IsAlive(Handle);
+			Combatant.Location = Character ? Character->GetActorLocation() : FVector::ZeroVector;
+
+			if(const AAI_BaseCharacter* AICharacter = Kind == ECombatantKind::ECK_AI ? Cast<AAI_BaseCharacter>(Character) : nullptr)
+			{
+				Combatant.bAttacking = AICharacter->GetIsAttacking();
+			}
+			else if(const APlayerCharacter* PlayerCharacter = Kind == ECombatantKind::ECK_Player ? Cast<APlayerCharacter>(Character) : nullptr)
+			{
+				Combatant.bAttacking = PlayerCharacter->GetIsAttacking();
+			}
+		});
+	}
+
+	for (const TWeakObjectPtr<UAI_UtilityComponent>& Request : PendingRequests)
+	{
+		UAI_UtilityComponent* Utility = Request.Get();
+		if(Utility == nullptr || Utility->AICharacter == nullptr || Utility->S_CombatBehavior == nullptr || Utility->AICharacter->IsDead()) { continue; }
+
+		FUtilityJob& Job = Snapshot.Jobs.AddDefaulted_GetRef();
+		Job.Utility = Utility;
+		Job.Self = Utility->AICharacter->GetCombatantHandle();
+		Job.Agent = Utility->MakeAgentState();
+		Utility->GatherCandidates(Job.Candidates);
+	}
+	PendingRequests.Reset();
+}
+
+void UCombatSnapshotSubsystem::SyncAndApply()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SnapshotSync);
+
+	if(InFlight.Num() > 0)
+	{
+		FTaskGraphInterface::Get().WaitUntilTasksComplete(InFlight, ENamedThreads::GameThread);
+		InFlight.Reset();
+	}
+
+	for (FUtilityJob& Job : Snapshots[FrontIndex].Jobs)
+	{
+		UAI_UtilityComponent* Utility = Job.Utility.Get();
+		if(Utility == nullptr || Utility->AICharacter == nullptr || Utility->AICharacter->IsDead()) { continue; }
+
+		// The AI started something else (or a telegraphed attack scheduled a defense) since the snapshot was taken
+		if(Utility->AICharacter->GetCombatState() != ECombatState::ECS_Unoccupied || Utility->GetWorld()->GetTimerManager().IsTimerActive(Utility->DefenseTimer)) { continue; }
+
+		Utility->Targets = MoveTemp(Job.Targets);
+		Utility->AbilitiesAvailable = MoveTemp(Job.Scores);
+		Utility->BestTargets = MoveTemp(Job.BestTargets);
+		Utility->LastPairsEvaluated = Job.PairsEvaluated;
+		Utility->ChooseBestAbility();
+	}
+	Snapshots[FrontIndex].Jobs.Reset();
+}
+
+void UCombatSnapshotSubsystem::LaunchJobs(FCombatSnapshot& Snapshot, int32 JobBatchSize, FGraphEventArray& OutEvents)
+{
+	JobBatchSize = FMath::Max(JobBatchSize, 1);
+
+	// Every job only writes the outputs of its own range of FUtilityJobs, everything else in the snapshot is read only
+	for (int32 Start = 0; Start < Snapshot.Jobs.Num(); Start += JobBatchSize)
+	{
+		const int32 End = FMath::Min(Start + JobBatchSize, Snapshot.Jobs.Num());
+		FCombatSnapshot* SnapshotPtr = &Snapshot;
+		OutEvents.Add(FFunctionGraphTask::CreateAndDispatchWhenReady([SnapshotPtr, Start, End]()
+		{
+			for (int32 Index = Start; Index < End; ++Index)
+			{
+				EvaluateJob(*SnapshotPtr, SnapshotPtr->Jobs[Index]);
+			}
+		}, TStatId(), nullptr, ENamedThreads::AnyBackgroundThreadNormalTask));
+	}
+}
+
+void UCombatSnapshotSubsystem::EvaluateJob(const FCombatSnapshot& Snapshot, FUtilityJob& Job)
+{
+	SCOPE_CYCLE_COUNTER(STAT_UtilityJob);
+
+	const FCombatantSnapshot* Self = Snapshot.Combatants.IsValidIndex(Job.Self.Index) ? &Snapshot.Combatants[Job.Self.Index] : nullptr;
+
+	// Same targets GatherTargets builds on the game thread, read from the snapshot instead of the actors
+	Job.Targets.Reset(Job.Candidates.Num());
+	for (int32 Index = 0; Index < Job.Candidates.Num(); ++Index)
+	{
+		const FCombatantHandle Handle = Job.Candidates[Index];
+		FUtilityTarget& Target = Job.Targets.AddDefaulted_GetRef();
+		Target.Handle = Handle;
+
+		const FCombatantSnapshot* Combatant = Snapshot.Combatants.IsValidIndex(Handle.Index) ? &Snapshot.Combatants[Handle.Index] : nullptr;
+		if(Self == nullptr || Combatant == nullptr || Combatant->Serial != Handle.Serial || !Combatant->bAlive) { continue; }
+
+		Target.bDetected = Index > 0 || Job.Agent.bEnemyDetected;
+		Target.Distance = FVector::Dist(Combatant->Location, Self->Location);
+		Target.bAttacking = Combatant->bAttacking;
+	}
+
+	Job.PairsEvaluated = UAI_UtilityComponent::ScoreTargets(Job.Agent, Job.Targets, Snapshot.bPrune, Job.Scores, Job.BestTargets);
+}
+
+void UCombatSnapshotSubsystem::Deinitialize()
+{
+	// Jobs point into the snapshots, they must be done before the subsystem goes away
+	if(InFlight.Num() > 0)
+	{
+		FTaskGraphInterface::Get().WaitUntilTasksComplete(InFlight, ENamedThreads::GameThread);
+		InFlight.Reset();
+	}
+	PendingRequests.Empty();
+
+	Super::Deinitialize();
+}
+
+void UCombatSnapshotSubsystem::RunScalingBenchmark(UWorld* World)
+{
+	if(World == nullptr) { return; }
+
+	// Agent settings come from a real AI so its archetype curves & behavior row are used
+	const UAI_UtilityComponent* Template = nullptr;
+	for (TActorIterator<AAI_BaseCharacter> It(World); It && Template == nullptr; ++It)
+	{
+		const UAI_UtilityComponent* Candidate = It->GetUtilityComponent();
+		Template = Candidate && Candidate->S_CombatBehavior ? Candidate : nullptr;
+	}
+	if(Template == nullptr)
+	{
+		UE_LOG(LogAIMeleeCombat, Warning, TEXT("AIMelee.Utility.ParallelBenchmark needs an AI with a combat behavior in the world"));
+		return;
+	}
+
+	constexpr int32 NumCombatants = 1024;
+	constexpr int32 NumAgents = 4096;
+	constexpr int32 NumCandidates = 8;
+	constexpr int32 NumRuns = 10;
+
+	const FUtilityAgentState Agent = Template->MakeAgentState();
+	const float Spread = Agent.Ranges.RangedAttackRange * 4.f;
+
+	FRandomStream Random(1234);
+	FCombatSnapshot Snapshot;
+	Snapshot.Combatants.SetNum(NumCombatants);
+	for (FCombatantSnapshot& Combatant : Snapshot.Combatants)
+	{
+		Combatant.Location = FVector(Random.FRandRange(-Spread, Spread), Random.FRandRange(-Spread, Spread), 0.f);
+		Combatant.bAlive = true;
+		Combatant.bAttacking = Random.FRand() < 0.25f;
+	}
+
+	Snapshot.Jobs.SetNum(NumAgents);
+	for (int32 Index = 0; Index < NumAgents; ++Index)
+	{
+		FUtilityJob& Job = Snapshot.Jobs[Index];
+		Job.Self = FCombatantHandle(Index % NumCombatants, 0);
+		Job.Agent = Agent;
+		Job.Agent.bEnemyDetected = true;
+		for (int32 Candidate = 0; Candidate < NumCandidates; ++Candidate)
+		{
+			Job.Candidates.Add(FCombatantHandle(Random.RandHelper(NumCombatants), 0));
+		}
+	}
+
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("Utility scaling: %d AI x %d targets, %d cores"), NumAgents, NumCandidates, FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+
+	// The task graph has a fixed number of workers, so each thread count gets a pool of its own with one job per thread
+	double SingleThreadMs = 0.0;
+	for (const int32 NumThreads : { 1, 2, 4, 8, 16 })
+	{
+		FQueuedThreadPool* Pool = FQueuedThreadPool::Allocate();
+		if(!Pool->Create(NumThreads, 128 * 1024, TPri_Normal, TEXT("UtilityBenchmarkPool")))
+		{
+			delete Pool;
+			break;
+		}
+
+		const int32 BatchSize = FMath::DivideAndRoundUp(NumAgents, NumThreads);
+		FCombatSnapshot* SnapshotPtr = &Snapshot;
+
+		double TotalSeconds = 0.0;
+		for (int32 Run = 0; Run < NumRuns; ++Run)
+		{
+			TArray<TFuture<void>> Futures;
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 Start = 0; Start < NumAgents; Start += BatchSize)
+			{
+				const int32 End = FMath::Min(Start + BatchSize, NumAgents);
+				Futures.Add(AsyncPool(*Pool, [SnapshotPtr, Start, End]()
+				{
+					for (int32 Index = Start; Index < End; ++Index)
+					{
+						EvaluateJob(*SnapshotPtr, SnapshotPtr->Jobs[Index]);
+					}
+				}));
+			}
+			for (TFuture<void>& Future : Futures)
+			{
+				Future.Wait();
+			}
+			TotalSeconds += FPlatformTime::Seconds() - StartTime;
+		}
+
+		Pool->Destroy();
+		delete Pool;
+
+		const double Ms = TotalSeconds / NumRuns * 1000.0;
+		SingleThreadMs = NumThreads == 1 ? Ms : SingleThreadMs;
+		UE_LOG(LogAIMeleeCombat, Log, TEXT("  %2d threads: %.3f ms per snapshot, %.2fx"), NumThreads, Ms, Ms > 0.0 ? SingleThreadMs / Ms : 0.0);
+	}
+}
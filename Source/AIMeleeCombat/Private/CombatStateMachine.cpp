@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatStateMachine.h"
+#include "AIMeleeCombat.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat Transitions"), STAT_CombatTransitions, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combat Transitions Rejected"), STAT_CombatTransitionsRejected, STATGROUP_AIMeleeCombat);
+
+namespace CombatTransitions
+{
+	constexpr ECombatState Unoccupied = ECombatState::ECS_Unoccupied;
+	constexpr ECombatState Attacking = ECombatState::ECS_Attacking;
+	constexpr ECombatState Dodging = ECombatState::ECS_Dodging;
+	constexpr ECombatState Blocking = ECombatState::ECS_Blocking;
+	constexpr ECombatState Stunned = ECombatState::ECS_Stunned;
+	constexpr ECombatState Dead = ECombatState::ECS_Dead;
+	constexpr ECombatState Illegal = ECombatState::ECS_MAX;
+
+	constexpr int32 NumStates = static_cast<int32>(ECombatState::ECS_MAX);
+	constexpr int32 NumEvents = static_cast<int32>(ECombatEvent::ECE_MAX);
+
+	// [State][Event], rows in ECombatState order & columns in ECombatEvent order
+	constexpr ECombatState Table[NumStates][NumEvents] =
+	{
+		//                Attack      Block       Dodge       Stun        ActionFinished  MoveFinished  Died  Revived
+		/* Unoccupied */ { Attacking, Blocking,   Dodging,    Stunned,    Unoccupied,     Unoccupied,   Dead, Illegal },
+		/* Attacking  */ { Illegal,   Illegal,    Illegal,    Stunned,    Unoccupied,     Illegal,      Dead, Illegal },
+		/* Dodging    */ { Illegal,   Illegal,    Illegal,    Illegal,    Unoccupied,     Illegal,      Dead, Illegal },
+		/* Blocking   */ { Illegal,   Illegal,    Illegal,    Stunned,    Unoccupied,     Illegal,      Dead, Illegal },
+		/* Stunned    */ { Illegal,   Illegal,    Illegal,    Illegal,    Unoccupied,     Illegal,      Dead, Illegal },
+		/* Patrol     */ { Attacking, Blocking,   Dodging,    Stunned,    Unoccupied,     Unoccupied,   Dead, Illegal },
+		/* Seek       */ { Attacking, Blocking,   Dodging,    Stunned,    Unoccupied,     Unoccupied,   Dead, Illegal },
+		/* Strafe     */ { Attacking, Blocking,   Dodging,    Stunned,    Unoccupied,     Unoccupied,   Dead, Illegal },
+		/* Dead       */ { Illegal,   Illegal,    Illegal,    Illegal,    Illegal,        Illegal,      Illegal, Unoccupied },
+	};
+
+	constexpr ECombatState Next(ECombatState State, ECombatEvent Event)
+	{
+		return Table[static_cast<int32>(State)][static_cast<int32>(Event)];
+	}
+
+	// A finished move can't cut an action short & nothing but a revive leaves Dead
+	static_assert(Next(Attacking, ECombatEvent::ECE_MoveFinished) == Illegal, "Move completion must not end an attack");
+	static_assert(Next(Blocking, ECombatEvent::ECE_MoveFinished) == Illegal, "Move completion must not end a block");
+	static_assert(Next(Dodging, ECombatEvent::ECE_MoveFinished) == Illegal, "Move completion must not end a dodge");
+	static_assert(Next(Dead, ECombatEvent::ECE_ActionFinished) == Illegal, "Dead AI can't become unoccupied");
+	static_assert(Next(Dead, ECombatEvent::ECE_Revived) == Unoccupied, "Revived AI start unoccupied");
+	static_assert(Next(Unoccupied, ECombatEvent::ECE_Attack) == Attacking, "Attacks start from unoccupied");
+}
+
+ECombatState FCombatStateMachine::GetNextState(ECombatState State, ECombatEvent Event)
+{
+	if(State >= ECombatState::ECS_MAX || Event >= ECombatEvent::ECE_MAX) { return ECombatState::ECS_MAX; }
+
+	return CombatTransitions::Next(State, Event);
+}
+
+bool FCombatStateMachine::Dispatch(ECombatEvent Event)
+{
+	const ECombatState NextState = GetNextState(State, Event);
+	if(NextState == ECombatState::ECS_MAX)
+	{
+		INC_DWORD_STAT(STAT_CombatTransitionsRejected);
+		UE_LOG(LogAIMeleeCombat, Verbose, TEXT("Rejected combat event %s in state %s"),
+			*UEnum::GetDisplayValueAsText(Event).ToString(), *UEnum::GetDisplayValueAsText(State).ToString());
+		return false;
+	}
+
+	if(!ensureMsgf(!bDispatching, TEXT("Combat event %s dispatched from inside a state hook"), *UEnum::GetDisplayValueAsText(Event).ToString()))
+	{
+		return false;
+	}
+
+	INC_DWORD_STAT(STAT_CombatTransitions);
+
+	const ECombatState OldState = State;
+	{
+		TGuardValue<bool> DispatchGuard(bDispatching, true);
+
+		OnExit.ExecuteIfBound(OldState);
+		State = NextState;
+		OnEnter.ExecuteIfBound(NextState);
+	}
+
+	// Outside the guard so listeners can react by dispatching their own events
+	OnStateChanged.Broadcast(OldState, NextState);
+	return true;
+}
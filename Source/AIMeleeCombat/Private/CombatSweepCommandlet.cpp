@@ -0,0 +1,227 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatSweepCommandlet.h"
+#include "AIMeleeCombat.h"
+#include "AI_UtilityComponent.h"
+#include "CombatArchetype.h"
+#include "CombatMontageTimings.h"
+#include "Animation/AnimMontage.h"
+#include "Engine/DataTable.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	const TCHAR* const AbilityNames[] = { TEXT("Seek"), TEXT("Strafe"), TEXT("Attack"), TEXT("RangedAttack"), TEXT("UltimateAttack"), TEXT("Dodge"), TEXT("Block") };
+	static_assert(UE_ARRAY_COUNT(AbilityNames) == static_cast<int32>(CombatCore::EAbility::Count), "One column per ability");
+
+	// Length & damage window of one montage section, the defaults are kept if the montage or section is missing
+	void ReadTiming(const TSoftObjectPtr<UAnimMontage>& SoftMontage, FName Section, CombatCore::FActionTiming& OutTiming)
+	{
+		const UAnimMontage* Montage = SoftMontage.LoadSynchronous();
+		const int32 SectionIndex = Montage ? Montage->GetSectionIndex(Section) : INDEX_NONE;
+		if(SectionIndex == INDEX_NONE) { return; }
+
+		OutTiming.Duration = Montage->GetSectionLength(SectionIndex);
+		const FMontageTimingTable Timings = FMontageTimingTable::Build(Montage);
+		const FDamageWindowTiming* DamageWindow = Timings.FindSection(Section);
+		OutTiming.ImpactTime = DamageWindow ? DamageWindow->Start : OutTiming.Duration * 0.5f;
+	}
+
+	void AppendRow(FString& Csv, int32 Candidate, const CombatCore::FBehaviorValues& Values, const TCHAR* Mode, const CombatCore::FMatchStats& Stats)
+	{
+		Csv += FString::Printf(TEXT("%d,%.3f,%.3f,%.3f,%.3f,%.3f,%s,%d,%.4f,%.4f,%.2f"),
+			Candidate, Values.Attack, Values.Block, Values.Dodge, Values.RangedAttack, Values.UltimateAttack, Mode, Stats.NumMatches,
+			Stats.Decisive > 0 ? static_cast<double>(Stats.WinsA) / Stats.Decisive : 0.0,
+			Stats.NumMatches > 0 ? 1.0 - static_cast<double>(Stats.Decisive) / Stats.NumMatches : 0.0,
+			Stats.Decisive > 0 ? Stats.TimeToKill / Stats.Decisive : 0.0);
+
+		for (int32 Ability = 0; Ability < static_cast<int32>(CombatCore::EAbility::Count); ++Ability)
+		{
+			Csv += FString::Printf(TEXT(",%.4f"), Stats.NumChoices > 0 ? static_cast<double>(Stats.AbilityUses[Ability]) / Stats.NumChoices : 0.0);
+		}
+		Csv += LINE_TERMINATOR;
+	}
+}
+
+UCombatSweepCommandlet::UCombatSweepCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+CombatCore::FMatchArchetype UCombatSweepCommandlet::MakeMatchArchetype(const UCombatArchetype* Archetype)
+{
+	CombatCore::FMatchArchetype MatchArchetype;
+	if(Archetype == nullptr) { return MatchArchetype; }
+
+	MatchArchetype.MaxHealth = Archetype->MaxHealth;
+	MatchArchetype.Ranges = { Archetype->AttackRange, Archetype->RangedAttackRange };
+	MatchArchetype.RangedDamage = Archetype->ProjectileDamage;
+
+	ReadTiming(Archetype->AttackMontage, "Attack01", MatchArchetype.Attack);
+	ReadTiming(Archetype->RangedAttackMontage, "Default", MatchArchetype.RangedAttack);
+	ReadTiming(Archetype->UltimateAttackMontage, "Default", MatchArchetype.UltimateAttack);
+	ReadTiming(Archetype->BlockingMontage, "Default", MatchArchetype.Block);
+	ReadTiming(Archetype->DodgingMontage, "DodgeLeft", MatchArchetype.Dodge);
+	return MatchArchetype;
+}
+
+void UCombatSweepCommandlet::MakeGrid(int32 Steps, TArray<CombatCore::FBehaviorValues>& OutCandidates)
+{
+	Steps = FMath::Clamp(Steps, 1, 10);
+
+	int32 NumCandidates = 1;
+	for (int32 Field = 0; Field < 5; ++Field)
+	{
+		NumCandidates *= Steps;
+	}
+
+	OutCandidates.Reserve(NumCandidates);
+	for (int32 Index = 0; Index < NumCandidates; ++Index)
+	{
+		// Index read as a five digit number in base Steps, one digit per behavior value
+		float Values[5];
+		int32 Digits = Index;
+		for (float& Value : Values)
+		{
+			Value = static_cast<float>(Digits % Steps + 1) / Steps;
+			Digits /= Steps;
+		}
+
+		CombatCore::FBehaviorValues& Candidate = OutCandidates.AddDefaulted_GetRef();
+		Candidate.Attack = Values[0];
+		Candidate.Block = Values[1];
+		Candidate.Dodge = Values[2];
+		Candidate.RangedAttack = Values[3];
+		Candidate.UltimateAttack = Values[4];
+	}
+}
+
+void UCombatSweepCommandlet::MakeRandomSample(int32 NumSamples, int32 Seed, TArray<CombatCore::FBehaviorValues>& OutCandidates)
+{
+	FRandomStream Random(Seed);
+	OutCandidates.Reserve(NumSamples);
+	for (int32 Index = 0; Index < NumSamples; ++Index)
+	{
+		CombatCore::FBehaviorValues& Candidate = OutCandidates.AddDefaulted_GetRef();
+		Candidate.Attack = Random.FRand();
+		Candidate.Block = Random.FRand();
+		Candidate.Dodge = Random.FRand();
+		Candidate.RangedAttack = Random.FRand();
+		Candidate.UltimateAttack = Random.FRand();
+	}
+}
+
+int32 UCombatSweepCommandlet::Main(const FString& Params)
+{
+	FString ArchetypePath;
+	FString TablePath;
+	FString RowName;
+	FString Mode = TEXT("Grid");
+	FString OutPath = FPaths::ProjectSavedDir() / TEXT("CombatSweep.csv");
+	int32 Steps = 3;
+	int32 NumSamples = 256;
+	int32 NumMatches = 200;
+	int32 TeamSize = 4;
+	int32 Seed = 1;
+
+	FParse::Value(*Params, TEXT("Archetype="), ArchetypePath);
+	FParse::Value(*Params, TEXT("Table="), TablePath);
+	FParse::Value(*Params, TEXT("Row="), RowName);
+	FParse::Value(*Params, TEXT("Mode="), Mode);
+	FParse::Value(*Params, TEXT("Out="), OutPath);
+	FParse::Value(*Params, TEXT("Steps="), Steps);
+	FParse::Value(*Params, TEXT("Samples="), NumSamples);
+	FParse::Value(*Params, TEXT("Matches="), NumMatches);
+	FParse::Value(*Params, TEXT("TeamSize="), TeamSize);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	NumMatches = FMath::Max(NumMatches, 1);
+
+	const UCombatArchetype* Archetype = ArchetypePath.IsEmpty() ? GetDefault<UCombatArchetype>() : LoadObject<UCombatArchetype>(nullptr, *ArchetypePath);
+	if(Archetype == nullptr)
+	{
+		UE_LOG(LogAIMeleeCombat, Error, TEXT("CombatSweep: couldn't load archetype %s"), *ArchetypePath);
+		return 1;
+	}
+	const CombatCore::FMatchArchetype MatchArchetype = MakeMatchArchetype(Archetype);
+
+	// Every candidate plays the baseline row, or middling values if there is none
+	CombatCore::FBehaviorValues Baseline = { 0.5f, 0.5f, 0.5f, 0.5f, 0.5f };
+	if(!TablePath.IsEmpty())
+	{
+		const UDataTable* Table = LoadObject<UDataTable>(nullptr, *TablePath);
+		const FCombatBehavior* Row = Table ? Table->FindRow<FCombatBehavior>(FName(*RowName), TEXT("CombatSweep")) : nullptr;
+		if(Row == nullptr)
+		{
+			UE_LOG(LogAIMeleeCombat, Error, TEXT("CombatSweep: couldn't find row %s in %s"), *RowName, *TablePath);
+			return 1;
+		}
+		Baseline = { Row->AttackValue, Row->BlockValue, Row->DodgeValue, Row->RangedAttackValue, Row->UltimateAttackValue };
+	}
+
+	TArray<CombatCore::FBehaviorValues> Candidates;
+	if(Mode.Equals(TEXT("Random"), ESearchCase::IgnoreCase))
+	{
+		MakeRandomSample(NumSamples, Seed, Candidates);
+	}
+	else
+	{
+		MakeGrid(Steps, Candidates);
+	}
+
+	UE_LOG(LogAIMeleeCombat, Display, TEXT("CombatSweep: %d candidates x %d matches (1v1 & %dv%d) against %s, %d workers"),
+		Candidates.Num(), NumMatches, TeamSize, TeamSize, TablePath.IsEmpty() ? TEXT("the 0.5 baseline") : *RowName, FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+
+	CombatCore::FMatchConfig DuelConfig;
+	DuelConfig.TeamSize = 1;
+	CombatCore::FMatchConfig TeamConfig;
+	TeamConfig.TeamSize = FMath::Max(TeamSize, 1);
+
+	// One candidate per task, each with its own stats & random stream seeded from its index so results don't depend on scheduling
+	TArray<CombatCore::FMatchStats> DuelStats;
+	TArray<CombatCore::FMatchStats> TeamStats;
+	DuelStats.SetNum(Candidates.Num());
+	TeamStats.SetNum(Candidates.Num());
+
+	const double StartTime = FPlatformTime::Seconds();
+	ParallelFor(Candidates.Num(), [&](int32 Index)
+	{
+		CombatCore::FCombatRandom Random(static_cast<uint32>(Seed) * 7919u + static_cast<uint32>(Index) + 1u);
+		for (int32 Match = 0; Match < NumMatches; ++Match)
+		{
+			CombatCore::SimulateMatch(Candidates[Index], Baseline, MatchArchetype, DuelConfig, Random, DuelStats[Index]);
+			CombatCore::SimulateMatch(Candidates[Index], Baseline, MatchArchetype, TeamConfig, Random, TeamStats[Index]);
+		}
+	});
+	const double Seconds = FPlatformTime::Seconds() - StartTime;
+
+	FString Csv = TEXT("Candidate,AttackValue,BlockValue,DodgeValue,RangedAttackValue,UltimateAttackValue,Mode,Matches,WinRate,DrawRate,MeanTimeToKill");
+	for (const TCHAR* AbilityName : AbilityNames)
+	{
+		Csv += FString::Printf(TEXT(",%sUse"), AbilityName);
+	}
+	Csv += LINE_TERMINATOR;
+
+	const FString TeamMode = FString::Printf(TEXT("%dv%d"), TeamConfig.TeamSize, TeamConfig.TeamSize);
+	for (int32 Index = 0; Index < Candidates.Num(); ++Index)
+	{
+		AppendRow(Csv, Index, Candidates[Index], TEXT("1v1"), DuelStats[Index]);
+		AppendRow(Csv, Index, Candidates[Index], *TeamMode, TeamStats[Index]);
+	}
+
+	if(!FFileHelper::SaveStringToFile(Csv, *OutPath))
+	{
+		UE_LOG(LogAIMeleeCombat, Error, TEXT("CombatSweep: couldn't write %s"), *OutPath);
+		return 1;
+	}
+
+	const int32 TotalMatches = Candidates.Num() * NumMatches * 2;
+	UE_LOG(LogAIMeleeCombat, Display, TEXT("CombatSweep: %d matches in %.1f s (%.0f matches per minute), results in %s"),
+		TotalMatches, Seconds, Seconds > 0.0 ? TotalMatches / Seconds * 60.0 : 0.0, *OutPath);
+	return 0;
+}
@@ -0,0 +1,148 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatantRegistry.h"
+#include "AI_BaseCharacter.h"
+#include "PlayerCharacter.h"
+#include "AIMeleeCombatSettings.h"
+#include "Engine/World.h"
+
+UCombatantRegistry* UCombatantRegistry::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UCombatantRegistry>() : nullptr;
+}
+
+FCombatantHandle UCombatantRegistry::Register(ACharacter* Character, ECombatantKind Kind, int32 TeamNumber)
+{
+	if(Character == nullptr || Kind == ECombatantKind::ECK_None) { return FCombatantHandle(); }
+
+	// Already registered (e.g. PostInitializeComponents called again after a level reload)
+	if(const int32* ExistingIndex = ActorToIndex.Find(Character))
+	{
+		return FCombatantHandle(*ExistingIndex, Records[*ExistingIndex].Serial);
+	}
+
+	int32 Index;
+	if(FreeIndices.Num() > 0)
+	{
+		Index = FreeIndices.Pop(false);
+	}
+	else
+	{
+		Index = Records.AddDefaulted();
+		Characters.AddZeroed();
+	}
+
+	FCombatantRecord& Record = Records[Index];
+
+	// Serial 0 is never handed out so a default constructed handle can't match a live slot
+	Record.Serial = Record.Serial == MAX_uint16 ? 1 : static_cast<uint16>(Record.Serial + 1);
+	Record.Team = static_cast<uint8>(FMath::Clamp(TeamNumber, 0, 255));
+	Record.Kind = Kind;
+	Record.bIsDead = false;
+
+	Characters[Index] = Character;
+	ActorToIndex.Add(Character, Index);
+
+	return FCombatantHandle(Index, Record.Serial);
+}
+
+void UCombatantRegistry::Unregister(FCombatantHandle Handle)
+{
+	if(FindRecord(Handle) == nullptr) { return; }
+
+	ActorToIndex.Remove(Characters[Handle.Index]);
+	Characters[Handle.Index] = nullptr;
+
+	// Keep the serial so the next combatant in this slot gets a new one
+	FCombatantRecord& Record = Records[Handle.Index];
+	Record.Kind = ECombatantKind::ECK_None;
+	Record.bIsDead = false;
+
+	FreeIndices.Add(Handle.Index);
+}
+
+FCombatantHandle UCombatantRegistry::FindHandle(const AActor* Actor) const
+{
+	const int32* Index = ActorToIndex.Find(Actor);
+	return Index ? FCombatantHandle(*Index, Records[*Index].Serial) : FCombatantHandle();
+}
+
+bool UCombatantRegistry::IsRegistered(FCombatantHandle Handle) const
+{
+	return FindRecord(Handle) != nullptr;
+}
+
+bool UCombatantRegistry::AreEnemies(FCombatantHandle A, FCombatantHandle B) const
+{
+	const FCombatantRecord* RecordA = FindRecord(A);
+	const FCombatantRecord* RecordB = FindRecord(B);
+	if(RecordA == nullptr || RecordB == nullptr) { return false; }
+
+	return UAIMeleeCombatSettings::GetTeamAttitude(FGenericTeamId(RecordA->Team), FGenericTeamId(RecordB->Team)) == ETeamAttitude::Hostile;
+}
+
+void UCombatantRegistry::SetDead(FCombatantHandle Handle)
+{
+	if(FindRecord(Handle))
+	{
+		Records[Handle.Index].bIsDead = true;
+	}
+}
+
+void UCombatantRegistry::SetTeam(FCombatantHandle Handle, int32 TeamNumber)
+{
+	if(FindRecord(Handle))
+	{
+		Records[Handle.Index].Team = static_cast<uint8>(FMath::Clamp(TeamNumber, 0, 255));
+	}
+}
+
+bool UCombatantRegistry::IsAlive(FCombatantHandle Handle) const
+{
+	const FCombatantRecord* Record = FindRecord(Handle);
+	return Record && !Record->bIsDead;
+}
+
+ECombatantKind UCombatantRegistry::GetKind(FCombatantHandle Handle) const
+{
+	const FCombatantRecord* Record = FindRecord(Handle);
+	return Record ? Record->Kind : ECombatantKind::ECK_None;
+}
+
+ACharacter* UCombatantRegistry::GetCharacter(FCombatantHandle Handle) const
+{
+	return FindRecord(Handle) ? Characters[Handle.Index] : nullptr;
+}
+
+// The kind was recorded at registration, so a static_cast is safe here
+AAI_BaseCharacter* UCombatantRegistry::GetAICharacter(FCombatantHandle Handle) const
+{
+	const FCombatantRecord* Record = FindRecord(Handle);
+	return (Record && Record->Kind == ECombatantKind::ECK_AI) ? static_cast<AAI_BaseCharacter*>(Characters[Handle.Index]) : nullptr;
+}
+
+APlayerCharacter* UCombatantRegistry::GetPlayerCharacter(FCombatantHandle Handle) const
+{
+	const FCombatantRecord* Record = FindRecord(Handle);
+	return (Record && Record->Kind == ECombatantKind::ECK_Player) ? static_cast<APlayerCharacter*>(Characters[Handle.Index]) : nullptr;
+}
+
+void UCombatantRegistry::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// Perception & the registry both read the same baked matrix
+	GetDefault<UAIMeleeCombatSettings>()->ApplyTeamAttitudes();
+}
+
+void UCombatantRegistry::Deinitialize()
+{
+	Records.Empty();
+	Characters.Empty();
+	ActorToIndex.Empty();
+	FreeIndices.Empty();
+
+	Super::Deinitialize();
+}
@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CorpseSubsystem.h"
+#include "AIMeleeCombat.h"
+#include "AIMeleeCombatSettings.h"
+#include "AI_BaseCharacter.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Corpses"), STAT_Corpses, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Combatants"), STAT_PooledCombatants, STATGROUP_AIMeleeCombat);
+
+static FAutoConsoleCommandWithWorld CorpseReportCommand(
+	TEXT("AIMelee.Corpses.Report"),
+	TEXT("Logs how many corpses are in the world & how many combatants are pooled"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if(const UCorpseSubsystem* CorpseSubsystem = World ? World->GetSubsystem<UCorpseSubsystem>() : nullptr)
+		{
+			CorpseSubsystem->LogReport();
+		}
+	}));
+
+UCorpseSubsystem* UCorpseSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UCorpseSubsystem>() : nullptr;
+}
+
+void UCorpseSubsystem::AddCorpse(AAI_BaseCharacter* Corpse)
+{
+	if(Corpse == nullptr || Corpses.Contains(Corpse)) { return; }
+
+	Corpses.Add(Corpse);
+
+	const int32 CorpseBudget = GetDefault<UAIMeleeCombatSettings>()->CorpseBudget;
+	while (Corpses.Num() > CorpseBudget)
+	{
+		EvictOldestCorpse();
+	}
+
+	UpdateStats();
+}
+
+void UCorpseSubsystem::EvictOldestCorpse()
+{
+	AAI_BaseCharacter* Corpse = Corpses[0];
+	Corpses.RemoveAt(0);
+
+	if(!IsValid(Corpse)) { return; }
+
+	const UAIMeleeCombatSettings* Settings = GetDefault<UAIMeleeCombatSettings>();
+	if(Settings->bPoolEvictedCorpses && Pool.Num() < Settings->CorpsePoolSize)
+	{
+		// Freezes straight away if the corpse was evicted before its freeze delay ran out
+		Corpse->FreezeCorpse();
+		Corpse->SetActorHiddenInGame(true);
+		Pool.Add(Corpse);
+	}
+	else
+	{
+		Corpse->Destroy();
+	}
+}
+
+AAI_BaseCharacter* UCorpseSubsystem::AcquirePooledCombatant(TSubclassOf<AAI_BaseCharacter> CombatantClass, const UCombatArchetype* Archetype)
+{
+	// Drop anything destroyed behind our back (e.g. by level streaming)
+	Pool.RemoveAll([](const AAI_BaseCharacter* Pooled) { return !IsValid(Pooled); });
+
+	const int32 Index = Pool.IndexOfByPredicate([CombatantClass, Archetype](const AAI_BaseCharacter* Pooled)
+	{
+		return Pooled->GetClass() == CombatantClass && (Archetype == nullptr || Pooled->GetArchetype() == Archetype);
+	});
+	if(Index == INDEX_NONE) { return nullptr; }
+
+	AAI_BaseCharacter* Combatant = Pool[Index];
+	Pool.RemoveAtSwap(Index);
+	UpdateStats();
+
+	return Combatant;
+}
+
+void UCorpseSubsystem::UpdateStats() const
+{
+	SET_DWORD_STAT(STAT_Corpses, Corpses.Num());
+	SET_DWORD_STAT(STAT_PooledCombatants, Pool.Num());
+}
+
+void UCorpseSubsystem::LogReport() const
+{
+	const UAIMeleeCombatSettings* Settings = GetDefault<UAIMeleeCombatSettings>();
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("Corpses: %d / %d budget, pooled combatants: %d / %d"), Corpses.Num(), Settings->CorpseBudget, Pool.Num(), Settings->bPoolEvictedCorpses ? Settings->CorpsePoolSize : 0);
+}
+
+void UCorpseSubsystem::Deinitialize()
+{
+	Corpses.Empty();
+	Pool.Empty();
+
+	Super::Deinitialize();
+}
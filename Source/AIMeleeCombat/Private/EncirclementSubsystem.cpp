@@ -0,0 +1,236 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EncirclementSubsystem.h"
+#include "AIMeleeCombat.h"
+#include "AIMeleeCombatSettings.h"
+#include "AI_BaseCharacter.h"
+#include "CombatArchetype.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Encirclement Slots Assigned"), STAT_EncirclementAssigned, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Encirclement Swaps"), STAT_EncirclementSwaps, STATGROUP_AIMeleeCombat);
+
+static FAutoConsoleCommandWithWorld EncirclementReportCommand(
+	TEXT("AIMelee.Encirclement.Report"),
+	TEXT("Logs the slot rings around every contested target & the agents in them"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if(const UEncirclementSubsystem* Encirclement = World ? World->GetSubsystem<UEncirclementSubsystem>() : nullptr)
+		{
+			Encirclement->LogReport();
+		}
+	}));
+
+namespace
+{
+	// Slots sit a little inside the range so agents standing in them are in range
+	constexpr float SlotRangeFraction = 0.8f;
+}
+
+UEncirclementSubsystem* UEncirclementSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UEncirclementSubsystem>() : nullptr;
+}
+
+UEncirclementSubsystem::ERing UEncirclementSubsystem::GetRing(const AAI_BaseCharacter* Agent)
+{
+	return Agent->GetArchetype()->HasRangedAttack() ? Ranged : Melee;
+}
+
+FVector UEncirclementSubsystem::GetSlotLocation(const AAI_BaseCharacter* Agent, const FVector& TargetLocation, ERing Ring, int32 Slot, int32 NumSlots)
+{
+	const UCombatArchetype* Archetype = Agent->GetArchetype();
+	const float Radius = (Ring == Ranged ? Archetype->RangedAttackRange : Archetype->AttackRange) * SlotRangeFraction;
+	const float Angle = 2.f * PI * Slot / NumSlots;
+	return TargetLocation + FVector(FMath::Cos(Angle) * Radius, FMath::Sin(Angle) * Radius, 0.f);
+}
+
+float UEncirclementSubsystem::GetSlotCost(const AAI_BaseCharacter* Agent, const FVector& TargetLocation, ERing Ring, int32 Slot, int32 NumSlots)
+{
+	return FVector::Dist2D(Agent->GetActorLocation(), GetSlotLocation(Agent, TargetLocation, Ring, Slot, NumSlots));
+}
+
+bool UEncirclementSubsystem::GetSlotGoal(const AAI_BaseCharacter* Agent, FVector& OutGoal)
+{
+	const ACharacter* Target = Agent ? Agent->GetEnemyCharacter() : nullptr;
+	if(Target == nullptr) { return false; }
+
+	const FCombatantHandle AgentHandle = Agent->GetCombatantHandle();
+	const FCombatantHandle TargetHandle = Agent->GetEnemyHandle();
+	const FVector TargetLocation = Target->GetActorLocation();
+	const ERing Ring = GetRing(Agent);
+
+	// Kept until the agent leaves or changes target, so its goal only moves with the target
+	FAssignment* Assignment = Assignments.Find(AgentHandle);
+	if(Assignment && (Assignment->Target != TargetHandle || Assignment->Ring != Ring))
+	{
+		Leave(AgentHandle);
+		Assignment = nullptr;
+	}
+
+	int32 Slot = Assignment ? Assignment->Slot : AssignSlot(Agent, TargetHandle, TargetLocation, Ring);
+	if(Slot == INDEX_NONE) { return false; }
+
+	OutGoal = GetSlotLocation(Agent, TargetLocation, Ring, Slot, Rings.FindChecked(TargetHandle).Slots[Ring].Num());
+	return true;
+}
+
+int32 UEncirclementSubsystem::AssignSlot(const AAI_BaseCharacter* Agent, FCombatantHandle Target, const FVector& TargetLocation, ERing Ring)
+{
+	const UAIMeleeCombatSettings* Settings = GetDefault<UAIMeleeCombatSettings>();
+	const UCombatantRegistry* Registry = UCombatantRegistry::Get(this);
+
+	TArray<FCombatantHandle>& Slots = Rings.FindOrAdd(Target).Slots[Ring];
+	if(Slots.Num() == 0)
+	{
+		Slots.SetNum(FMath::Max(Ring == Ranged ? Settings->EncirclementRangedSlots : Settings->EncirclementMeleeSlots, 1));
+	}
+	const int32 NumSlots = Slots.Num();
+
+	int32 FreeSlot = INDEX_NONE;
+	float FreeCost = MAX_flt;
+	for (int32 Slot = 0; Slot < NumSlots; ++Slot)
+	{
+		if(Slots[Slot].IsValid()) { continue; }
+
+		const float Cost = GetSlotCost(Agent, TargetLocation, Ring, Slot, NumSlots);
+		if(Cost < FreeCost)
+		{
+			FreeSlot = Slot;
+			FreeCost = Cost;
+		}
+	}
+
+	if(FreeSlot == INDEX_NONE)
+	{
+		++NumFull;
+		return INDEX_NONE;
+	}
+
+	// An agent arriving from the side already taken may be better off in an occupied slot, with its owner moving to the free one
+	// Only swaps that save more than the margin, so settled agents aren't pushed around by every newcomer
+	int32 SwapSlot = INDEX_NONE;
+	const AAI_BaseCharacter* SwapAgent = nullptr;
+	float BestSaving = Settings->EncirclementSwapMargin;
+	for (int32 Slot = 0; Slot < NumSlots && Registry; ++Slot)
+	{
+		const AAI_BaseCharacter* Owner = Slots[Slot].IsValid() ? Registry->GetAICharacter(Slots[Slot]) : nullptr;
+		if(Owner == nullptr) { continue; }
+
+		const float CurrentCost = FreeCost + GetSlotCost(Owner, TargetLocation, Ring, Slot, NumSlots);
+		const float SwappedCost = GetSlotCost(Agent, TargetLocation, Ring, Slot, NumSlots) + GetSlotCost(Owner, TargetLocation, Ring, FreeSlot, NumSlots);
+		if(CurrentCost - SwappedCost > BestSaving)
+		{
+			BestSaving = CurrentCost - SwappedCost;
+			SwapSlot = Slot;
+			SwapAgent = Owner;
+		}
+	}
+
+	int32 AgentSlot = FreeSlot;
+	if(SwapAgent)
+	{
+		Slots[FreeSlot] = Slots[SwapSlot];
+		Assignments.FindChecked(Slots[FreeSlot]).Slot = FreeSlot;
+		AgentSlot = SwapSlot;
+
+		++NumSwaps;
+		INC_DWORD_STAT(STAT_EncirclementSwaps);
+	}
+
+	const FCombatantHandle AgentHandle = Agent->GetCombatantHandle();
+	Slots[AgentSlot] = AgentHandle;
+
+	FAssignment& Assignment = Assignments.Add(AgentHandle);
+	Assignment.Target = Target;
+	Assignment.Ring = Ring;
+	Assignment.Slot = AgentSlot;
+
+	SET_DWORD_STAT(STAT_EncirclementAssigned, Assignments.Num());
+	return AgentSlot;
+}
+
+void UEncirclementSubsystem::Leave(FCombatantHandle Agent)
+{
+	FAssignment Assignment;
+	if(!Assignments.RemoveAndCopyValue(Agent, Assignment)) { return; }
+
+	if(FTargetRings* TargetRings = Rings.Find(Assignment.Target))
+	{
+		TArray<FCombatantHandle>& Slots = TargetRings->Slots[Assignment.Ring];
+		if(Slots.IsValidIndex(Assignment.Slot) && Slots[Assignment.Slot] == Agent)
+		{
+			Slots[Assignment.Slot].Reset();
+		}
+
+		// Rings of targets nobody is after any more (including dead ones) go with their last agent
+		bool bEmpty = true;
+		for (const TArray<FCombatantHandle>& RingSlots : TargetRings->Slots)
+		{
+			for (const FCombatantHandle& Handle : RingSlots)
+			{
+				bEmpty &= !Handle.IsValid();
+			}
+		}
+		if(bEmpty)
+		{
+			Rings.Remove(Assignment.Target);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_EncirclementAssigned, Assignments.Num());
+}
+
+void UEncirclementSubsystem::ReleaseTarget(FCombatantHandle Target)
+{
+	FTargetRings TargetRings;
+	if(!Rings.RemoveAndCopyValue(Target, TargetRings)) { return; }
+
+	for (const TArray<FCombatantHandle>& Slots : TargetRings.Slots)
+	{
+		for (const FCombatantHandle& Agent : Slots)
+		{
+			if(Agent.IsValid())
+			{
+				Assignments.Remove(Agent);
+			}
+		}
+	}
+
+	SET_DWORD_STAT(STAT_EncirclementAssigned, Assignments.Num());
+}
+
+void UEncirclementSubsystem::LogReport() const
+{
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("Encirclement: %d contested targets, %d agents in slots, %d swaps, %d joins to a full ring"),
+		Rings.Num(), Assignments.Num(), NumSwaps, NumFull);
+
+	const UCombatantRegistry* Registry = UCombatantRegistry::Get(this);
+	for (const TPair<FCombatantHandle, FTargetRings>& Pair : Rings)
+	{
+		const ACharacter* Target = Registry ? Registry->GetCharacter(Pair.Key) : nullptr;
+		for (int32 Ring = 0; Ring < NumRings; ++Ring)
+		{
+			const TArray<FCombatantHandle>& Slots = Pair.Value.Slots[Ring];
+			if(Slots.Num() == 0) { continue; }
+
+			int32 NumOccupied = 0;
+			for (const FCombatantHandle& Handle : Slots)
+			{
+				NumOccupied += Handle.IsValid() ? 1 : 0;
+			}
+			UE_LOG(LogAIMeleeCombat, Log, TEXT("  %s %s ring: %d / %d slots"), Target ? *Target->GetName() : TEXT("(gone)"),
+				Ring == Ranged ? TEXT("ranged") : TEXT("melee"), NumOccupied, Slots.Num());
+		}
+	}
+}
+
+void UEncirclementSubsystem::Deinitialize()
+{
+	Rings.Empty();
+	Assignments.Empty();
+
+	Super::Deinitialize();
+}
@@ -9,8 +9,11 @@
 #include "Components/CapsuleComponent.h"
 #include "Kismet/KismetSystemLibrary.h"
 #include "Kismet/GameplayStatics.h"
-#include "AI_BaseCharacter.h"
 #include "Kismet/KismetMathLibrary.h"
+#include "CombatantRegistry.h"
+#include "CombatAssetStreamer.h"
+#include "AttackTelegraphSubsystem.h"
+#include "EncirclementSubsystem.h"
 
 // Sets default values
 APlayerCharacter::APlayerCharacter() :
@@ -25,6 +28,7 @@ APlayerCharacter::APlayerCharacter() :
 	bAttacking(false),
 	bIsDead(false),
 	bIsDodging(false),
+	bDamageWindowActive(false),
 	TeamNumber(0),
 	CurrentHP(200),
 	MaxHP(200)
@@ -70,6 +74,56 @@ void APlayerCharacter::BeginPlay()
 	
 }
 
+void APlayerCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	if(!GetWorld()->IsGameWorld()) { return; }
+
+	CombatantRegistry = UCombatantRegistry::Get(this);
+	if(CombatantRegistry)
+	{
+		CombatantHandle = CombatantRegistry->Register(this, ECombatantKind::ECK_Player, TeamNumber);
+	}
+
+	if(UCombatAssetStreamer* Streamer = UCombatAssetStreamer::Get(this))
+	{
+		TArray<FSoftObjectPath> MontagePaths;
+		for (const TSoftObjectPtr<UAnimMontage>* Montage : { &DodgeMontage, &AttackMontage, &DeathMontage })
+		{
+			if(!Montage->IsNull())
+			{
+				MontagePaths.AddUnique(Montage->ToSoftObjectPath());
+			}
+		}
+		Streamer->Acquire(this, MontagePaths);
+	}
+}
+
+void APlayerCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(GetWorld()->IsGameWorld())
+	{
+		if(UCombatAssetStreamer* Streamer = UCombatAssetStreamer::Get(this))
+		{
+			Streamer->Release(this);
+		}
+	}
+
+	if(UEncirclementSubsystem* Encirclement = UEncirclementSubsystem::Get(this))
+	{
+		Encirclement->ReleaseTarget(CombatantHandle);
+	}
+
+	if(CombatantRegistry)
+	{
+		CombatantRegistry->Unregister(CombatantHandle);
+		CombatantHandle.Reset();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void APlayerCharacter::MoveForwardBackward(float Value)
 {
 	if(PlayerCombatState == EPlayerCombatState::ECS_Unoccupied || PlayerCombatState == EPlayerCombatState::ECS_Dodging)
@@ -173,7 +227,7 @@ void APlayerCharacter::AttackCombo()
 {
 	if (bCanAttack)
 	{
-		if (AttackMontage)
+		if (UAnimMontage* Attack = AttackMontage.Get())
 		{
 			FName SectionName;
 			switch (ComboIndex)
@@ -197,7 +251,13 @@ void APlayerCharacter::AttackCombo()
 			PlayerCombatState = EPlayerCombatState::ECS_Attacking;
 			bAttacking = true;
 			bCanAttack = false;
-			SetMontageToPlay(AttackMontage, SectionName);
+			SetMontageToPlay(Attack, SectionName);
+
+			// Lets nearby AI block or dodge without waiting for their next think
+			if(UAttackTelegraphSubsystem* Telegraphs = UAttackTelegraphSubsystem::Get(this))
+			{
+				Telegraphs->BroadcastAttack(this, CombatantHandle, Attack, SectionName);
+			}
 		}
 		
 	}
@@ -207,6 +267,10 @@ void APlayerCharacter::DodgeButtonPressed()
 {
 	if(PlayerCombatState != EPlayerCombatState::ECS_Unoccupied) {return;}
 
+	// Still streaming in, nothing would end the dodge
+	UAnimMontage* Dodge = DodgeMontage.Get();
+	if(Dodge == nullptr) {return;}
+
 	// Dodge animations are split into sections in the DodgeMontage (section name determines which dodge animation to play)
 	FName SectionName = "Forward";
 
@@ -231,7 +295,7 @@ void APlayerCharacter::DodgeButtonPressed()
 	GetMesh()->SetCollisionResponseToChannel(ECollisionChannel::ECC_Visibility, ECR_Ignore);
 	GetCapsuleComponent()->SetCollisionResponseToChannel(ECollisionChannel::ECC_Pawn, ECR_Overlap);
 
-	SetMontageToPlay(DodgeMontage, SectionName);
+	SetMontageToPlay(Dodge, SectionName);
 	bIsDodging = true;
 	PlayerCombatState = EPlayerCombatState::ECS_Dodging;
 }
@@ -274,19 +338,28 @@ void APlayerCharacter::SetUnoccupied()
 	}
 }
 
-bool APlayerCharacter::IsEnemy(AActor* Target)
+bool APlayerCharacter::IsEnemy(const AActor* Target) const
 {
-	AAI_BaseCharacter* Enemy = Cast<AAI_BaseCharacter>(Target);
+	if(CombatantRegistry == nullptr) { return false; }
 
-	if(Enemy && TeamNumber != Enemy->GetTeamNumber())
-	{
-		return true;
-	}
-	else
+	// Only AI can be damaged by the player
+	const FCombatantHandle TargetHandle = CombatantRegistry->FindHandle(Target);
+	return CombatantRegistry->GetKind(TargetHandle) == ECombatantKind::ECK_AI && CombatantRegistry->AreEnemies(CombatantHandle, TargetHandle);
+}
+
+FGenericTeamId APlayerCharacter::GetGenericTeamId() const
+{
+	return FGenericTeamId(static_cast<uint8>(FMath::Clamp(TeamNumber, 0, 255)));
+}
+
+void APlayerCharacter::SetGenericTeamId(const FGenericTeamId& NewTeamID)
+{
+	TeamNumber = NewTeamID.GetId();
+
+	if(CombatantRegistry)
 	{
-		return false;
+		CombatantRegistry->SetTeam(CombatantHandle, TeamNumber);
 	}
-	
 }
 
 void APlayerCharacter::DamageDetectTrace()
@@ -316,6 +389,36 @@ void APlayerCharacter::DamageDetectTrace()
 	}
 }
 
+void APlayerCharacter::BeginDamageWindow()
+{
+	bDamageWindowActive = true;
+	AlreadyDamagedActors.Reset();
+}
+
+void APlayerCharacter::TickDamageWindow()
+{
+	DamageDetectTrace();
+}
+
+// Clears damaged actors so the next attack can damage them again
+void APlayerCharacter::EndDamageWindow()
+{
+	bDamageWindowActive = false;
+	AlreadyDamagedActors.Reset();
+}
+
+// Moves on to the next attack section & lets the attack button queue it
+void APlayerCharacter::AdvanceCombo()
+{
+	ComboIndex = (ComboIndex + 1) % 4;
+	bCanAttack = true;
+}
+
+void APlayerCharacter::EndAction()
+{
+	SetUnoccupied();
+}
+
 void APlayerCharacter::DamageEnemy(AActor* Enemy)
 {
 	constexpr float Damage = 20.0f;
@@ -330,7 +433,7 @@ void APlayerCharacter::Death()
 	AnimInstance->StopAllMontages(0.1f);
 
 	const int32 DeathIndex = UKismetMathLibrary::RandomIntegerInRange(0, 1);
-	if(DeathMontage)
+	if(UAnimMontage* DeathAnimation = DeathMontage.Get())
 	{
 		FName SectionName;
 		switch (DeathIndex)
@@ -345,11 +448,22 @@ void APlayerCharacter::Death()
 			break;
 		}
 
-		SetMontageToPlay(DeathMontage, SectionName);
+		SetMontageToPlay(DeathAnimation, SectionName);
 	}
 
 	bIsDead = true;
 	PlayerCombatState = EPlayerCombatState::ECS_Dead;
+
+	if(CombatantRegistry)
+	{
+		CombatantRegistry->SetDead(CombatantHandle);
+	}
+
+	// The AI surrounding the player stop holding their slots around a corpse
+	if(UEncirclementSubsystem* Encirclement = UEncirclementSubsystem::Get(this))
+	{
+		Encirclement->ReleaseTarget(CombatantHandle);
+	}
 }
 
 void APlayerCharacter::QuitGame()
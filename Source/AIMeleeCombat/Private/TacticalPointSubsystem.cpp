@@ -0,0 +1,236 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TacticalPointSubsystem.h"
+#include "AIMeleeCombat.h"
+#include "AIMeleeCombatSettings.h"
+#include "AI_BaseCharacter.h"
+#include "CombatArchetype.h"
+#include "NavigationSystem.h"
+#include "NavigationData.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Tactical Queries"), STAT_TacticalQueries, STATGROUP_AIMeleeCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Tactical Cache Misses"), STAT_TacticalCacheMisses, STATGROUP_AIMeleeCombat);
+DECLARE_CYCLE_STAT(TEXT("Tactical Generate"), STAT_TacticalGenerate, STATGROUP_AIMeleeCombat);
+DECLARE_CYCLE_STAT(TEXT("Tactical Score"), STAT_TacticalScore, STATGROUP_AIMeleeCombat);
+
+static FAutoConsoleCommandWithWorld TacticalReportCommand(
+	TEXT("AIMelee.Tactical.Report"),
+	TEXT("Logs the tactical point queries, cache hits & failed queries"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if(const UTacticalPointSubsystem* Tactical = World ? World->GetSubsystem<UTacticalPointSubsystem>() : nullptr)
+		{
+			Tactical->LogReport();
+		}
+	}));
+
+namespace
+{
+	// Score weights, the band & spacing matter most, line of sight breaks ties between otherwise equal spots
+	constexpr float SpacingWeight = 0.4f;
+	constexpr float BandWeight = 0.3f;
+	constexpr float TravelWeight = 0.2f;
+	constexpr float LineOfSightWeight = 0.1f;
+
+	// Targets that moved further than this since the candidates were generated get new ones
+	constexpr float CacheTargetTolerance = 100.f;
+}
+
+UTacticalPointSubsystem* UTacticalPointSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UTacticalPointSubsystem>() : nullptr;
+}
+
+bool UTacticalPointSubsystem::FindPoint(const AAI_BaseCharacter* Querier, float MinDistance, float MaxDistance, FVector& OutPoint)
+{
+	const ACharacter* Target = Querier ? Querier->GetEnemyCharacter() : nullptr;
+	const UCombatantRegistry* Registry = UCombatantRegistry::Get(this);
+	if(Target == nullptr || Registry == nullptr) { return false; }
+
+	++NumQueries;
+	INC_DWORD_STAT(STAT_TacticalQueries);
+
+	const UAIMeleeCombatSettings* Settings = GetDefault<UAIMeleeCombatSettings>();
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	FTacticalCacheKey Key;
+	Key.Target = Querier->GetEnemyHandle();
+	Key.MinDistance = FMath::RoundToInt(MinDistance);
+	Key.MaxDistance = FMath::RoundToInt(MaxDistance);
+
+	FTacticalCache& Cache = Caches.FindOrAdd(Key);
+	const bool bCacheValid = Cache.Time >= 0.f && Now - Cache.Time <= Settings->TacticalCacheSeconds
+		&& FVector::DistSquared(Cache.TargetLocation, Target->GetActorLocation()) <= FMath::Square(CacheTargetTolerance);
+	if(bCacheValid)
+	{
+		++NumCacheHits;
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_TacticalCacheMisses);
+
+		// Drops the entries of targets nobody has queried for a while (dead or out of the fight)
+		const float StaleTime = Now - Settings->TacticalCacheSeconds * 10.f;
+		for (auto It = Caches.CreateIterator(); It; ++It)
+		{
+			if(It->Value.Time < StaleTime && &It->Value != &Cache)
+			{
+				It.RemoveCurrent();
+			}
+		}
+
+		Cache.MinDistance = MinDistance;
+		Cache.MaxDistance = MaxDistance;
+		Cache.TargetLocation = Target->GetActorLocation();
+		Cache.Time = Now;
+		Cache.Claimed.Reset();
+		GenerateCandidates(Querier, Target, Cache);
+	}
+
+	if(Cache.Candidates.Num() == 0)
+	{
+		++NumFailed;
+		return false;
+	}
+
+	// Allies around the same target (& the spots other allies already claimed), gathered on the game thread for the scoring below
+	const FCombatantHandle Self = Querier->GetCombatantHandle();
+	const FCombatantHandle TargetHandle = Querier->GetEnemyHandle();
+	const float AllyRadiusSquared = FMath::Square(MaxDistance + Settings->TacticalAllySpacing);
+	TArray<FVector, TInlineAllocator<16>> Allies(Cache.Claimed);
+	Registry->ForEachCombatant([Registry, Self, TargetHandle, Target, AllyRadiusSquared, &Allies](FCombatantHandle Handle, ACharacter* Character, ECombatantKind Kind)
+	{
+		if(Handle == Self || Handle == TargetHandle || Character == nullptr || !Registry->IsAlive(Handle) || Registry->AreEnemies(Self, Handle)) { return; }
+
+		if(FVector::DistSquared(Character->GetActorLocation(), Target->GetActorLocation()) <= AllyRadiusSquared)
+		{
+			Allies.Add(Character->GetActorLocation());
+		}
+	});
+
+	const FVector QuerierLocation = Querier->GetActorLocation();
+	const FVector TargetLocation = Target->GetActorLocation();
+	const float BandCenter = (MinDistance + MaxDistance) * 0.5f;
+	const float BandHalfWidth = FMath::Max((MaxDistance - MinDistance) * 0.5f, 1.f);
+	const float AllySpacing = FMath::Max(Settings->TacticalAllySpacing, 1.f);
+	const float MaxTravel = FMath::Max(Settings->TacticalMaxTravel, 1.f);
+
+	TArray<float> Scores;
+	Scores.SetNumUninitialized(Cache.Candidates.Num());
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TacticalScore);
+
+		// Only reads the candidates & the copies above, every index writes its own score
+		const TArray<FTacticalCandidate>& Candidates = Cache.Candidates;
+		ParallelFor(Candidates.Num(), [&](int32 Index)
+		{
+			const FTacticalCandidate& Candidate = Candidates[Index];
+
+			const float TravelDistance = FVector::Dist2D(Candidate.Location, QuerierLocation);
+			if(TravelDistance > MaxTravel)
+			{
+				Scores[Index] = -1.f;
+				return;
+			}
+
+			float NearestAlly = AllySpacing;
+			for (const FVector& Ally : Allies)
+			{
+				NearestAlly = FMath::Min(NearestAlly, FVector::Dist2D(Candidate.Location, Ally));
+			}
+
+			const float BandScore = 1.f - FMath::Min(FMath::Abs(FVector::Dist2D(Candidate.Location, TargetLocation) - BandCenter) / BandHalfWidth, 1.f);
+
+			// Short moves that still get somewhere, standing still isn't a strafe
+			const float TravelScore = 1.f - FMath::Abs(TravelDistance - MaxTravel * 0.5f) / (MaxTravel * 0.5f);
+
+			Scores[Index] = SpacingWeight * (NearestAlly / AllySpacing) + BandWeight * BandScore + TravelWeight * TravelScore
+				+ LineOfSightWeight * (Candidate.bLineOfSight ? 1.f : 0.f);
+		});
+	}
+
+	int32 BestIndex = INDEX_NONE;
+	for (int32 Index = 0; Index < Scores.Num(); ++Index)
+	{
+		if(Scores[Index] >= 0.f && (BestIndex == INDEX_NONE || Scores[Index] > Scores[BestIndex]))
+		{
+			BestIndex = Index;
+		}
+	}
+
+	if(BestIndex == INDEX_NONE)
+	{
+		++NumFailed;
+		return false;
+	}
+
+	OutPoint = Cache.Candidates[BestIndex].Location;
+	Cache.Claimed.Add(OutPoint);
+	return true;
+}
+
+void UTacticalPointSubsystem::GenerateCandidates(const AAI_BaseCharacter* Querier, const ACharacter* Target, FTacticalCache& Cache) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_TacticalGenerate);
+
+	Cache.Candidates.Reset();
+
+	const UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	const ANavigationData* NavData = NavSystem ? NavSystem->GetNavDataForProps(Querier->GetNavAgentPropertiesRef()) : nullptr;
+	if(NavData == nullptr) { return; }
+
+	const UAIMeleeCombatSettings* Settings = GetDefault<UAIMeleeCombatSettings>();
+	const int32 NumRings = FMath::Max(Settings->TacticalRings, 1);
+	const int32 PointsPerRing = FMath::Max(Settings->TacticalRingPoints, 1);
+	const FVector TargetLocation = Target->GetActorLocation();
+
+	TArray<FNavigationProjectionWork> Workload;
+	Workload.Reserve(NumRings * PointsPerRing);
+	for (int32 Ring = 0; Ring < NumRings; ++Ring)
+	{
+		const float Radius = NumRings > 1 ? FMath::Lerp(Cache.MinDistance, Cache.MaxDistance, static_cast<float>(Ring) / (NumRings - 1)) : (Cache.MinDistance + Cache.MaxDistance) * 0.5f;
+
+		// Every other ring is offset by half a step so the rings don't line up
+		const float AngleOffset = (Ring & 1) ? PI / PointsPerRing : 0.f;
+		for (int32 Point = 0; Point < PointsPerRing; ++Point)
+		{
+			const float Angle = AngleOffset + 2.f * PI * Point / PointsPerRing;
+			Workload.Emplace(TargetLocation + FVector(FMath::Cos(Angle) * Radius, FMath::Sin(Angle) * Radius, 0.f));
+		}
+	}
+
+	// One navmesh batch for every ring point instead of a query per point
+	const FVector Extent(100.f, 100.f, 250.f);
+	NavData->BatchProjectPoints(Workload, Extent, NavData->GetDefaultQueryFilter(), Querier);
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(TacticalLineOfSight), false);
+	QueryParams.AddIgnoredActor(Querier);
+	QueryParams.AddIgnoredActor(Target);
+
+	const FVector EyeOffset(0.f, 0.f, Querier->BaseEyeHeight);
+	for (const FNavigationProjectionWork& Work : Workload)
+	{
+		if(!Work.bResult) { continue; }
+
+		FTacticalCandidate& Candidate = Cache.Candidates.AddDefaulted_GetRef();
+		Candidate.Location = Work.OutLocation.Location;
+		Candidate.bLineOfSight = !GetWorld()->LineTraceTestByChannel(Candidate.Location + EyeOffset, TargetLocation, ECC_Visibility, QueryParams);
+	}
+}
+
+void UTacticalPointSubsystem::LogReport() const
+{
+	UE_LOG(LogAIMeleeCombat, Log, TEXT("Tactical points: %d queries, %d cache hits (%.0f%%), %d without a point, %d cached targets"),
+		NumQueries, NumCacheHits, NumQueries > 0 ? 100.f * NumCacheHits / NumQueries : 0.f, NumFailed, Caches.Num());
+}
+
+void UTacticalPointSubsystem::Deinitialize()
+{
+	Caches.Empty();
+
+	Super::Deinitialize();
+}
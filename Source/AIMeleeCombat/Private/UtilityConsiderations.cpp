@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "UtilityConsiderations.h"
+#include "Curves/CurveFloat.h"
+
+void FBakedCurve::Bake(const UCurveFloat* Curve, float InInputMax)
+{
+	const float InputMax = FMath::Max(InInputMax, KINDA_SMALL_NUMBER);
+	InvInputStep = NumSamples / InputMax;
+	MaxValue = 0.f;
+
+	for (int32 Index = 0; Index <= NumSamples; ++Index)
+	{
+		// Condition values outside 0-1 would break the score averaging & the pruning bound
+		Samples[Index] = FMath::Clamp(Curve->GetFloatValue(InputMax * Index / NumSamples), 0.f, 1.f);
+		MaxValue = FMath::Max(MaxValue, Samples[Index]);
+	}
+}
+
+void FBakedConsiderationSet::Bake(const FUtilityConsiderationSet& Set)
+{
+	Inputs.Reset();
+	Curves.Reset();
+	bReadsCooldown = false;
+
+	for (const FUtilityConsideration& Consideration : Set.Considerations)
+	{
+		if(Consideration.Curve == nullptr || Consideration.Input >= EUtilityInput::EUI_MAX) { continue; }
+
+		Inputs.Add(Consideration.Input);
+		Curves.AddDefaulted_GetRef().Bake(Consideration.Curve, Consideration.InputMax);
+		bReadsCooldown |= Consideration.Input == EUtilityInput::EUI_CooldownRemaining;
+	}
+}
@@ -0,0 +1,278 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "GenericTeamAgentInterface.h"
+#include "AIMeleeCombatSettings.generated.h"
+
+// Explicit relation between two teams (applied both ways), used for alliances or making two factions ignore each other
+USTRUCT(BlueprintType)
+struct FTeamAttitudeOverride
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Teams, meta = (ClampMin = "0", ClampMax = "254"))
+	int32 TeamA = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Teams, meta = (ClampMin = "0", ClampMax = "254"))
+	int32 TeamB = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Teams)
+	TEnumAsByte<ETeamAttitude::Type> Attitude = ETeamAttitude::Friendly;
+};
+
+// Animation update rate used for combatants within MaxDistance of the nearest player
+USTRUCT(BlueprintType)
+struct FAnimBudgetBucket
+{
+	GENERATED_BODY()
+
+	FAnimBudgetBucket() {}
+
+	FAnimBudgetBucket(float InMaxDistance, int32 InVisibleUpdateRate, int32 InNonRenderedUpdateRate) :
+		MaxDistance(InMaxDistance),
+		VisibleUpdateRate(InVisibleUpdateRate),
+		NonRenderedUpdateRate(InNonRenderedUpdateRate)
+	{
+	}
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Animation Budget", meta = (ClampMin = "0"))
+	float MaxDistance = 0.f;
+
+	// Evaluate the anim graph every N frames while the mesh is on screen (1 = every frame)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Animation Budget", meta = (ClampMin = "1"))
+	int32 VisibleUpdateRate = 1;
+
+	// Evaluate the anim graph every N frames while the mesh is off screen
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Animation Budget", meta = (ClampMin = "1"))
+	int32 NonRenderedUpdateRate = 4;
+};
+
+// Update rates used by AI whose significance score is at least MinSignificance (0 = every frame for the tick intervals)
+USTRUCT(BlueprintType)
+struct FSignificanceBucket
+{
+	GENERATED_BODY()
+
+	FSignificanceBucket() {}
+
+	FSignificanceBucket(float InMinSignificance, float InThinkInterval, float InActorTickInterval, float InPerceptionInterval, float InMovementTickInterval) :
+		MinSignificance(InMinSignificance),
+		ThinkInterval(InThinkInterval),
+		ActorTickInterval(InActorTickInterval),
+		PerceptionInterval(InPerceptionInterval),
+		MovementTickInterval(InMovementTickInterval)
+	{
+	}
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Significance, meta = (ClampMin = "0", ClampMax = "1"))
+	float MinSignificance = 0.f;
+
+	// Utility component UpdateScore interval
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Significance, meta = (ClampMin = "0.05"))
+	float ThinkInterval = 0.5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Significance, meta = (ClampMin = "0"))
+	float ActorTickInterval = 0.f;
+
+	// How often the sight sense runs for the AI (for ACharacter_AIController::PerceptionWindow each time, 0 = always on)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Significance, meta = (ClampMin = "0"))
+	float PerceptionInterval = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Significance, meta = (ClampMin = "0"))
+	float MovementTickInterval = 0.f;
+};
+
+/**
+ * Project wide combat settings (Project Settings > Game > AI Melee Combat)
+ */
+UCLASS(Config = Game, DefaultConfig, meta = (DisplayName = "AI Melee Combat"))
+class AIMELEECOMBAT_API UAIMeleeCombatSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UAIMeleeCombatSettings();
+
+	// Bakes the team settings into the attitude matrix & installs it as the engines team attitude solver (used by AI perception)
+	void ApplyTeamAttitudes() const;
+
+	// Attitude of team A toward team B, looked up in the baked matrix
+	static ETeamAttitude::Type GetTeamAttitude(FGenericTeamId A, FGenericTeamId B);
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	// Attitude between two different teams when no override applies
+	UPROPERTY(Config, EditAnywhere, Category = Teams)
+	TEnumAsByte<ETeamAttitude::Type> DefaultTeamAttitude;
+
+	// Teams that are neutral toward every other team unless an override says otherwise (neutral teams are never targeted)
+	UPROPERTY(Config, EditAnywhere, Category = Teams)
+	TArray<int32> NeutralTeams;
+
+	// Alliances & other explicit relations between teams
+	UPROPERTY(Config, EditAnywhere, Category = Teams)
+	TArray<FTeamAttitudeOverride> TeamAttitudeOverrides;
+
+	// Distance buckets sorted nearest first, combatants further than the last bucket use the last bucket
+	UPROPERTY(Config, EditAnywhere, Category = "Animation Budget")
+	TArray<FAnimBudgetBucket> AnimBudgetBuckets;
+
+	// How often combatants are re-bucketed (the full rate guarantee for attack windows is checked every frame)
+	UPROPERTY(Config, EditAnywhere, Category = "Animation Budget", meta = (ClampMin = "0"))
+	float AnimBudgetUpdateInterval;
+
+	// Skipped frames are interpolated for update rates up to this value (above it the pose just holds)
+	UPROPERTY(Config, EditAnywhere, Category = "Animation Budget", meta = (ClampMin = "1"))
+	int32 MaxInterpolatedUpdateRate;
+
+	// Buckets sorted most significant first, an AI uses the first bucket its score reaches
+	UPROPERTY(Config, EditAnywhere, Category = Significance)
+	TArray<FSignificanceBucket> SignificanceBuckets;
+
+	UPROPERTY(Config, EditAnywhere, Category = Significance, meta = (ClampMin = "0"))
+	float SignificanceUpdateInterval;
+
+	// Distance to the nearest player at which the distance part of the score reaches 0
+	UPROPERTY(Config, EditAnywhere, Category = Significance, meta = (ClampMin = "1"))
+	float SignificanceMaxDistance;
+
+	// Score weights (distance to players, fighting anyone / fighting a player, on screen)
+	UPROPERTY(Config, EditAnywhere, Category = Significance, meta = (ClampMin = "0"))
+	float SignificanceDistanceWeight;
+
+	UPROPERTY(Config, EditAnywhere, Category = Significance, meta = (ClampMin = "0"))
+	float SignificanceCombatWeight;
+
+	UPROPERTY(Config, EditAnywhere, Category = Significance, meta = (ClampMin = "0"))
+	float SignificanceVisibilityWeight;
+
+	// Score margin an AI has to move past a bucket threshold before changing bucket (stops AI on a boundary flipping every update)
+	UPROPERTY(Config, EditAnywhere, Category = Significance, meta = (ClampMin = "0"))
+	float SignificanceHysteresis;
+
+	// Seconds after death before the corpse pose is frozen (should cover the death montage)
+	UPROPERTY(Config, EditAnywhere, Category = Corpses, meta = (ClampMin = "0"))
+	float CorpseFreezeDelay;
+
+	// Corpses left in the world at once, the oldest corpse is evicted past this
+	UPROPERTY(Config, EditAnywhere, Category = Corpses, meta = (ClampMin = "0"))
+	int32 CorpseBudget;
+
+	// Evicted corpses are hidden & kept for reuse by spawners instead of being destroyed
+	UPROPERTY(Config, EditAnywhere, Category = Corpses)
+	bool bPoolEvictedCorpses;
+
+	// Combatants kept in the pool at once, evicted corpses past this are destroyed
+	UPROPERTY(Config, EditAnywhere, Category = Corpses, meta = (ClampMin = "0", EditCondition = "bPoolEvictedCorpses"))
+	int32 CorpsePoolSize;
+
+	// Milliseconds per frame the wave spawner may spend spawning (at least one combatant is spawned each frame so waves always finish)
+	UPROPERTY(Config, EditAnywhere, Category = Spawning, meta = (ClampMin = "0.1"))
+	float SpawnFrameBudgetMs;
+
+	// Random offset around the spawn point, projected onto the navmesh
+	UPROPERTY(Config, EditAnywhere, Category = Spawning, meta = (ClampMin = "0"))
+	float SpawnRadius;
+
+	// Enemy AI within this distance of an attacker are told about the attack as it starts & rescore their defenses straight away
+	UPROPERTY(Config, EditAnywhere, Category = Telegraphs, meta = (ClampMin = "0"))
+	float TelegraphRadius;
+
+	// Defenders the attacker isn't targeting are only told if they are within the attacks reach & this many degrees either side of the attackers facing
+	UPROPERTY(Config, EditAnywhere, Category = Telegraphs, meta = (ClampMin = "0", ClampMax = "180"))
+	float TelegraphConeHalfAngle;
+
+	// Seconds until impact assumed for attack montages without a weapon damage window notify
+	UPROPERTY(Config, EditAnywhere, Category = Telegraphs, meta = (ClampMin = "0"))
+	float TelegraphDefaultImpactDelay;
+
+	// Seconds before a predicted impact that defenders start their block, the block montage should be raised by then
+	UPROPERTY(Config, EditAnywhere, Category = Telegraphs, meta = (ClampMin = "0"))
+	float BlockLeadTime;
+
+	// Seconds before a predicted impact that defenders start their dodge
+	UPROPERTY(Config, EditAnywhere, Category = Telegraphs, meta = (ClampMin = "0"))
+	float DodgeLeadTime;
+
+	// Enemies in sight scored by the utility component each think (the nearest ones, the current target always counts)
+	UPROPERTY(Config, EditAnywhere, Category = Utility, meta = (ClampMin = "1"))
+	int32 MaxUtilityTargets;
+
+	// AI scored per task graph job when utility evaluation runs off the game thread
+	UPROPERTY(Config, EditAnywhere, Category = Utility, meta = (ClampMin = "1"))
+	int32 UtilityJobBatchSize;
+
+	// AI vs AI fights further than this from every player are resolved statistically by the abstract combat subsystem
+	UPROPERTY(Config, EditAnywhere, Category = "Abstract Combat", meta = (ClampMin = "0"))
+	float AbstractCombatDistance;
+
+	// Abstract AI go back to the full simulation once a player is closer than this (shorter than AbstractCombatDistance so AI on the edge don't flip)
+	UPROPERTY(Config, EditAnywhere, Category = "Abstract Combat", meta = (ClampMin = "0"))
+	float AbstractCombatPromoteDistance;
+
+	// Seconds between abstract exchanges (& the checks for AI entering or leaving abstract combat)
+	UPROPERTY(Config, EditAnywhere, Category = "Abstract Combat", meta = (ClampMin = "0.05"))
+	float AbstractCombatStep;
+
+	// Rings of candidate points between the near & far edge of a tactical query band, & points on each ring
+	UPROPERTY(Config, EditAnywhere, Category = "Tactical Points", meta = (ClampMin = "1"))
+	int32 TacticalRings;
+
+	UPROPERTY(Config, EditAnywhere, Category = "Tactical Points", meta = (ClampMin = "1"))
+	int32 TacticalRingPoints;
+
+	// Seconds the projected points around a target are reused by allies querying the same target
+	UPROPERTY(Config, EditAnywhere, Category = "Tactical Points", meta = (ClampMin = "0"))
+	float TacticalCacheSeconds;
+
+	// Points at least this far from every ally (& the points allies already picked) get the full spacing score
+	UPROPERTY(Config, EditAnywhere, Category = "Tactical Points", meta = (ClampMin = "0"))
+	float TacticalAllySpacing;
+
+	// Points further than this from the querier are never picked
+	UPROPERTY(Config, EditAnywhere, Category = "Tactical Points", meta = (ClampMin = "0"))
+	float TacticalMaxTravel;
+
+	// Slots around every contested target, aggressive AI seek their own slot instead of the targets location
+	UPROPERTY(Config, EditAnywhere, Category = Encirclement, meta = (ClampMin = "1"))
+	int32 EncirclementMeleeSlots;
+
+	UPROPERTY(Config, EditAnywhere, Category = Encirclement, meta = (ClampMin = "1"))
+	int32 EncirclementRangedSlots;
+
+	// Total travel an agent joining the ring has to save before it takes a slot from someone already in it
+	UPROPERTY(Config, EditAnywhere, Category = Encirclement, meta = (ClampMin = "0"))
+	float EncirclementSwapMargin;
+
+	// Seeking AI only re-path once their slot has moved this far (the target moving), otherwise the current move is kept
+	UPROPERTY(Config, EditAnywhere, Category = Encirclement, meta = (ClampMin = "0"))
+	float EncirclementRepathDistance;
+
+	// Fixed simulation step of ranged attack projectiles (seconds) & the most steps taken in one frame
+	UPROPERTY(Config, EditAnywhere, Category = Projectiles, meta = (ClampMin = "0.001"))
+	float ProjectileStep;
+
+	UPROPERTY(Config, EditAnywhere, Category = Projectiles, meta = (ClampMin = "1"))
+	int32 ProjectileMaxSteps;
+
+	// Seconds a projectile flies before it is removed without hitting anything
+	UPROPERTY(Config, EditAnywhere, Category = Projectiles, meta = (ClampMin = "0"))
+	float ProjectileLifetime;
+
+	// Cell size of the grid the combatants capsules are bucketed into for projectile sweeps
+	UPROPERTY(Config, EditAnywhere, Category = Projectiles, meta = (ClampMin = "100"))
+	float ProjectileGridCellSize;
+
+	// Drawn once per projectile through one instanced mesh, none leaves projectiles invisible
+	UPROPERTY(Config, EditAnywhere, Category = Projectiles, meta = (AllowedClasses = "StaticMesh"))
+	FSoftObjectPath ProjectileMesh;
+
+	// Trained policy network (UCombatPolicyModel) used to pick abilities instead of the utility scores, none keeps the utility scores
+	UPROPERTY(Config, EditAnywhere, Category = Policy, meta = (AllowedClasses = "CombatPolicyModel"))
+	FSoftObjectPath PolicyModel;
+};
@@ -4,25 +4,12 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "CombatantRegistry.h"
+#include "GenericTeamAgentInterface.h"
+#include "CombatInterface.h"
+#include "CombatStateMachine.h"
 #include "AI_BaseCharacter.generated.h"
 
-// Combat States are set so actions cant be performed whilst another action is already being performed (must be Unoccupied before performing next action)
-UENUM(BlueprintType)
-enum class ECombatState : uint8
-{
-	ECS_Unoccupied UMETA(DisplayName = "Unoccupied"),
-	ECS_Attacking UMETA(DisplayName = "Attacking"),
-	ECS_Dodging UMETA(DisplayName = "Dodging"),
-	ECS_Blocking UMETA(DisplayName = "Blocking"),
-	ECS_Stunned UMETA(DisplayName = "Stunned"),
-	ECS_Patrol UMETA(DisplayName = "Patrol"),
-	ECS_Seek UMETA(DisplayName = "Seek"),
-	ECS_Strafe UMETA(DisplayName = "Strafe"),
-	ECS_Dead UMETA(DisplayName = "Dead"),
-	
-	ECS_MAX
-};
-
 UENUM(BlueprintType)
 enum class EStrafeDirection : uint8
 {
@@ -35,31 +22,65 @@ enum class EStrafeDirection : uint8
 };
 
 UCLASS()
-class AIMELEECOMBAT_API AAI_BaseCharacter : public ACharacter
+class AIMELEECOMBAT_API AAI_BaseCharacter : public ACharacter, public IGenericTeamAgentInterface, public ICombatInterface
 {
 	GENERATED_BODY()
 
 public:
 	// Sets default values for this character's properties
-	AAI_BaseCharacter();
+	AAI_BaseCharacter(const FObjectInitializer& ObjectInitializer);
+
+#if WITH_EDITOR
+	// Cooked builds can't build stand in archetypes, so saving an AI without one for cooking is an error (AIMelee.Archetype.MigrateLegacy fixes it)
+	virtual void PreSave(FObjectPreSaveContext ObjectSaveContext) override;
+
+	// New archetype holding the deprecated per instance values from before combat archetypes
+	UCombatArchetype* BuildLegacyArchetype(UObject* Outer, FName Name, EObjectFlags Flags) const;
+
+	// Whether Candidate holds the same values as this AIs deprecated ones, so AI with the same values can share one migrated asset
+	bool MatchesLegacyArchetype(const UCombatArchetype& Candidate) const;
+#endif
 
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// Registers this character with the combatant registry (before any BeginPlay so perception can always resolve it)
+	virtual void PostInitializeComponents() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	virtual void Tick(float DeltaSeconds) override;
 
 	void OnAIMoveCompleted(struct FAIRequestID RequestID, const struct FPathFollowingResult &Result);
 
+	// Caches the AI controller & listens for its path following requests finishing (BeginPlay & after being revived from the corpse pool)
+	void BindController();
+
 	void SetupStimulus();
 
 	void SetMontageToPlay(UAnimMontage* Montage, FName Section);
 
+	// Falls back to an archetype of its own built from the deprecated per instance values (editor) or the default archetype
+	void ResolveArchetype();
+
 	// Sets CombatState to Unoccupied so the AI is free to use next action
+	// (still callable from Blueprint notifies in montages that haven't moved to UAnimNotify_EndAction)
 	UFUNCTION(BlueprintCallable)
 	void SetUnoccupied();
 
-	void RotateTowardsTarget(FVector Target);
+	// State machine hooks (the only place the action flags are set & cleared)
+	void OnCombatStateExit(ECombatState State);
+	void OnCombatStateEnter(ECombatState State);
+
+	// Returns whether the capsule was rotated (false if it already faced the target)
+	bool RotateTowardsTarget(FVector Target);
+
+	// Tells nearby enemy AI about an attack that just started (nothing is sent if the montage wasn't loaded)
+	void TelegraphAttack(const UAnimMontage* Montage, FName Section) const;
+
+	// Fires the archetypes projectile at the enemy, leading it by its current velocity
+	void LaunchProjectile();
 
 	UFUNCTION()
 	void StrafeOffCooldown();
@@ -70,6 +91,7 @@ protected:
 	UFUNCTION()
 	void DodgeOffCooldown();
 
+	// Called every frame of the damage window by UAnimNotifyState_DamageWindow (or the old Blueprint notify)
 	UFUNCTION(BlueprintCallable)
 	void DamageDetectTrace();
 
@@ -78,6 +100,10 @@ protected:
 	// Called in "TakeDamage(...)" once CurrentHealth = 0 // Plays Death Montage, clears current target enemy & sets combat state to Dead
 	void Death();
 
+	// Strips the dead AI down to a corpse: removes it from perception & the combatant registry, stops thinking & ticking,
+	// detaches the controller & hands it to the corpse subsystem (the pose is frozen once the death montage has played)
+	void BeginCorpse();
+
 	
 
 private:
@@ -91,88 +117,110 @@ private:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = AI, meta = (AllowPrivateAccess = "true"))
 	class UAI_UtilityComponent* UtilityComponent;
 
+	// Character movement, also turns the AI toward its enemy as part of the movement update
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Movement, meta = (AllowPrivateAccess = "true"))
+	class UCombatMovementComponent* CombatMovement;
+
+	// Shared per type data (montages, ranges, health & behavior), instances only keep their runtime state
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = AI, meta = (AllowPrivateAccess = "true"))
-	float PatrolRadius;
+	class UCombatArchetype* Archetype;
 
-	// Checks whether the AI are friendly toward each other or not
+	// Checks whether the AI are friendly toward each other or not (exposed to perception as the FGenericTeamId, see Project Settings > AI Melee Combat for the attitude matrix)
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = AI, meta = (AllowPrivateAccess = "true"))
 	int32 TeamNumber;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = AI, meta = (AllowPrivateAccess = "true"))
 	float CurrentHealth;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = AI, meta = (AllowPrivateAccess = "true"))
-	float MaxHealth;
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = AI, meta = (AllowPrivateAccess = "true"))
-	bool bCanPatrol;
-
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = AI, meta = (AllowPrivateAccess = "true"))
 	EStrafeDirection StrafeDirection;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	float AttackRange;
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	float RangedAttackRange;
-
+	// Runtime flags packed into bitfields so the combat loop reads them from one or two bytes
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	bool bEnemyDetected;
+	uint8 bEnemyDetected : 1;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	bool bInAttackRange;
+	uint8 bInAttackRange : 1;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	bool bInRangedAttackRange;
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	bool bIsAggressive;
+	uint8 bInRangedAttackRange : 1;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = AI, meta = (AllowPrivateAccess = "true"))
-	bool bCanStrafe;
+	uint8 bCanStrafe : 1;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = AI, meta = (AllowPrivateAccess = "true"))
-	bool bCanBlock;
+	uint8 bCanBlock : 1;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = AI, meta = (AllowPrivateAccess = "true"))
-	bool bCanDodge;
+	uint8 bCanDodge : 1;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = AI, meta = (AllowPrivateAccess = "true"))
-	bool bAttacking;
+	uint8 bAttacking : 1;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = AI, meta = (AllowPrivateAccess = "true"))
-	bool bIsBlocking;
+	uint8 bIsBlocking : 1;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = AI, meta = (AllowPrivateAccess = "true"))
-	bool bIsDodging;
+	uint8 bIsDodging : 1;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = AI, meta = (AllowPrivateAccess = "true"))
-	bool bIsDead;
+	uint8 bIsDead : 1;
 
+	// Set between the begin & end of the attack montages damage window notify
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	uint8 bDamageWindowActive : 1;
 
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = WeaponComponents, meta = (AllowPrivateAccess = "true"))
-	USceneComponent* TraceStart;
+	// Set once the corpse pose has been frozen (cleared when revived from the corpse pool)
+	uint8 bCorpseFrozen : 1;
 
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = WeaponComponents, meta = (AllowPrivateAccess = "true"))
-	USceneComponent* TraceEnd;
+	// Fight resolved statistically by the abstract combat subsystem (no thinking, movement, animation or ticking)
+	uint8 bAbstractCombat : 1;
+
+#if WITH_EDITORONLY_DATA
+	// Per instance values from before combat archetypes, only read to build a stand in archetype for AI with no Archetype set
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to UCombatArchetype"))
+	float PatrolRadius_DEPRECATED;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	UAnimMontage* AttackMontage;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to UCombatArchetype"))
+	float MaxHealth_DEPRECATED;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	UAnimMontage* RangedAttackMontage;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to UCombatArchetype"))
+	bool bCanPatrol_DEPRECATED;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	UAnimMontage* UltimateAttackMontage;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to UCombatArchetype"))
+	float AttackRange_DEPRECATED;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	UAnimMontage* BlockingMontage;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to UCombatArchetype"))
+	float RangedAttackRange_DEPRECATED;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	UAnimMontage* DodgingMontage;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to UCombatArchetype"))
+	bool bIsAggressive_DEPRECATED;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
-	UAnimMontage* DeathMontage;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to UCombatArchetype"))
+	UAnimMontage* AttackMontage_DEPRECATED;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to UCombatArchetype"))
+	UAnimMontage* RangedAttackMontage_DEPRECATED;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to UCombatArchetype"))
+	UAnimMontage* UltimateAttackMontage_DEPRECATED;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to UCombatArchetype"))
+	UAnimMontage* BlockingMontage_DEPRECATED;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to UCombatArchetype"))
+	UAnimMontage* DodgingMontage_DEPRECATED;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to UCombatArchetype"))
+	UAnimMontage* DeathMontage_DEPRECATED;
+#endif
+
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = WeaponComponents, meta = (AllowPrivateAccess = "true"))
+	USceneComponent* TraceStart;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = WeaponComponents, meta = (AllowPrivateAccess = "true"))
+	USceneComponent* TraceEnd;
 
 	UPROPERTY(BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	int32 ComboIndex;
@@ -186,16 +234,31 @@ private:
 	class ACharacter_AIController* Character_AIController;
 
 	UPROPERTY()
-	AAI_BaseCharacter* EnemyReference;
+	UCombatantRegistry* CombatantRegistry;
 
-	UPROPERTY()
-	class APlayerCharacter* EnemyPlayer;
+	// This characters handle in the combatant registry
+	FCombatantHandle CombatantHandle;
+
+	// Current target (player or AI), resolved through the combatant registry
+	FCombatantHandle EnemyHandle;
+
+	// Location of the last seek move, kept while the encirclement slot hasn't moved so the AI doesn't re-path every think
+	FVector SeekGoal;
 
-	ECombatState CombatState;
+	// Index into the significance buckets (0 = most significant)
+	int32 SignificanceBucket;
+
+	FCombatStateMachine CombatStateMachine;
 	FTimerHandle AttackTimerHandle;
 	FTimerHandle StrafeCooldownHandle;
 	FTimerHandle BlockCooldownHandle;
 	FTimerHandle DodgeCooldownHandle;
+	FTimerHandle CorpseFreezeHandle;
+
+	// Collision restored when the combatant is revived from the corpse pool
+	TEnumAsByte<ECollisionEnabled::Type> CapsuleCollision;
+	TEnumAsByte<ECollisionEnabled::Type> MeshCollision;
+	TEnumAsByte<ECollisionEnabled::Type> WeaponCollision;
 
 
 public:
@@ -214,17 +277,64 @@ public:
 
 	void Dodging();
 
-	bool IsEnemy(AActor* Target);
+	// Returns true if the target is a registered combatant on another team
+	bool IsEnemy(FCombatantHandle Target) const;
+
+	void SetEnemy(FCombatantHandle Target);
+
+	AAI_BaseCharacter* GetEnemy() const;
+	class APlayerCharacter* GetEnemyPlayer() const;
+
+	// Current target regardless of whether it is the player or another AI
+	ACharacter* GetEnemyCharacter() const;
+
+	// Refreshes the in range flags for the current target (every tick & straight after the target changes)
+	void UpdateEnemyRanges();
+
+	// Read by the utility considerations
+	float GetHealthFraction() const;
+	float GetStrafeCooldownRemaining() const;
+	float GetBlockCooldownRemaining() const;
+	float GetDodgeCooldownRemaining() const;
+
+	// Stops the mesh, weapon & movement ticking & turns off collision, leaving the final death pose as a static prop
+	void FreezeCorpse();
+
+	// Brings a pooled corpse back as a live combatant at SpawnTransform (registered, possessed & thinking again)
+	void ReviveFromPool(const FTransform& SpawnTransform);
+
+	// Switches between the full simulation & the abstract combat subsystems statistical resolution (position, health & target carry over)
+	void SetAbstractCombat(bool bAbstract);
+
+	// Applies the update rates of the significance bucket this AI was placed in (think, tick, perception & movement rates)
+	void ApplySignificance(int32 BucketIndex, const struct FSignificanceBucket& Bucket);
+
+	// ICombatInterface (called directly by the native anim notifies in the montages)
+	virtual void BeginDamageWindow() override;
+	virtual void TickDamageWindow() override;
+	virtual void EndDamageWindow() override;
+	virtual void AdvanceCombo() override;
+	virtual void EndAction() override;
+
+	// IGenericTeamAgentInterface (lets AI perception filter by affiliation before OnPerceptionUpdated is called)
+	virtual FGenericTeamId GetGenericTeamId() const override;
+	virtual void SetGenericTeamId(const FGenericTeamId& NewTeamID) override;
 
 	// overriden from actor class
 	virtual float TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
 
 	// public getters (allows access to private variables in other classes)
-	FORCEINLINE float GetPatrolRadius() const { return PatrolRadius; }
-	FORCEINLINE bool CanPatrol() const { return bCanPatrol; }
+	float GetPatrolRadius() const;
+	bool CanPatrol() const;
+	FORCEINLINE UCombatArchetype* GetArchetype() const { return Archetype; }
+
+	// Only valid on a deferred spawn before FinishSpawning (the archetype is resolved in PostInitializeComponents) or on placed AI in the editor
+	FORCEINLINE void SetArchetype(UCombatArchetype* InArchetype) { Archetype = InArchetype; }
 	FORCEINLINE bool GetEnemyDetected() const { return bEnemyDetected; }
-	FORCEINLINE ECombatState GetCombatState() const { return CombatState; }
-	FORCEINLINE AAI_BaseCharacter* GetEnemy() const { return EnemyReference; }
+	FORCEINLINE ECombatState GetCombatState() const { return CombatStateMachine.GetState(); }
+
+	// Broadcast after every combat state transition (subscribe instead of polling GetCombatState)
+	FORCEINLINE FOnCombatStateChanged& OnCombatStateChanged() { return CombatStateMachine.OnStateChanged; }
 	FORCEINLINE bool InAttackRange() const { return bInAttackRange; }
 	FORCEINLINE bool InRangedAttackRange() const { return bInRangedAttackRange; }
 	FORCEINLINE bool CanStrafe() const { return bCanStrafe; }
@@ -232,8 +342,15 @@ public:
 	FORCEINLINE bool CanDodge() const { return bCanDodge; }
 	FORCEINLINE bool GetIsAttacking() const { return bAttacking; }
 	FORCEINLINE bool IsDead() const { return bIsDead; }
+	FORCEINLINE bool IsCorpseFrozen() const { return bCorpseFrozen; }
+	FORCEINLINE bool IsAbstractCombat() const { return bAbstractCombat; }
+	FORCEINLINE bool IsInDamageWindow() const { return bDamageWindowActive; }
 	FORCEINLINE int32 GetTeamNumber() const { return TeamNumber; }
-	FORCEINLINE APlayerCharacter* GetEnemyPlayer() const {return EnemyPlayer;}
+	FORCEINLINE FCombatantHandle GetCombatantHandle() const { return CombatantHandle; }
+	FORCEINLINE FCombatantHandle GetEnemyHandle() const { return EnemyHandle; }
+	FORCEINLINE int32 GetSignificanceBucket() const { return SignificanceBucket; }
+	FORCEINLINE class UAI_UtilityComponent* GetUtilityComponent() const { return UtilityComponent; }
+	FORCEINLINE class ACharacter_AIController* GetCharacterAIController() const { return Character_AIController; }
 
 	// public setters (allows access to private variables in other classes)
 	FORCEINLINE void SetEnemyDetected(bool ED) {bEnemyDetected = ED;}
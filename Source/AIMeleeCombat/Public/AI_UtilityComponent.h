@@ -5,6 +5,11 @@
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
 #include "Engine/DataTable.h"
+#include "CombatStateMachine.h"
+#include "CombatantRegistry.h"
+#include "CombatPlanner.h"
+#include "UtilityConsiderations.h"
+#include "CombatRules.h"
 #include "AI_UtilityComponent.generated.h"
 
 
@@ -31,15 +36,73 @@ struct FCombatBehavior : public FTableRowBase
 };
 
 
+// One candidate target as the ability scores see it
+struct FUtilityTarget
+{
+	FCombatantHandle Handle;
+	float Distance = 0.f;
+	bool bDetected = false;
+	bool bAttacking = false;
+};
+
+// Owner state the ability scores read, copied on the game thread so scoring never touches the actor
+// Behavior, ranges & curves are copied too, jobs must not read the archetype or behavior row while they can be edited or reloaded
+struct FUtilityAgentState
+{
+	CombatCore::FBehaviorValues Behavior;
+	CombatCore::FRangeProfile Ranges;
+	FBakedConsiderationSet Considerations[static_cast<int32>(EUtilityAbility::EUA_MAX)];
+	float HealthFraction = 1.f;
+	float StrafeCooldownRemaining = 0.f;
+	float BlockCooldownRemaining = 0.f;
+	float DodgeCooldownRemaining = 0.f;
+	bool bCanStrafe = false;
+	bool bCanBlock = false;
+	bool bCanDodge = false;
+	bool bAttackIncoming = false;
+	// Whether the current target (the first candidate) is in sight
+	bool bEnemyDetected = false;
+};
+
+
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class AIMELEECOMBAT_API UAI_UtilityComponent : public UActorComponent
 {
 	GENERATED_BODY()
 
+	// Gathers & applies the evaluations it runs on worker threads
+	friend class UCombatSnapshotSubsystem;
+	friend class UCombatPolicySubsystem;
+
 public:	
 	// Sets default values for this component's properties
 	UAI_UtilityComponent();
 
+	// Changes how often UpdateScore is called (set by the significance subsystem)
+	void SetThinkInterval(float Interval);
+
+	// Starts/stops the UpdateScore timer (stopped while the owner is busy with an action or dead)
+	void StartThinking();
+	void StopThinking();
+
+	// Out of band defensive rescore when a nearby enemy starts an attack
+	// A chosen block or dodge is scheduled to start just before the predicted impact, returns true if one was chosen
+	bool OnAttackTelegraphed(const struct FAttackTelegraph& Telegraph);
+
+	// Scores the same owner against 1, 8 & 32 generated targets with & without pruning (AIMelee.Utility.Benchmark)
+	static void RunScoringBenchmark(UWorld* World);
+
+	// AIMelee.Utility.Prune (game thread)
+	static bool IsPruningEnabled();
+
+	// Seek, Strafe, Attack, Ranged Attack, Ultimate Attack, Dodge & Block (the order of AbilitiesAvailable)
+	static constexpr int32 NumAbilities = 7;
+
+#if WITH_EDITOR
+	// Behavior row saved on this component before it moved to UCombatArchetype
+	void GetLegacyBehavior(UDataTable*& OutCombatBehaviorData, FName& OutRowName) const;
+#endif
+
 protected:
 
 	// Called when the game starts
@@ -49,24 +112,64 @@ protected:
 
 	void ChooseBestAbility();
 
+	// Seek, Strafe, Attack, Ranged Attack, Ultimate Attack, Dodge or Block on the current target
+	void PerformAbility(int32 AbilityIndex);
+
+	// Runs the next step of the current plan, replanning when the plan is done or its next step's preconditions broke
+	// Returns false if the archetype doesn't plan or no plan applies (the utility scores pick instead)
+	bool FollowPlan();
+
+	// Planner facts for the owner & its current target (game thread only)
+	FCombatWorldState MakeWorldState() const;
+
 	UFUNCTION()
 	void UpdateScore();
 
-	static float ScoreAbilities(float BehaviorValue, TArray<float> Conditions);
+	// Thinking only happens while the owner is Unoccupied, so the timer follows the owners combat state instead of polling it
+	void OnOwnerCombatStateChanged(ECombatState OldState, ECombatState NewState);
+
+	static float ScoreAbilities(float BehaviorValue, TArrayView<const float> Conditions);
+
+	// Current target first, then the other enemies in sight nearest first (up to MaxUtilityTargets)
+	void GatherTargets();
+
+	FUtilityTarget MakeTarget(FCombatantHandle Handle, bool bDetected) const;
+
+	// Current target first (may be invalid), then the other enemies in sight nearest first
+	void GatherCandidates(TArray<FCombatantHandle, TInlineAllocator<8>>& OutCandidates) const;
+
+	// Copies the owner state the scores read (game thread only)
+	FUtilityAgentState MakeAgentState() const;
+
+	// Fills the EPolicyInput values of the policy network from the same state the step conditions read
+	static void MakePolicyInputs(const FUtilityAgentState& Agent, const FUtilityTarget& Target, float* OutInputs);
+
+	// Fills the best score & target index of every ability over the (ability, target) matrix, returns the pairs evaluated
+	// With bPrune a pair is skipped once its ability already has a target at the abilities upper bound
+	// Only reads Agent & InTargets, so it can run on any thread
+	static int32 ScoreTargets(const FUtilityAgentState& Agent, const TArray<FUtilityTarget>& InTargets, bool bPrune, TArray<float>& OutScores, TArray<int32>& OutBestTargets);
+
+	static float ScoreAbility(const FUtilityAgentState& Agent, int32 AbilityIndex, const FUtilityTarget& Target);
 
-	float SeekScore();
+	// Highest score the ability can reach against any target
+	static float AbilityUpperBound(const FUtilityAgentState& Agent, int32 AbilityIndex);
 
-	float StrafeScore();
+	// Score from the archetypes baked consideration curves (used instead of the step conditions below when the ability has curves)
+	static float CurveScore(const FUtilityAgentState& Agent, int32 AbilityIndex, const FBakedConsiderationSet& Considerations, const FUtilityTarget& Target);
 
-	float AttackScore();
+	// Behavior row value the conditions are multiplied with (seek & strafe have no row value)
+	static float GetBehaviorValue(const FUtilityAgentState& Agent, int32 AbilityIndex);
 
-	float RangedAttackScore();
+	static float GetCooldownRemaining(const FUtilityAgentState& Agent, int32 AbilityIndex);
 
-	float UltimateAttackScore();
+	// Built in step condition score (CombatCore::StepScore), used for abilities without consideration curves
+	static float StepScore(const FUtilityAgentState& Agent, int32 AbilityIndex, const FUtilityTarget& Target);
 
-	float DodgeScore();
+	// A telegraphed attack from any nearby enemy hasn't landed yet
+	bool IsAttackIncoming() const;
 
-	float BlockScore();
+	// Starts the block or dodge chosen in OnAttackTelegraphed (skipped if the owner got busy or dead in the meantime)
+	void StartScheduledDefense();
 
 
 private:
@@ -74,17 +177,46 @@ private:
 	UPROPERTY()
 	class AAI_BaseCharacter* AICharacter;
 
-	FCombatBehavior* S_CombatBehavior;
+	// Row of the owners combat archetype
+	const FCombatBehavior* S_CombatBehavior;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI Behavior", meta = (AllowPrivateAccess = "true"))
-	UDataTable* CombatBehaviorData;
+#if WITH_EDITORONLY_DATA
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to UCombatArchetype"))
+	UDataTable* CombatBehaviorData_DEPRECATED;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI Behavior", meta = (AllowPrivateAccess = "true"))
-	FName RowName;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to UCombatArchetype"))
+	FName RowName_DEPRECATED;
+#endif
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "AI Behavior", meta = (AllowPrivateAccess = "true"))
 	TArray<float> AbilitiesAvailable;
 
+	// Index into Targets of the target each ability scored best against (INDEX_NONE if it scored 0)
+	TArray<int32> BestTargets;
+
+	TArray<FUtilityTarget> Targets;
+
+	// (ability, target) pairs scored by the last UpdateScore
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "AI Behavior", meta = (AllowPrivateAccess = "true"))
+	int32 LastPairsEvaluated;
+
+	// Seconds between UpdateScore calls
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI Behavior", meta = (AllowPrivateAccess = "true", ClampMin = "0.05"))
+	float ThinkInterval;
+
 	FTimerHandle UpdateScoreTimer;
+
+	// World time the damage window of the latest telegraphed attack closes
+	float IncomingImpactEndTime;
+
+	// Defense waiting for its attack to get close, UpdateScore doesn't pick anything else while it is pending
+	FTimerHandle DefenseTimer;
+	int32 ScheduledDefenseIndex;
+	float ScheduledImpactTime;
+
+	// Shared with the other AI of the archetype that planned from the same world state
+	TSharedPtr<const FCombatPlan> CurrentPlan;
+	int32 PlanStep;
+	bool bPlanStepStarted;
 		
 };
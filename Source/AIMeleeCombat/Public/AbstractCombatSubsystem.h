@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "CombatRules.h"
+#include "AbstractCombatSubsystem.generated.h"
+
+class AAI_BaseCharacter;
+class UCombatArchetype;
+
+// How one abstract exchange landed on the defender
+using EAbstractHit = CombatCore::EHitOutcome;
+
+/**
+ * Resolves AI vs AI fights far from every player statistically (archetype damage rate, block & dodge chance against health)
+ * instead of running movement, montages, weapon traces & TakeDamage for them, promoting both AI back to the full simulation as a player approaches
+ * Full simulation AI vs AI hits are recorded as well, so the statistical model can be checked against them (AIMelee.AbstractCombat.Validate)
+ */
+UCLASS()
+class AIMELEECOMBAT_API UAbstractCombatSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UAbstractCombatSubsystem();
+
+	static UAbstractCombatSubsystem* Get(const UObject* WorldContextObject);
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	// The archetypes statistical model as the combat core reads it
+	static CombatCore::FExchangeProfile MakeExchangeProfile(const UCombatArchetype& Archetype);
+
+	// Damage the attacker deals the defender over DeltaTime in the statistical model (after the defenders block or dodge)
+	static float ResolveExchange(const UCombatArchetype& Attacker, const UCombatArchetype& Defender, float DeltaTime, FRandomStream& Random, EAbstractHit& OutHit);
+
+	// A full simulation hit from one AI on another (called from AAI_BaseCharacter::TakeDamage), Damage is before the defenders block or dodge
+	void RecordFullSimHit(const UCombatArchetype* Attacker, const UCombatArchetype* Defender, float Damage, EAbstractHit Hit, bool bKilled);
+
+	// Compares the recorded full simulation rates & duel outcomes with the statistical model (AIMelee.AbstractCombat.Validate)
+	void LogValidation() const;
+
+	// Times abstract duels through the combat core on one thread & on every core (AIMelee.CombatCore.Benchmark)
+	static void RunCoreBenchmark(UWorld* World);
+
+protected:
+
+	virtual void Deinitialize() override;
+
+private:
+
+	void Step(float DeltaTime);
+
+	// Far enough from every player (MinDistance) & fighting an AI that is as well
+	bool IsEligible(const AAI_BaseCharacter* AICharacter, const TArray<FVector, TInlineAllocator<4>>& PlayerLocations, float MinDistance) const;
+
+	// Closes the gap to the enemy without movement or animation, then applies one exchange once in range
+	void Resolve(AAI_BaseCharacter* AICharacter, float DeltaTime);
+
+	// Win rate of A over B & the mean seconds to a kill over simulated duels
+	static void SimulateDuels(const UCombatArchetype& A, const UCombatArchetype& B, int32 NumDuels, float& OutWinRateA, float& OutMeanDuration);
+
+	struct FArchetypeObservation
+	{
+		TWeakObjectPtr<const UCombatArchetype> Archetype;
+		// Seconds spent fighting another AI in the full simulation
+		double EngagedSeconds = 0.0;
+		double DamageDealt = 0.0;
+		int32 HitsTaken = 0;
+		int32 HitsBlocked = 0;
+		int32 HitsDodged = 0;
+	};
+
+	FArchetypeObservation& FindOrAddObservation(const UCombatArchetype* Archetype);
+
+	TMap<FObjectKey, FArchetypeObservation> Observations;
+
+	// (killer archetype, victim archetype) -> full simulation kills
+	TMap<TPair<FObjectKey, FObjectKey>, int32> Kills;
+
+	FRandomStream Random;
+
+	float TimeSinceStep;
+
+	int32 NumAbstract;
+};
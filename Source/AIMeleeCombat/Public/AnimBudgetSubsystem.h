@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "AnimBudgetSubsystem.generated.h"
+
+/**
+ * Assigns every combatants skeletal mesh an animation update rate from the Animation Budget buckets (distance to the
+ * nearest player camera & whether it is on screen), skipped frames are interpolated by the engines update rate optimizations.
+ * Combatants in an attack are always evaluated every frame so DamageDetectTrace follows the real weapon pose.
+ */
+UCLASS()
+class AIMELEECOMBAT_API UAnimBudgetSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UAnimBudgetSubsystem();
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	// Logs the update rate distribution, how many anim graphs were evaluated last frame & what they cost (AIMelee.AnimBudget.Report)
+	void LogReport() const;
+
+private:
+
+	struct FAnimBudgetEntry
+	{
+		int32 Serial = 0;
+		int32 VisibleUpdateRate = 1;
+		int32 NonRenderedUpdateRate = 1;
+		bool bFullRate = false;
+		bool bApplied = false;
+	};
+
+	// Re-buckets every combatant by distance & visibility
+	void AssignUpdateRates(class UCombatantRegistry* Registry);
+
+	void ApplyUpdateRate(USkeletalMeshComponent* Mesh, FAnimBudgetEntry& Entry) const;
+
+	// Turns update rate optimizations off for every combatant (budget disabled through AIMelee.AnimBudget.Enable)
+	void RestoreFullRate(class UCombatantRegistry* Registry);
+
+	// Average ms of one full anim graph update & evaluation, timed synchronously on up to MaxSamples combatant meshes (0 if there are none)
+	double MeasureEvaluationMs(int32 MaxSamples) const;
+
+	// Indexed by combatant handle index
+	TArray<FAnimBudgetEntry> Entries;
+
+	float TimeSinceAssignment;
+
+	bool bBudgetActive;
+
+	// Last frames report
+	int32 NumCombatants;
+	int32 NumForcedFullRate;
+	int32 NumOffScreen;
+	int32 NumEvaluated;
+	int32 NumInterpolated;
+	int32 NumAtRate[4];
+};
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimNotifies/AnimNotifyState.h"
+#include "CombatInterface.h"
+#include "AnimNotifyState_DamageWindow.generated.h"
+
+/**
+ * Weapon damage window, replaces the Blueprint notify that called DamageDetectTrace every frame
+ */
+UCLASS(meta = (DisplayName = "Weapon Damage Window"))
+class AIMELEECOMBAT_API UAnimNotifyState_DamageWindow : public UAnimNotifyState
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void NotifyBegin(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, float TotalDuration, const FAnimNotifyEventReference& EventReference) override;
+
+	virtual void NotifyTick(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, float FrameDeltaTime, const FAnimNotifyEventReference& EventReference) override;
+
+	virtual void NotifyEnd(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, const FAnimNotifyEventReference& EventReference) override;
+
+	virtual FString GetNotifyName_Implementation() const override;
+
+private:
+
+	// Notify states are shared by every mesh playing the montage (& across worlds), so the owner is looked up on every call instead of being kept here
+	static ICombatInterface* GetCombatant(const USkeletalMeshComponent* MeshComp);
+};
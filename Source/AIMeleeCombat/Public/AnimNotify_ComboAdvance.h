@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimNotifies/AnimNotify.h"
+#include "AnimNotify_ComboAdvance.generated.h"
+
+/**
+ * Combo notify in attack montages, lets the next attack in the combo be queued
+ */
+UCLASS(meta = (DisplayName = "Combo Advance"))
+class AIMELEECOMBAT_API UAnimNotify_ComboAdvance : public UAnimNotify
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Notify(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, const FAnimNotifyEventReference& EventReference) override;
+
+	virtual FString GetNotifyName_Implementation() const override;
+};
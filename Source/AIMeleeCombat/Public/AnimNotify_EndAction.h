@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimNotifies/AnimNotify.h"
+#include "AnimNotify_EndAction.generated.h"
+
+/**
+ * End of action notify, frees the character for its next action (replaces the Blueprint notify calling SetUnoccupied)
+ */
+UCLASS(meta = (DisplayName = "End Action"))
+class AIMELEECOMBAT_API UAnimNotify_EndAction : public UAnimNotify
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Notify(USkeletalMeshComponent* MeshComp, UAnimSequenceBase* Animation, const FAnimNotifyEventReference& EventReference) override;
+
+	virtual FString GetNotifyName_Implementation() const override;
+};
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatantRegistry.h"
+#include "AttackTelegraphSubsystem.generated.h"
+
+class UAnimMontage;
+
+// An attack that has just started, sent to the enemy AI around the attacker
+struct FAttackTelegraph
+{
+	FCombatantHandle Attacker;
+
+	FVector Origin = FVector::ZeroVector;
+
+	// World times (seconds) the damage window is predicted to open & close
+	float ImpactTime = 0.f;
+	float ImpactEndTime = 0.f;
+};
+
+/**
+ * Publishes attack starts to the enemy AI it can hit (Project Settings > AI Melee Combat > Telegraphs)
+ * Defenders found by an overlap query that either target the attacker or stand within the attacks reach & facing cone
+ * rescore block & dodge immediately instead of waiting for their next UpdateScore
+ */
+UCLASS()
+class AIMELEECOMBAT_API UAttackTelegraphSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static UAttackTelegraphSubsystem* Get(const UObject* WorldContextObject);
+
+	// Called by players & AI as an attack montage starts playing
+	void BroadcastAttack(const ACharacter* Attacker, FCombatantHandle AttackerHandle, const UAnimMontage* Montage, FName Section);
+
+	// Called by defenders as a block or dodge starts, SecondsBeforeImpact is negative if it started after the damage window opened
+	void RecordDefense(float SecondsBeforeImpact);
+
+	// Logs the broadcast, notify & reaction counts (AIMelee.Telegraph.Report)
+	void LogReport() const;
+
+private:
+
+	// How far the attack can hit, the attackers archetype range for AI & TelegraphRadius for anyone else
+	float GetAttackReach(const ACharacter* Attacker, const UAnimMontage* Montage) const;
+
+	int32 NumBroadcasts = 0;
+	int32 NumDefendersNotified = 0;
+	int32 NumReactions = 0;
+	int32 NumLateReactions = 0;
+
+	// Sum of the seconds left until impact when defenders started blocking or dodging
+	double ReactionLeadSeconds = 0.0;
+};
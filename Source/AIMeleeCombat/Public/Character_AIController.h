@@ -5,6 +5,7 @@
 #include "CoreMinimal.h"
 #include "AIController.h"
 #include "Perception/AIPerceptionTypes.h"
+#include "CombatantRegistry.h"
 #include "Character_AIController.generated.h"
 
 /**
@@ -23,6 +24,19 @@ public:
 	// allows the ai controller to possess the character its attached too
 	virtual void OnPossess(APawn* InPawn) override;
 
+	// The controller shares its pawns team so the perception listener uses the pawns affiliation
+	virtual FGenericTeamId GetGenericTeamId() const override;
+	virtual void SetGenericTeamId(const FGenericTeamId& NewTeamID) override;
+
+	// The sight sense only runs for PerceptionWindow out of every Interval (0 = always on), set from the pawns significance
+	void SetPerceptionInterval(float Interval);
+
+	// Seconds the sight sense stays on each interval, long enough for the sense to trace this listeners targets at least once
+	static constexpr float PerceptionWindow = 0.1f;
+
+	// Hostile, alive combatants currently in sight, nearest first & at most MaxEnemies of them
+	void GetPerceivedEnemies(TArray<FCombatantHandle>& OutEnemies, int32 MaxEnemies) const;
+
 protected:
 
 	UFUNCTION()
@@ -32,6 +46,12 @@ protected:
 
 	void SetEnemyTarget(AActor* Target);
 
+	void OpenPerceptionWindow();
+	void ClosePerceptionWindow();
+
+	// Turns this listeners sight queries on or off in the perception system
+	void SetSightEnabled(bool bEnabled);
+
 private:
 
 	class UNavigationSystemV1* NavSystem;
@@ -39,7 +59,15 @@ private:
 	UPROPERTY(BlueprintReadOnly, Category = "AI Behaviour", meta = (AllowPrivateAccess = "true"))
 	class AAI_BaseCharacter* AICharacter;
 
+	UPROPERTY()
+	class UCombatantRegistry* CombatantRegistry;
+
 	class UAISenseConfig_Sight* SightPerception;
 
+	float PerceptionInterval;
+
+	FTimerHandle PerceptionTimerHandle;
+	FTimerHandle PerceptionWindowHandle;
+
 	
 };
@@ -7,7 +7,8 @@
 #include "Character_AnimInstance.generated.h"
 
 /**
- * 
+ * Locomotion values are computed natively: movement inputs are copied on the game thread in NativeUpdateAnimation
+ * and Speed/Direction/bIsAccelerating are worked out on an animation worker thread in NativeThreadSafeUpdateAnimation
  */
 UCLASS()
 class AIMELEECOMBAT_API UCharacter_AnimInstance : public UAnimInstance
@@ -36,13 +37,32 @@ private:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Locomotion", meta = (AllowPrivateAccess = "true"))
 	bool bIsAccelerating;
 
+	// Owner & its movement component, resolved once in NativeInitializeAnimation (both AI & player are characters)
+	UPROPERTY()
+	class ACharacter* OwnerCharacter;
+
+	UPROPERTY()
+	class UCharacterMovementComponent* OwnerMovement;
+
+	// Movement inputs copied on the game thread for the worker thread update
+	FVector OwnerVelocity;
+	FVector OwnerAcceleration;
+	FRotator OwnerRotation;
+
 public:
 
-	UFUNCTION(BlueprintCallable)
+	// Kept so existing anim blueprints still compile, locomotion values are now updated natively
+	UFUNCTION(BlueprintCallable, meta = (DeprecatedFunction, DeprecationMessage = "Speed, Direction and bIsAccelerating are updated natively on worker threads, remove this node from the event graph"))
 	void UpdateAnimationProperties(float DeltaTime);
 
 	virtual void NativeInitializeAnimation() override;
 
+	// Game thread (copies the owners movement state)
+	virtual void NativeUpdateAnimation(float DeltaSeconds) override;
+
+	// Worker thread (only reads the copied movement state)
+	virtual void NativeThreadSafeUpdateAnimation(float DeltaSeconds) override;
+
 	FORCEINLINE float GetDirection() const { return Direction; }
 	
 };
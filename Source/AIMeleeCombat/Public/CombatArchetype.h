@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "UtilityConsiderations.h"
+#include "CombatArchetype.generated.h"
+
+class UAnimMontage;
+class UDataTable;
+struct FCombatBehavior;
+
+/**
+ * Everything that is the same for every AI of one type (montages, ranges, health, behavior row)
+ * Shared by all instances so each AI only carries its own runtime state
+ * Montages are soft references so only the archetypes that are actually spawned have their animations loaded
+ */
+UCLASS(BlueprintType)
+class AIMELEECOMBAT_API UCombatArchetype : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UCombatArchetype();
+
+	virtual FPrimaryAssetId GetPrimaryAssetId() const override;
+
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	// Bakes the consideration curves into lookup tables (on load & after every edit)
+	void BakeConsiderations();
+
+	// Empty if the ability has no curves & uses the built in step conditions
+	FORCEINLINE const FBakedConsiderationSet& GetBakedConsiderations(int32 AbilityIndex) const { return BakedConsiderations[AbilityIndex]; }
+
+	// Looks up the utility behavior row (nullptr if the table or row is missing)
+	const FCombatBehavior* FindCombatBehavior() const;
+
+	// Montages streamed in by UCombatAssetStreamer while an instance of this archetype is alive
+	void GetMontagePaths(TArray<FSoftObjectPath>& OutPaths) const;
+
+	// The one test for a ranged fighter (strafes at ranged spacing, surrounds targets from the ranged ring & plans ranged attacks)
+	FORCEINLINE bool HasRangedAttack() const { return !RangedAttackMontage.IsNull(); }
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Montages)
+	TSoftObjectPtr<UAnimMontage> AttackMontage;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Montages)
+	TSoftObjectPtr<UAnimMontage> RangedAttackMontage;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Montages)
+	TSoftObjectPtr<UAnimMontage> UltimateAttackMontage;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Montages)
+	TSoftObjectPtr<UAnimMontage> BlockingMontage;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Montages)
+	TSoftObjectPtr<UAnimMontage> DodgingMontage;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Montages)
+	TSoftObjectPtr<UAnimMontage> DeathMontage;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combat, meta = (ClampMin = "1"))
+	float MaxHealth;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combat, meta = (ClampMin = "0"))
+	float AttackRange;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combat, meta = (ClampMin = "0"))
+	float RangedAttackRange;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combat)
+	bool bIsAggressive;
+
+	// Projectile fired by the ranged attack (as its damage window opens, or as it starts if the montage has none)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Projectiles, meta = (ClampMin = "0"))
+	float ProjectileSpeed;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Projectiles, meta = (ClampMin = "0"))
+	float ProjectileDamage;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Projectiles, meta = (ClampMin = "0"))
+	float ProjectileRadius;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Projectiles)
+	float ProjectileGravityScale;
+
+	// Statistical model used for fights far from the players (see AIMelee.AbstractCombat.Validate for the full simulation rates)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abstract Combat", meta = (ClampMin = "0"))
+	float AbstractDamagePerSecond;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abstract Combat", meta = (ClampMin = "0", ClampMax = "1"))
+	float AbstractBlockChance;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Abstract Combat", meta = (ClampMin = "0", ClampMax = "1"))
+	float AbstractDodgeChance;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = AI)
+	bool bCanPatrol;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = AI, meta = (ClampMin = "0"))
+	float PatrolRadius;
+
+	// Utility scoring weights (row of FCombatBehavior)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI Behavior")
+	UDataTable* CombatBehaviorData;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI Behavior")
+	FName RowName;
+
+	// Curve based considerations per ability, abilities without an entry keep their step conditions
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI Behavior")
+	TMap<EUtilityAbility, FUtilityConsiderationSet> Considerations;
+
+	// Follows cached HTN plans (approach, feint, finisher...) instead of picking one ability at a time, the utility scores still pick when no plan applies
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI Behavior")
+	bool bUseCombatPlanner;
+
+private:
+
+	FBakedConsiderationSet BakedConsiderations[static_cast<int32>(EUtilityAbility::EUA_MAX)];
+};
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "CombatMontageTimings.h"
+#include "CombatAssetStreamer.generated.h"
+
+struct FStreamableHandle;
+
+/**
+ * Async loads the soft referenced montages of a combat archetype (or player class) when the first instance using it is created
+ * & keeps them loaded while any instance holds a reference, releasing them once the last one is gone
+ */
+UCLASS()
+class AIMELEECOMBAT_API UCombatAssetStreamer : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static UCombatAssetStreamer* Get(const UObject* WorldContextObject);
+
+	// Adds a reference to Owners assets, loading them if this is the first one
+	// OnLoaded is called once they are loaded (straight away if they already are)
+	void Acquire(const UObject* Owner, const TArray<FSoftObjectPath>& Assets, FSimpleDelegate OnLoaded = FSimpleDelegate());
+
+	// Removes a reference, the assets are unloaded by the next garbage collection once nothing references them
+	void Release(const UObject* Owner);
+
+	bool IsLoaded(const UObject* Owner) const;
+
+	// Damage window of a montage section from the timing tables built as montages finish loading (nullptr if it has none)
+	// Montages loaded some other way get their table built on first use
+	const FDamageWindowTiming* FindDamageWindow(const UAnimMontage* Montage, FName Section);
+
+	// Logs every streamed asset set with its reference count, load time & resident size (AIMelee.Streaming.Report)
+	void LogReport() const;
+
+protected:
+
+	virtual void Deinitialize() override;
+
+private:
+
+	void OnAssetsLoaded(FObjectKey Owner);
+
+	// Adds timing tables for the montages of a loaded asset set that don't have one yet
+	void BuildMontageTimings(const FStreamableHandle& Handle);
+
+	struct FStreamedAssets
+	{
+		int32 RefCount = 0;
+		bool bLoaded = false;
+		double RequestTime = 0.0;
+		double LoadSeconds = 0.0;
+		FString OwnerName;
+		TSharedPtr<FStreamableHandle> Handle;
+		TArray<FSimpleDelegate> WaitingForLoad;
+	};
+
+	TMap<FObjectKey, FStreamedAssets> StreamedAssets;
+
+	// Kept after the montages are released, the tables are small & the montage may be streamed in again
+	TMap<FObjectKey, FMontageTimingTable> MontageTimings;
+};
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "CombatInterface.generated.h"
+
+UINTERFACE(MinimalAPI, meta = (CannotImplementInterfaceInBlueprint))
+class UCombatInterface : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Implemented by the player & AI characters so the native anim notifies can call into combat code directly
+ */
+class AIMELEECOMBAT_API ICombatInterface
+{
+	GENERATED_BODY()
+
+public:
+
+	// Weapon damage window (UAnimNotifyState_DamageWindow), TickDamageWindow is called every frame in between
+	virtual void BeginDamageWindow() = 0;
+	virtual void TickDamageWindow() = 0;
+	virtual void EndDamageWindow() = 0;
+
+	// Combo notify in the attack montage (UAnimNotify_ComboAdvance)
+	virtual void AdvanceCombo() = 0;
+
+	// End of an attack/dodge/block montage (UAnimNotify_EndAction)
+	virtual void EndAction() = 0;
+};
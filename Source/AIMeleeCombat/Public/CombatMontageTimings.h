@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UAnimMontage;
+
+// Weapon damage window of one montage section, in seconds from the start of the section (rate scale applied)
+struct FDamageWindowTiming
+{
+	float Start = 0.f;
+	float End = 0.f;
+};
+
+/**
+ * Damage window timings of every section of one attack montage, read from its UAnimNotifyState_DamageWindow notifies
+ * Built once when the montage loads so defenders can predict impacts without walking the notify array
+ */
+struct AIMELEECOMBAT_API FMontageTimingTable
+{
+	static FMontageTimingTable Build(const UAnimMontage* Montage);
+
+	// nullptr if the section has no damage window
+	FORCEINLINE const FDamageWindowTiming* FindSection(FName Section) const { return Sections.Find(Section); }
+
+	TMap<FName, FDamageWindowTiming> Sections;
+};
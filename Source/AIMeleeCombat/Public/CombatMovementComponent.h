@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "CombatMovementComponent.generated.h"
+
+/**
+ * Character movement that also turns the character toward a facing target as part of its rotation update,
+ * so facing is applied inside the movement components scoped update instead of as a separate SetWorldRotation every tick
+ */
+UCLASS()
+class AIMELEECOMBAT_API UCombatMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	UCombatMovementComponent();
+
+	// Actor to turn toward (overrides orient to movement while set), nullptr to stop facing
+	void SetFacingTarget(const AActor* Target);
+
+	FORCEINLINE bool HasFacingTarget() const { return FacingTarget.IsValid(); }
+
+	// Logs the facing transform updates per frame since the last report (AIMelee.Facing.Report)
+	static void LogReport();
+
+	// Counts a facing rotation applied outside the movement update (the old per tick SetWorldRotation path)
+	static void CountTickFacingUpdate();
+
+	// Rotations closer than this (degrees) to the current one are skipped & not counted, on both facing paths
+	static constexpr float FacingTolerance = 0.01f;
+
+protected:
+
+	virtual void PhysicsRotation(float DeltaTime) override;
+
+private:
+
+	// Degrees per second, 0 snaps straight to the target (the old behavior)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Facing", meta = (AllowPrivateAccess = "true", ClampMin = "0"))
+	float FacingTurnRate;
+
+	TWeakObjectPtr<const AActor> FacingTarget;
+};
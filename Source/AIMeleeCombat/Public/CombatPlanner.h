@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UtilityConsiderations.h"
+
+// Facts the combat planner reasons about, one bit each in FCombatWorldState
+enum class ECombatFact : uint8
+{
+	EnemyDetected,
+	InAttackRange,
+	InRangedAttackRange,
+	EnemyAttacking,
+	CanStrafe,
+	CanBlock,
+	CanDodge,
+	// Seek only moves aggressive AI
+	Aggressive,
+	// The archetype has the montage for it
+	HasRangedAttack,
+	HasUltimateAttack,
+
+	MAX
+};
+
+static_assert(static_cast<int32>(ECombatFact::MAX) <= 16, "FCombatWorldState packs the facts into 16 bits");
+
+// Compact world state an AI plans from, also the plan cache key (with the archetype)
+struct FCombatWorldState
+{
+	uint16 Bits = 0;
+
+	static constexpr uint16 Mask(ECombatFact Fact) { return static_cast<uint16>(1u << static_cast<uint32>(Fact)); }
+
+	FORCEINLINE bool Has(ECombatFact Fact) const { return (Bits & Mask(Fact)) != 0; }
+	FORCEINLINE void Set(ECombatFact Fact, bool bValue) { Bits = bValue ? (Bits | Mask(Fact)) : (Bits & ~Mask(Fact)); }
+
+	// All of Required set & none of Forbidden
+	FORCEINLINE bool Meets(uint16 Required, uint16 Forbidden) const { return (Bits & Required) == Required && (Bits & Forbidden) == 0; }
+	FORCEINLINE void Apply(uint16 Added, uint16 Removed) { Bits = (Bits | Added) & ~Removed; }
+
+	FORCEINLINE bool operator==(const FCombatWorldState& Other) const { return Bits == Other.Bits; }
+};
+
+// One action of a plan with the conditions it was planned under
+struct FCombatPlanStep
+{
+	EUtilityAbility Ability = EUtilityAbility::EUA_Seek;
+
+	uint16 Required = 0;
+	uint16 Forbidden = 0;
+
+	// Expected world state change once the step is done
+	uint16 Added = 0;
+	uint16 Removed = 0;
+
+	// Kept running (re-issued every think) until its effects hold, instead of being done once the AI is free again
+	bool bDurative = false;
+};
+
+struct FCombatPlan
+{
+	TArray<FCombatPlanStep> Steps;
+
+	// Name of the root method the plan came from (for logging)
+	const TCHAR* MethodName = TEXT("None");
+};
+
+/**
+ * Hierarchical task network planner for combat sequences (approach, feint, strafe, finisher...)
+ * Decomposes the root Engage task through the methods in CombatPlanner.cpp, simulating each steps effects
+ */
+class AIMELEECOMBAT_API FCombatPlanner
+{
+public:
+
+	// Returns false if no method of the root task applies in State (the utility selector picks instead)
+	static bool Plan(FCombatWorldState State, FCombatPlan& OutPlan);
+};
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "CombatPlanner.h"
+#include "CombatPlannerSubsystem.generated.h"
+
+class UCombatArchetype;
+
+/**
+ * Caches the HTN combat plans keyed by archetype & world state bits, so every AI of an archetype in the same situation shares one plan
+ * Plans only depend on the world state, so a cached plan is exactly what planning again would return
+ */
+UCLASS()
+class AIMELEECOMBAT_API UCombatPlannerSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static UCombatPlannerSubsystem* Get(const UObject* WorldContextObject);
+
+	// Cached plan for the state, planned on a miss (nullptr if no method applies, which is cached too)
+	TSharedPtr<const FCombatPlan> FindOrPlan(const UCombatArchetype* Archetype, FCombatWorldState State);
+
+	// A followed plan had a step whose preconditions no longer hold
+	void RecordReplan();
+
+	// Logs the cache size, hit rate, replans & planning time (AIMelee.Planner.Report)
+	void LogReport() const;
+
+protected:
+
+	virtual void Deinitialize() override;
+
+private:
+
+	struct FPlanKey
+	{
+		FObjectKey Archetype;
+		uint16 StateBits = 0;
+
+		FORCEINLINE bool operator==(const FPlanKey& Other) const { return Archetype == Other.Archetype && StateBits == Other.StateBits; }
+		friend FORCEINLINE uint32 GetTypeHash(const FPlanKey& Key) { return HashCombine(GetTypeHash(Key.Archetype), Key.StateBits); }
+	};
+
+	TMap<FPlanKey, TSharedPtr<const FCombatPlan>> Plans;
+
+	int64 CacheHits = 0;
+	int64 CacheMisses = 0;
+	int64 Replans = 0;
+	double PlanSeconds = 0.0;
+};
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "CombatPolicy.generated.h"
+
+// Inputs of the policy network, the same facts the utility step conditions read (1/0 flags & health)
+enum class EPolicyInput : uint8
+{
+	EnemyDetected,
+	InAttackRange,
+	InRangedAttackRange,
+	CanStrafe,
+	CanBlock,
+	CanDodge,
+	EnemyAttacking,
+	HealthFraction,
+
+	MAX
+};
+
+USTRUCT(BlueprintType)
+struct FCombatPolicyLayer
+{
+	GENERATED_BODY()
+
+	// Row major [Output * NumInputs + Input], NumInputs is the previous layers outputs (or the policy inputs for the first layer)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Policy)
+	TArray<float> Weights;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Policy)
+	TArray<float> Biases;
+};
+
+/**
+ * Weights of a small MLP trained offline to pick abilities (ReLU hidden layers, sigmoid outputs in ability order)
+ * The last layer must have one output per EUtilityAbility
+ */
+UCLASS(BlueprintType)
+class AIMELEECOMBAT_API UCombatPolicyModel : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Policy)
+	TArray<FCombatPolicyLayer> Layers;
+};
+
+/**
+ * Policy network packed for batched CPU inference
+ * Weights are stored transposed & padded to the SIMD width, so every layer is a GEMV of 4 outputs at a time per agent
+ */
+class AIMELEECOMBAT_API FCombatPolicyNetwork
+{
+public:
+
+	static constexpr int32 NumInputs = static_cast<int32>(EPolicyInput::MAX);
+
+	// Returns false (& stays empty) if the layer sizes don't chain or the last layer isn't one output per ability
+	bool Build(const UCombatPolicyModel& Model);
+
+	// Random weights with the given hidden layer sizes, for timing the kernel without a trained model
+	void BuildRandom(TArrayView<const int32> HiddenSizes, int32 Seed);
+
+	void Reset();
+
+	FORCEINLINE bool IsValid() const { return Layers.Num() > 0; }
+
+	// Scores every agent in one call, Inputs is [Agent * NumInputs + Input] & OutScores [Agent * EUA_MAX + Ability] (0-1)
+	void Evaluate(TArrayView<const float> Inputs, int32 NumAgents, TArray<float>& OutScores) const;
+
+private:
+
+	struct FPackedLayer
+	{
+		int32 NumInputs = 0;
+		int32 NumOutputs = 0;
+		// NumOutputs rounded up to the SIMD width
+		int32 PaddedOutputs = 0;
+		// [Input * PaddedOutputs + Output], zero in the padding
+		TArray<float, TAlignedHeapAllocator<16>> Weights;
+		TArray<float, TAlignedHeapAllocator<16>> Biases;
+	};
+
+	void AddLayer(int32 InNumInputs, int32 InNumOutputs, TFunctionRef<float(int32 Output, int32 Input)> Weight, TFunctionRef<float(int32 Output)> Bias);
+
+	TArray<FPackedLayer> Layers;
+};
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatPolicy.h"
+#include "CombatPolicySubsystem.generated.h"
+
+class UAI_UtilityComponent;
+
+/**
+ * Alternative ability selector, scores every AI that asked to think this frame through the policy network in one batched call
+ * Only used once the model in the project settings has loaded, until then (or without one) the utility scores pick
+ */
+UCLASS()
+class AIMELEECOMBAT_API UCombatPolicySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static UCombatPolicySubsystem* Get(const UObject* WorldContextObject);
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	// A model is loaded & AIMelee.Policy.Enable is set
+	bool IsPolicyReady() const;
+
+	// Queues the AI for this frames batch (called from UpdateScore instead of scoring)
+	void RequestEvaluation(UAI_UtilityComponent* Utility);
+
+	// Times utility scoring against batched policy inference for 100 & 1000 generated AI (AIMelee.Policy.Benchmark)
+	static void RunBenchmark(UWorld* World);
+
+protected:
+
+	virtual void Deinitialize() override;
+
+private:
+
+	void OnModelLoaded();
+
+	UPROPERTY()
+	UCombatPolicyModel* Model;
+
+	FCombatPolicyNetwork Network;
+
+	TArray<TWeakObjectPtr<UAI_UtilityComponent>> PendingRequests;
+
+	// Reused every frame
+	TArray<float> Inputs;
+	TArray<float> Scores;
+};
@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatantRegistry.h"
+#include "CombatProjectileSubsystem.generated.h"
+
+class UInstancedStaticMeshComponent;
+class UStaticMesh;
+
+// One projectile in flight, kept small & flat so a step over thousands of them stays in cache
+struct FCombatProjectile
+{
+	FVector3f Location = FVector3f::ZeroVector;
+	FVector3f Velocity = FVector3f::ZeroVector;
+
+	// Downwards acceleration (gravity scale already applied)
+	float Gravity = 0.f;
+
+	float Radius = 0.f;
+	float Damage = 0.f;
+
+	// Seconds left before it is removed without hitting anything
+	float Lifetime = 0.f;
+
+	// Invalid for projectiles without a shooter (the benchmark), which are stopped by every combatant
+	FCombatantHandle Owner;
+};
+
+static_assert(sizeof(FCombatProjectile) == 48, "Keep projectiles packed, they are stepped thousands at a time");
+
+/**
+ * Simulates every ranged attack projectile as plain data instead of spawning projectile actors
+ * Projectiles are integrated at a fixed step & swept in one batch per step against the combatants capsules (a grid built from the registry) & the world,
+ * then drawn through one instanced mesh whose instances are reused as projectiles come & go (Project Settings > AI Melee Combat > Projectiles)
+ */
+UCLASS()
+class AIMELEECOMBAT_API UCombatProjectileSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UCombatProjectileSubsystem();
+
+	static UCombatProjectileSubsystem* Get(const UObject* WorldContextObject);
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	// Velocity in cm/s, projectiles with no damage are only stopped by what they hit
+	void Launch(FCombatantHandle Owner, const FVector& Location, const FVector& Velocity, float Damage, float Radius, float GravityScale);
+
+	FORCEINLINE int32 GetNumProjectiles() const { return Projectiles.Num(); }
+
+	// Times the simulation & visual update with 5000 projectiles in flight (AIMelee.Projectiles.Benchmark)
+	static void RunBenchmark(UWorld* World);
+
+	// Logs the projectiles in flight, hits & instance pool size (AIMelee.Projectiles.Report)
+	void LogReport() const;
+
+protected:
+
+	virtual void Deinitialize() override;
+
+private:
+
+	// A combatants capsule for this step
+	struct FHitVolume
+	{
+		FVector Center;
+		float Radius;
+		float HalfHeight;
+		FCombatantHandle Handle;
+	};
+
+	// Combatant (INDEX_NONE for the world) hit by a projectile during a step, at Time along its segment
+	struct FProjectileHit
+	{
+		int32 Volume = INDEX_NONE;
+		float Time = 1.f;
+		bool bHit = false;
+	};
+
+	void OnMeshLoaded();
+
+	void Step(float DeltaTime);
+
+	// Gathers the living combatants capsules & buckets them into the grid
+	void BuildHitVolumes();
+
+	// Nearest combatant capsule the segment passes through (INDEX_NONE if none)
+	int32 SweepHitVolumes(const FCombatProjectile& Projectile, const FVector& Start, const FVector& End, float& OutTime) const;
+
+	FORCEINLINE FIntPoint GetCell(const FVector& Location) const
+	{
+		return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+	}
+
+	// Moves the instances to the projectiles (extrapolated by Remainder into the next step), hiding the spares
+	void UpdateVisuals(float Remainder);
+
+	TArray<FCombatProjectile> Projectiles;
+
+	// Scratch arrays kept between steps
+	TArray<FProjectileHit> Hits;
+	TArray<FHitVolume> HitVolumes;
+	TArray<FTransform> InstanceTransforms;
+
+	TMap<FIntPoint, TArray<int32, TInlineAllocator<4>>> VolumeGrid;
+
+	float CellSize;
+
+	UPROPERTY()
+	UStaticMesh* Mesh;
+
+	UPROPERTY()
+	UInstancedStaticMeshComponent* Instances;
+
+	float TimeSinceStep;
+
+	int32 NumLaunched;
+	int32 NumCombatantHits;
+	int32 NumWorldHits;
+	int32 NumExpired;
+};
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatSignificanceSubsystem.generated.h"
+
+/**
+ * Scores every AI by distance to the players, combat involvement & visibility and places it in a significance bucket,
+ * which sets its utility think interval, actor tick interval, sight sense rate & movement tick interval together
+ */
+UCLASS()
+class AIMELEECOMBAT_API UCombatSignificanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UCombatSignificanceSubsystem();
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	// Significance score (0-1) from the last update, 0 for combatants that haven't been scored yet
+	float GetSignificance(struct FCombatantHandle Handle) const;
+
+	// Logs how many AI are in each bucket (AIMelee.Significance.Report)
+	void LogReport() const;
+
+private:
+
+	void UpdateSignificance();
+
+	float ScoreCombatant(const class AAI_BaseCharacter* AICharacter, const TArray<FVector, TInlineAllocator<4>>& ViewLocations) const;
+
+	int32 PickBucket(float Score, int32 CurrentBucket) const;
+
+	struct FSignificanceEntry
+	{
+		int32 Serial = 0;
+		int32 Bucket = INDEX_NONE;
+		float Score = 0.f;
+	};
+
+	// Indexed by combatant handle index
+	TArray<FSignificanceEntry> Entries;
+
+	TArray<int32> NumInBucket;
+
+	float TimeSinceUpdate;
+};
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "AI_UtilityComponent.h"
+#include "CombatSnapshotSubsystem.generated.h"
+
+/**
+ * Publishes the combat state the utility scores read into a double buffered snapshot once per frame
+ * & evaluates the AI that asked to think this frame as task graph jobs over it, while the game thread carries on
+ * The results are applied (ChooseBestAbility) at the next frames sync point, the only place jobs & game thread meet
+ */
+UCLASS()
+class AIMELEECOMBAT_API UCombatSnapshotSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static UCombatSnapshotSubsystem* Get(const UObject* WorldContextObject);
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	// AIMelee.Utility.Async
+	bool IsAsyncEvaluationEnabled() const;
+
+	// Queues an evaluation for the next snapshot (called from UpdateScore instead of scoring inline)
+	void RequestEvaluation(UAI_UtilityComponent* Utility);
+
+	// Times the evaluation of a generated snapshot on 1 to 16 worker threads (AIMelee.Utility.ParallelBenchmark)
+	static void RunScalingBenchmark(UWorld* World);
+
+protected:
+
+	virtual void Deinitialize() override;
+
+private:
+
+	struct FCombatantSnapshot
+	{
+		FVector Location = FVector::ZeroVector;
+		int32 Serial = 0;
+		bool bAlive = false;
+		bool bAttacking = false;
+	};
+
+	// One AI to score, inputs are filled on the game thread & the outputs by its job
+	struct FUtilityJob
+	{
+		TWeakObjectPtr<UAI_UtilityComponent> Utility;
+		FCombatantHandle Self;
+		FUtilityAgentState Agent;
+		TArray<FCombatantHandle, TInlineAllocator<8>> Candidates;
+
+		TArray<FUtilityTarget> Targets;
+		TArray<float> Scores;
+		TArray<int32> BestTargets;
+		int32 PairsEvaluated = 0;
+	};
+
+	// Immutable once published, until its jobs have been synced
+	struct FCombatSnapshot
+	{
+		// Indexed by combatant handle index
+		TArray<FCombatantSnapshot> Combatants;
+		TArray<FUtilityJob> Jobs;
+		bool bPrune = true;
+	};
+
+	void PublishSnapshot(FCombatSnapshot& Snapshot);
+
+	// Waits for the jobs still running on the front snapshot & hands their results to the utility components
+	void SyncAndApply();
+
+	static void LaunchJobs(FCombatSnapshot& Snapshot, int32 JobBatchSize, FGraphEventArray& OutEvents);
+
+	static void EvaluateJob(const FCombatSnapshot& Snapshot, FUtilityJob& Job);
+
+	// The game thread writes one buffer while the jobs launched last frame read the other
+	FCombatSnapshot Snapshots[2];
+	int32 FrontIndex = 0;
+
+	FGraphEventArray InFlight;
+
+	TArray<TWeakObjectPtr<UAI_UtilityComponent>> PendingRequests;
+};
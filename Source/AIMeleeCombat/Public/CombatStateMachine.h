@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CombatStateMachine.generated.h"
+
+// Combat States are set so actions cant be performed whilst another action is already being performed (must be Unoccupied before performing next action)
+UENUM(BlueprintType)
+enum class ECombatState : uint8
+{
+	ECS_Unoccupied UMETA(DisplayName = "Unoccupied"),
+	ECS_Attacking UMETA(DisplayName = "Attacking"),
+	ECS_Dodging UMETA(DisplayName = "Dodging"),
+	ECS_Blocking UMETA(DisplayName = "Blocking"),
+	ECS_Stunned UMETA(DisplayName = "Stunned"),
+	ECS_Patrol UMETA(DisplayName = "Patrol"),
+	ECS_Seek UMETA(DisplayName = "Seek"),
+	ECS_Strafe UMETA(DisplayName = "Strafe"),
+	ECS_Dead UMETA(DisplayName = "Dead"),
+
+	ECS_MAX
+};
+
+// Everything that can change an AIs combat state, see the transition table in CombatStateMachine.cpp
+UENUM(BlueprintType)
+enum class ECombatEvent : uint8
+{
+	ECE_Attack UMETA(DisplayName = "Attack"),
+	ECE_Block UMETA(DisplayName = "Block"),
+	ECE_Dodge UMETA(DisplayName = "Dodge"),
+	ECE_Stun UMETA(DisplayName = "Stun"),
+	// Montage finished (end action notify) or the action was abandoned
+	ECE_ActionFinished UMETA(DisplayName = "Action Finished"),
+	// Path following request finished (only ends movement states, never an attack)
+	ECE_MoveFinished UMETA(DisplayName = "Move Finished"),
+	ECE_Died UMETA(DisplayName = "Died"),
+	ECE_Revived UMETA(DisplayName = "Revived"),
+
+	ECE_MAX
+};
+
+// (old state, new state) broadcast after every accepted transition
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnCombatStateChanged, ECombatState, ECombatState);
+DECLARE_DELEGATE_OneParam(FCombatStateHook, ECombatState);
+
+/**
+ * Combat state of one AI, changed only by dispatching events through the compile time transition table
+ * Runs the exit hook of the old state & the entry hook of the new one, then broadcasts OnStateChanged so other systems don't have to poll
+ */
+class AIMELEECOMBAT_API FCombatStateMachine
+{
+public:
+
+	// Next state for the event, ECS_MAX if the event isn't allowed in State
+	static ECombatState GetNextState(ECombatState State, ECombatEvent Event);
+
+	// Returns false & leaves the state alone if the transition isn't in the table
+	bool Dispatch(ECombatEvent Event);
+
+	FORCEINLINE bool CanDispatch(ECombatEvent Event) const { return GetNextState(State, Event) != ECombatState::ECS_MAX; }
+
+	FORCEINLINE ECombatState GetState() const { return State; }
+
+	// Called with the state being left, then the state being entered (self transitions run both)
+	FCombatStateHook OnExit;
+	FCombatStateHook OnEnter;
+
+	FOnCombatStateChanged OnStateChanged;
+
+private:
+
+	ECombatState State = ECombatState::ECS_Unoccupied;
+
+	// Hooks dispatching another event would run its hooks in the middle of this transition
+	bool bDispatching = false;
+};
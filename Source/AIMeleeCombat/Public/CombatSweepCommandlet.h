@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "CombatMatch.h"
+#include "CombatSweepCommandlet.generated.h"
+
+class UCombatArchetype;
+
+/**
+ * Sweeps FCombatBehavior values over a grid or a random sample & plays every candidate against a baseline row in headless 1v1 & NvN matches
+ * Candidates run in parallel on every core, each worker with its own match state & random stream, & the results are written to CSV
+ *
+ * UnrealEditor-Cmd AIMeleeCombat.uproject -run=CombatSweep [-Archetype=/Game/...] [-Table=/Game/... -Row=Name] [-Mode=Grid|Random]
+ *     [-Steps=3] [-Samples=256] [-Matches=200] [-TeamSize=4] [-Seed=1] [-Out=Path.csv]
+ */
+UCLASS()
+class AIMELEECOMBAT_API UCombatSweepCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UCombatSweepCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+
+	// Sizes, ranges, damage & montage timings of the archetype (the archetype defaults if it can't be loaded)
+	static CombatCore::FMatchArchetype MakeMatchArchetype(const UCombatArchetype* Archetype);
+
+	// Every combination of Steps values in (0, 1] for the five behavior values
+	static void MakeGrid(int32 Steps, TArray<CombatCore::FBehaviorValues>& OutCandidates);
+
+	static void MakeRandomSample(int32 NumSamples, int32 Seed, TArray<CombatCore::FBehaviorValues>& OutCandidates);
+};
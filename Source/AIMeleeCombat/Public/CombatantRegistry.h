@@ -0,0 +1,148 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatantRegistry.generated.h"
+
+// What a registered combatant is (lets combat code resolve a handle to the right class without a UObject cast)
+UENUM(BlueprintType)
+enum class ECombatantKind : uint8
+{
+	ECK_None UMETA(DisplayName = "None"),
+	ECK_Player UMETA(DisplayName = "Player"),
+	ECK_AI UMETA(DisplayName = "AI"),
+
+	ECK_MAX
+};
+
+// Stable handle given to every player & AI combatant when it spawns
+// Index points into the registry table, Serial stops a recycled slot from being mistaken for the old combatant
+USTRUCT(BlueprintType)
+struct FCombatantHandle
+{
+	GENERATED_BODY()
+
+	FCombatantHandle() :
+		Index(INDEX_NONE),
+		Serial(0)
+	{
+	}
+
+	FCombatantHandle(int32 InIndex, int32 InSerial) :
+		Index(InIndex),
+		Serial(InSerial)
+	{
+	}
+
+	FORCEINLINE bool IsValid() const { return Index != INDEX_NONE; }
+	FORCEINLINE void Reset() { Index = INDEX_NONE; Serial = 0; }
+
+	FORCEINLINE bool operator==(const FCombatantHandle& Other) const { return Index == Other.Index && Serial == Other.Serial; }
+	FORCEINLINE bool operator!=(const FCombatantHandle& Other) const { return !(*this == Other); }
+
+	friend FORCEINLINE uint32 GetTypeHash(const FCombatantHandle& Handle) { return HashCombine(::GetTypeHash(Handle.Index), ::GetTypeHash(Handle.Serial)); }
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat)
+	int32 Index;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat)
+	int32 Serial;
+};
+
+// One packed row of the registry table (everything team checks need, without touching the actor)
+struct FCombatantRecord
+{
+	uint16 Serial = 0;
+	uint8 Team = 0;
+	ECombatantKind Kind = ECombatantKind::ECK_None;
+	uint8 bIsDead : 1;
+
+	FCombatantRecord() : bIsDead(false) {}
+};
+
+/**
+ * Assigns every combatant a handle at spawn & stores its team/kind in a packed table,
+ * so perception & weapon hit paths can do team checks and store targets without casting
+ */
+UCLASS()
+class AIMELEECOMBAT_API UCombatantRegistry : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static UCombatantRegistry* Get(const UObject* WorldContextObject);
+
+	// Called by the characters once their components are initialized
+	FCombatantHandle Register(ACharacter* Character, ECombatantKind Kind, int32 TeamNumber);
+
+	void Unregister(FCombatantHandle Handle);
+
+	// Looks up the handle of an actor reported by perception or a weapon trace (invalid handle if it isn't a combatant)
+	FCombatantHandle FindHandle(const AActor* Actor) const;
+
+	bool IsRegistered(FCombatantHandle Handle) const;
+
+	// Returns true if both combatants are registered & their teams are hostile in the team attitude matrix
+	bool AreEnemies(FCombatantHandle A, FCombatantHandle B) const;
+
+	void SetDead(FCombatantHandle Handle);
+
+	// Called when a combatant changes team at runtime
+	void SetTeam(FCombatantHandle Handle, int32 TeamNumber);
+
+	// Registered & not dead
+	bool IsAlive(FCombatantHandle Handle) const;
+
+	ECombatantKind GetKind(FCombatantHandle Handle) const;
+
+	ACharacter* GetCharacter(FCombatantHandle Handle) const;
+
+	// Resolve a handle to the concrete class (nullptr if the handle is stale or of the other kind)
+	class AAI_BaseCharacter* GetAICharacter(FCombatantHandle Handle) const;
+	class APlayerCharacter* GetPlayerCharacter(FCombatantHandle Handle) const;
+
+	FORCEINLINE int32 GetNumCombatants() const { return ActorToIndex.Num(); }
+
+	// Calls Func(Handle, Character, Kind) for every registered combatant, in table order
+	template<typename FuncType>
+	void ForEachCombatant(FuncType Func) const
+	{
+		for (int32 Index = 0; Index < Records.Num(); ++Index)
+		{
+			const FCombatantRecord& Record = Records[Index];
+			if(Record.Kind != ECombatantKind::ECK_None)
+			{
+				Func(FCombatantHandle(Index, Record.Serial), Characters[Index], Record.Kind);
+			}
+		}
+	}
+
+protected:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+private:
+
+	FORCEINLINE const FCombatantRecord* FindRecord(FCombatantHandle Handle) const
+	{
+		if(!Records.IsValidIndex(Handle.Index)) { return nullptr; }
+
+		const FCombatantRecord& Record = Records[Handle.Index];
+		return (Record.Kind != ECombatantKind::ECK_None && Record.Serial == Handle.Serial) ? &Record : nullptr;
+	}
+
+	TArray<FCombatantRecord> Records;
+
+	// Parallel to Records (keeps the registered characters referenced for garbage collection)
+	UPROPERTY()
+	TArray<ACharacter*> Characters;
+
+	TMap<const AActor*, int32> ActorToIndex;
+
+	TArray<int32> FreeIndices;
+};
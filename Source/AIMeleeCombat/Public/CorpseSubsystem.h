@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CorpseSubsystem.generated.h"
+
+class AAI_BaseCharacter;
+
+/**
+ * Keeps the dead AI left in the world under the corpse budget (Project Settings > AI Melee Combat > Corpses)
+ * Corpses past the budget are evicted oldest first & either destroyed or hidden in a pool spawners can reuse
+ */
+UCLASS()
+class AIMELEECOMBAT_API UCorpseSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static UCorpseSubsystem* Get(const UObject* WorldContextObject);
+
+	// Called by the AI once it has been stripped down to a corpse
+	void AddCorpse(AAI_BaseCharacter* Corpse);
+
+	// Takes a pooled combatant of exactly this class out of the pool (nullptr if there isn't one, the caller should spawn a new one)
+	// If Archetype is set the pooled combatant must use it too
+	// The combatant is still hidden & frozen, call ReviveFromPool() on it to bring it back
+	AAI_BaseCharacter* AcquirePooledCombatant(TSubclassOf<AAI_BaseCharacter> CombatantClass, const class UCombatArchetype* Archetype = nullptr);
+
+	FORCEINLINE int32 GetNumCorpses() const { return Corpses.Num(); }
+	FORCEINLINE int32 GetNumPooled() const { return Pool.Num(); }
+
+	// Logs the corpse & pool counts (AIMelee.Corpses.Report)
+	void LogReport() const;
+
+protected:
+
+	virtual void Deinitialize() override;
+
+private:
+
+	void EvictOldestCorpse();
+
+	void UpdateStats() const;
+
+	// Oldest first
+	UPROPERTY()
+	TArray<AAI_BaseCharacter*> Corpses;
+
+	UPROPERTY()
+	TArray<AAI_BaseCharacter*> Pool;
+};
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatantRegistry.h"
+#include "EncirclementSubsystem.generated.h"
+
+class AAI_BaseCharacter;
+
+/**
+ * Rings of slots around every contested target (a melee ring at the attackers AttackRange & a ranged ring at its RangedAttackRange)
+ * so AI seeking the same target each get their own stable goal instead of all pathing to the targets location
+ * Slots are handed out incrementally as agents join (cheapest free slot, swapping with one agent if that is clearly cheaper overall) & freed as they leave
+ */
+UCLASS()
+class AIMELEECOMBAT_API UEncirclementSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static UEncirclementSubsystem* Get(const UObject* WorldContextObject);
+
+	// Goal of the agents slot around its current enemy, joining the ring (or moving rings after a target change) if needed
+	// Returns false if the ring is full, the agent keeps aiming at the target until a slot frees up
+	bool GetSlotGoal(const AAI_BaseCharacter* Agent, FVector& OutGoal);
+
+	// Frees the agents slot (death, removal or dropping the target)
+	void Leave(FCombatantHandle Agent);
+
+	// Frees every slot around a target that died or was removed, its agents join new rings once they pick another target
+	void ReleaseTarget(FCombatantHandle Target);
+
+	// Logs every ring with its occupied slots (AIMelee.Encirclement.Report)
+	void LogReport() const;
+
+protected:
+
+	virtual void Deinitialize() override;
+
+private:
+
+	enum ERing : uint8
+	{
+		Melee,
+		Ranged,
+		NumRings
+	};
+
+	// Slots at fixed world angles, invalid handles are free
+	struct FTargetRings
+	{
+		TArray<FCombatantHandle> Slots[NumRings];
+	};
+
+	struct FAssignment
+	{
+		FCombatantHandle Target;
+		ERing Ring = Melee;
+		int32 Slot = INDEX_NONE;
+	};
+
+	// Joins the ring & returns the slot, INDEX_NONE if it is full
+	int32 AssignSlot(const AAI_BaseCharacter* Agent, FCombatantHandle Target, const FVector& TargetLocation, ERing Ring);
+
+	// Where the agent stands for a slot (its own attack range, so archetypes with different ranges share the ring angles)
+	static FVector GetSlotLocation(const AAI_BaseCharacter* Agent, const FVector& TargetLocation, ERing Ring, int32 Slot, int32 NumSlots);
+
+	static float GetSlotCost(const AAI_BaseCharacter* Agent, const FVector& TargetLocation, ERing Ring, int32 Slot, int32 NumSlots);
+
+	static ERing GetRing(const AAI_BaseCharacter* Agent);
+
+	TMap<FCombatantHandle, FTargetRings> Rings;
+
+	TMap<FCombatantHandle, FAssignment> Assignments;
+
+	int32 NumSwaps = 0;
+	int32 NumFull = 0;
+};
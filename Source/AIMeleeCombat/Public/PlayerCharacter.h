@@ -4,6 +4,9 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "CombatantRegistry.h"
+#include "GenericTeamAgentInterface.h"
+#include "CombatInterface.h"
 #include "PlayerCharacter.generated.h"
 
 UENUM(BlueprintType)
@@ -19,7 +22,7 @@ enum class EPlayerCombatState : uint8
 };
 
 UCLASS()
-class AIMELEECOMBAT_API APlayerCharacter : public ACharacter
+class AIMELEECOMBAT_API APlayerCharacter : public ACharacter, public IGenericTeamAgentInterface, public ICombatInterface
 {
 	GENERATED_BODY()
 
@@ -31,6 +34,11 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// Registers the player with the combatant registry
+	virtual void PostInitializeComponents() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	// Input for moving Forward/Backward
 	void MoveForwardBackward(float Value);
 
@@ -69,14 +77,15 @@ protected:
 
 	void SetMontageToPlay(UAnimMontage* Montage, FName Section) const;
 
-	// Sets CombatState to Unoccupied (Called as an AnimNotify at the end of Montages)
+	// Sets CombatState to Unoccupied (Called as an AnimNotify at the end of Montages, see UAnimNotify_EndAction)
 	// Allows player to use next action (attack, dodge etc.)
 	UFUNCTION(BlueprintCallable)
 	void SetUnoccupied();
 
-	// Compares team numbers to check if target is an enemy
-	bool IsEnemy(AActor* Target);
+	// Compares team numbers to check if target is an enemy (looked up through the combatant registry, no casting)
+	bool IsEnemy(const AActor* Target) const;
 
+	// Called every frame of the damage window by UAnimNotifyState_DamageWindow (or the old Blueprint notify)
 	UFUNCTION(BlueprintCallable)
 	void DamageDetectTrace();
 
@@ -144,6 +153,10 @@ private:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Runtime", meta = (AllowPrivateAccess = "true"))
 		bool bIsDodging;
 
+	// Set between the begin & end of the attack montages damage window notify
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Runtime", meta = (AllowPrivateAccess = "true"))
+		bool bDamageWindowActive;
+
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category = "Runtime", meta = (AllowPrivateAccess = "true"))
 	TArray<AActor*> AlreadyDamagedActors;
 
@@ -168,26 +181,44 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Combat", meta = (AllowPrivateAccess = "true"))
 		int32 MaxHP;
 
-	// Dodge Animation to play
+	// Dodge Animation to play (montages are soft references, streamed in by UCombatAssetStreamer when the player is spawned)
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Combat", meta = (AllowPrivateAccess = "true"))
-		UAnimMontage* DodgeMontage;
+		TSoftObjectPtr<UAnimMontage> DodgeMontage;
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Combat", meta = (AllowPrivateAccess = "true"))
-		UAnimMontage* AttackMontage;
+		TSoftObjectPtr<UAnimMontage> AttackMontage;
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Combat", meta = (AllowPrivateAccess = "true"))
-		UAnimMontage* DeathMontage;
+		TSoftObjectPtr<UAnimMontage> DeathMontage;
+
+	UPROPERTY()
+	UCombatantRegistry* CombatantRegistry;
+
+	FCombatantHandle CombatantHandle;
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
 	virtual float TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
 
+	// ICombatInterface (called directly by the native anim notifies in the montages)
+	virtual void BeginDamageWindow() override;
+	virtual void TickDamageWindow() override;
+	virtual void EndDamageWindow() override;
+	virtual void AdvanceCombo() override;
+	virtual void EndAction() override;
+
+	// IGenericTeamAgentInterface (TeamNumber as seen by AI perception)
+	virtual FGenericTeamId GetGenericTeamId() const override;
+	virtual void SetGenericTeamId(const FGenericTeamId& NewTeamID) override;
+
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
 	FORCEINLINE int32 GetTeamNumber() const { return TeamNumber; }
+	FORCEINLINE FCombatantHandle GetCombatantHandle() const { return CombatantHandle; }
 	FORCEINLINE bool GetIsAttacking() const { return bAttacking; }
 	FORCEINLINE bool IsDead() const { return bIsDead; }
+	FORCEINLINE bool IsInDamageWindow() const { return bDamageWindowActive; }
 
 };
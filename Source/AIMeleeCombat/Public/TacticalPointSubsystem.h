@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CombatantRegistry.h"
+#include "TacticalPointSubsystem.generated.h"
+
+class AAI_BaseCharacter;
+
+/**
+ * EQS style point query for strafing & ranged spacing around a target
+ * Rings of candidate points around the target are projected onto the navmesh in one batch & checked for line of sight,
+ * then scored in parallel per querier (spacing from allies, distance band & travel distance)
+ * The projected points are cached per target & distance band for a short time so allies around the same target reuse them
+ */
+UCLASS()
+class AIMELEECOMBAT_API UTacticalPointSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static UTacticalPointSubsystem* Get(const UObject* WorldContextObject);
+
+	// Best navigable point between MinDistance & MaxDistance from the queriers enemy, false if there is none (or no navmesh)
+	// The point is claimed so allies querying the same target in the next few moments space out from it
+	bool FindPoint(const AAI_BaseCharacter* Querier, float MinDistance, float MaxDistance, FVector& OutPoint);
+
+	// Logs the query & cache counts (AIMelee.Tactical.Report)
+	void LogReport() const;
+
+protected:
+
+	virtual void Deinitialize() override;
+
+private:
+
+	struct FTacticalCandidate
+	{
+		FVector Location = FVector::ZeroVector;
+		bool bLineOfSight = false;
+	};
+
+	// Projected candidates around one target
+	struct FTacticalCache
+	{
+		TArray<FTacticalCandidate> Candidates;
+		// Points picked by allies since the candidates were generated
+		TArray<FVector, TInlineAllocator<8>> Claimed;
+		FVector TargetLocation = FVector::ZeroVector;
+		float MinDistance = 0.f;
+		float MaxDistance = 0.f;
+		float Time = -1.f;
+	};
+
+	// One cache per target & distance band, so allies asking for different bands (melee strafing & ranged spacing) don't keep regenerating each others candidates
+	struct FTacticalCacheKey
+	{
+		FCombatantHandle Target;
+		// Band edges rounded to whole cm
+		int32 MinDistance = 0;
+		int32 MaxDistance = 0;
+
+		FORCEINLINE bool operator==(const FTacticalCacheKey& Other) const { return Target == Other.Target && MinDistance == Other.MinDistance && MaxDistance == Other.MaxDistance; }
+
+		friend FORCEINLINE uint32 GetTypeHash(const FTacticalCacheKey& Key)
+		{
+			return HashCombine(GetTypeHash(Key.Target), HashCombine(::GetTypeHash(Key.MinDistance), ::GetTypeHash(Key.MaxDistance)));
+		}
+	};
+
+	// Ring points around the target, batch projected onto the navmesh & line of sight checked
+	void GenerateCandidates(const AAI_BaseCharacter* Querier, const ACharacter* Target, FTacticalCache& Cache) const;
+
+	TMap<FTacticalCacheKey, FTacticalCache> Caches;
+
+	int32 NumQueries = 0;
+	int32 NumCacheHits = 0;
+	int32 NumFailed = 0;
+};
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UtilityConsiderations.generated.h"
+
+class UCurveFloat;
+
+// Abilities scored by UAI_UtilityComponent (same order as its AbilitiesAvailable array)
+UENUM(BlueprintType)
+enum class EUtilityAbility : uint8
+{
+	EUA_Seek UMETA(DisplayName = "Seek"),
+	EUA_Strafe UMETA(DisplayName = "Strafe"),
+	EUA_Attack UMETA(DisplayName = "Attack"),
+	EUA_RangedAttack UMETA(DisplayName = "Ranged Attack"),
+	EUA_UltimateAttack UMETA(DisplayName = "Ultimate Attack"),
+	EUA_Dodge UMETA(DisplayName = "Dodge"),
+	EUA_Block UMETA(DisplayName = "Block"),
+
+	EUA_MAX UMETA(Hidden)
+};
+
+// What a consideration curve reads
+UENUM(BlueprintType)
+enum class EUtilityInput : uint8
+{
+	// Distance to the target (cm)
+	EUI_Distance UMETA(DisplayName = "Distance"),
+	// Owners health / max health (0-1)
+	EUI_HealthFraction UMETA(DisplayName = "Health Fraction"),
+	// Seconds until the ability is off cooldown (strafe, block & dodge, 0 for the rest)
+	EUI_CooldownRemaining UMETA(DisplayName = "Cooldown Remaining"),
+	// 1 if the target is attacking or an attack was telegraphed, otherwise 0
+	EUI_EnemyAttacking UMETA(DisplayName = "Enemy Attacking"),
+
+	EUI_MAX UMETA(Hidden)
+};
+
+USTRUCT(BlueprintType)
+struct FUtilityConsideration
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI Behavior")
+	EUtilityInput Input = EUtilityInput::EUI_Distance;
+
+	// Input (x, in the inputs own units) to condition value (y, 0-1)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI Behavior")
+	UCurveFloat* Curve = nullptr;
+
+	// Inputs past this are clamped, the curve is baked between 0 & InputMax
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI Behavior", meta = (ClampMin = "0.001"))
+	float InputMax = 1.f;
+};
+
+USTRUCT(BlueprintType)
+struct FUtilityConsiderationSet
+{
+	GENERATED_BODY()
+
+	// Multiplied together with the behavior value, replacing the abilities built in step conditions
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AI Behavior")
+	TArray<FUtilityConsideration> Considerations;
+};
+
+// Consideration curve baked into a fixed size table, sampled without touching the curve asset
+struct AIMELEECOMBAT_API FBakedCurve
+{
+	static constexpr int32 NumSamples = 32;
+
+	void Bake(const UCurveFloat* Curve, float InInputMax);
+
+	// Clamped linear interpolation between the two nearest samples
+	FORCEINLINE float Sample(float Input) const
+	{
+		const float Position = FMath::Clamp(Input * InvInputStep, 0.f, static_cast<float>(NumSamples));
+		const int32 Index = FMath::Min(static_cast<int32>(Position), NumSamples - 1);
+		return FMath::Lerp(Samples[Index], Samples[Index + 1], Position - Index);
+	}
+
+	// NumSamples + 1 so the last interval has both ends
+	float Samples[NumSamples + 1] = {};
+	float InvInputStep = 0.f;
+	float MaxValue = 0.f;
+};
+
+// Baked considerations of one ability
+struct AIMELEECOMBAT_API FBakedConsiderationSet
+{
+	void Bake(const FUtilityConsiderationSet& Set);
+
+	FORCEINLINE bool IsEmpty() const { return Curves.Num() == 0; }
+
+	// Whether one of the curves reads the cooldown (if not the ability keeps its hard cooldown gate)
+	bool bReadsCooldown = false;
+
+	TArray<EUtilityInput, TInlineAllocator<4>> Inputs;
+	TArray<FBakedCurve, TInlineAllocator<4>> Curves;
+};
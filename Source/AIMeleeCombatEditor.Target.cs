@@ -9,6 +9,6 @@ public class AIMeleeCombatEditorTarget : TargetRules
 	{
 		Type = TargetType.Editor;
 		DefaultBuildSettings = BuildSettingsVersion.V2;
-		ExtraModuleNames.AddRange( new string[] { "AIMeleeCombat" } );
+		ExtraModuleNames.AddRange( new string[] { "AIMeleeCombat", "CombatCore" } );
 	}
 }
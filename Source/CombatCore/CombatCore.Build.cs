@@ -0,0 +1,14 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+public class CombatCore : ModuleRules
+{
+	public CombatCore(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		// Core is only needed for the module boilerplate, the combat rules themselves are plain C++ & don't include any engine headers
+		PublicDependencyModuleNames.AddRange(new string[] { "Core" });
+	}
+}
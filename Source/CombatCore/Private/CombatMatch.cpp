@@ -0,0 +1,406 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatMatch.h"
+#include <cmath>
+#include <vector>
+
+namespace CombatCore
+{
+	namespace
+	{
+		constexpr int32_t NumAbilities = static_cast<int32_t>(EAbility::Count);
+
+		// Agents stop seeking this far inside their attack range, like the move acceptance radius
+		constexpr float SeekAcceptance = 0.9f;
+
+		struct FMatchAgent
+		{
+			float X = 0.f;
+			float Y = 0.f;
+			float Health = 0.f;
+			int32_t Team = 0;
+			int32_t Target = -1;
+
+			// Current action (Count while unoccupied) & seconds into it
+			EAbility Action = EAbility::Count;
+			float ActionTime = 0.f;
+			bool bImpactDone = false;
+
+			bool bSeeking = false;
+			// Circling direction (+1 / -1) & seconds left, 0 when not strafing
+			float StrafeSign = 1.f;
+			float StrafeTimeLeft = 0.f;
+
+			float NextThinkTime = 0.f;
+			float StrafeReadyTime = 0.f;
+			float BlockReadyTime = 0.f;
+			float DodgeReadyTime = 0.f;
+
+			bool IsAlive() const { return Health > 0.f; }
+			bool IsUnoccupied() const { return Action == EAbility::Count; }
+		};
+
+		float Distance(const FMatchAgent& A, const FMatchAgent& B)
+		{
+			return std::sqrt((A.X - B.X) * (A.X - B.X) + (A.Y - B.Y) * (A.Y - B.Y));
+		}
+
+		const FActionTiming& GetTiming(const FMatchArchetype& Archetype, EAbility Action)
+		{
+			switch (Action)
+			{
+			case EAbility::RangedAttack:
+				return Archetype.RangedAttack;
+			case EAbility::UltimateAttack:
+				return Archetype.UltimateAttack;
+			case EAbility::Block:
+				return Archetype.Block;
+			case EAbility::Dodge:
+				return Archetype.Dodge;
+			default:
+				return Archetype.Attack;
+			}
+		}
+
+		class FMatch
+		{
+		public:
+
+			FMatch(const FBehaviorValues& A, const FBehaviorValues& B, const FMatchArchetype& InArchetype, const FMatchConfig& InConfig, FCombatRandom& InRandom, FMatchStats& InStats) :
+				Archetype(InArchetype),
+				Config(InConfig),
+				Random(InRandom),
+				Stats(InStats)
+			{
+				Behaviors[0] = A;
+				Behaviors[1] = B;
+
+				// Two lines facing each other, spaced so allies don't start on top of each other
+				const int32_t TeamSize = Config.TeamSize > 0 ? Config.TeamSize : 1;
+				for (int32_t Team = 0; Team < 2; ++Team)
+				{
+					for (int32_t Index = 0; Index < TeamSize; ++Index)
+					{
+						FMatchAgent Agent;
+						Agent.Team = Team;
+						Agent.X = Team == 0 ? 0.f : Config.StartDistance;
+						Agent.Y = (Index - (TeamSize - 1) * 0.5f) * 200.f;
+						Agent.Health = Archetype.MaxHealth;
+						Agent.NextThinkTime = Random.NextFloat() * Config.ThinkInterval;
+						Order.push_back(static_cast<int32_t>(Agents.size()));
+						Agents.push_back(Agent);
+					}
+				}
+			}
+
+			void Run()
+			{
+				const float StepSeconds = Config.StepSeconds > 0.f ? Config.StepSeconds : 0.05f;
+				int32_t Winner = -1;
+				while(Time < Config.MaxDuration)
+				{
+					Step(StepSeconds);
+					Time += StepSeconds;
+
+					const bool bAliveA = IsTeamAlive(0);
+					const bool bAliveB = IsTeamAlive(1);
+					if(!bAliveA || !bAliveB)
+					{
+						Winner = bAliveA ? 0 : (bAliveB ? 1 : -1);
+						break;
+					}
+				}
+
+				++Stats.NumMatches;
+				if(Winner >= 0)
+				{
+					++Stats.Decisive;
+					Stats.WinsA += Winner == 0 ? 1 : 0;
+					Stats.TimeToKill += Time;
+				}
+			}
+
+		private:
+
+			bool IsTeamAlive(int32_t Team) const
+			{
+				for (const FMatchAgent& Agent : Agents)
+				{
+					if(Agent.Team == Team && Agent.IsAlive()) { return true; }
+				}
+				return false;
+			}
+
+			// Nearest living enemy, -1 once the other team is dead
+			int32_t FindTarget(const FMatchAgent& Agent) const
+			{
+				int32_t Best = -1;
+				float BestDistance = 0.f;
+				for (int32_t Index = 0; Index < static_cast<int32_t>(Agents.size()); ++Index)
+				{
+					const FMatchAgent& Other = Agents[Index];
+					if(Other.Team == Agent.Team || !Other.IsAlive()) { continue; }
+
+					const float OtherDistance = Distance(Agent, Other);
+					if(Best < 0 || OtherDistance < BestDistance)
+					{
+						Best = Index;
+						BestDistance = OtherDistance;
+					}
+				}
+				return Best;
+			}
+
+			FStepFacts MakeFacts(const FMatchAgent& Agent, const FMatchAgent& Target, bool bEnemyAttacking) const
+			{
+				FStepFacts Facts;
+				Facts.Distance = Distance(Agent, Target);
+				Facts.bDetected = true;
+				Facts.bEnemyAttacking = bEnemyAttacking;
+				Facts.bCanStrafe = Time >= Agent.StrafeReadyTime;
+				Facts.bCanBlock = Time >= Agent.BlockReadyTime;
+				Facts.bCanDodge = Time >= Agent.DodgeReadyTime;
+				return Facts;
+			}
+
+			void StartAction(FMatchAgent& Agent, EAbility Action)
+			{
+				Agent.Action = Action;
+				Agent.ActionTime = 0.f;
+				Agent.bImpactDone = false;
+				Agent.bSeeking = false;
+				Agent.StrafeTimeLeft = 0.f;
+			}
+
+			// The telegraph, a defender that isn't busy may block or dodge the attack it just saw start
+			void Telegraph(FMatchAgent& Defender, const FMatchAgent& Attacker)
+			{
+				if(!Defender.IsAlive() || !Defender.IsUnoccupied()) { return; }
+
+				const FBehaviorValues& Behavior = Behaviors[Defender.Team];
+				const FStepFacts Facts = MakeFacts(Defender, Attacker, true);
+				const float DodgeScore = StepScore(EAbility::Dodge, Behavior, Archetype.Ranges, Facts);
+				const float BlockScore = StepScore(EAbility::Block, Behavior, Archetype.Ranges, Facts);
+
+				const float Roll = Random.NextFloat();
+				if(BlockScore >= DodgeScore && Roll < BlockScore)
+				{
+					StartAction(Defender, EAbility::Block);
+					Defender.BlockReadyTime = Time + RollCooldown(BlockCooldown, Random.NextFloat());
+				}
+				else if(Roll < DodgeScore)
+				{
+					StartAction(Defender, EAbility::Dodge);
+					Defender.DodgeReadyTime = Time + RollCooldown(DodgeCooldown, Random.NextFloat());
+				}
+			}
+
+			void Think(int32_t AgentIndex)
+			{
+				FMatchAgent& Agent = Agents[AgentIndex];
+				Agent.NextThinkTime = Time + Config.ThinkInterval;
+				Agent.Target = FindTarget(Agent);
+				if(Agent.Target < 0) { return; }
+
+				FMatchAgent& Target = Agents[Agent.Target];
+				const bool bTargetAttacking = Target.Action == EAbility::Attack || Target.Action == EAbility::RangedAttack || Target.Action == EAbility::UltimateAttack;
+				const FStepFacts Facts = MakeFacts(Agent, Target, bTargetAttacking);
+
+				float Scores[NumAbilities];
+				for (int32_t Ability = 0; Ability < NumAbilities; ++Ability)
+				{
+					Scores[Ability] = StepScore(static_cast<EAbility>(Ability), Behaviors[Agent.Team], Archetype.Ranges, Facts);
+				}
+				const EAbility Choice = static_cast<EAbility>(PickDitheredAbility(Scores, NumAbilities, Random.NextFloat()));
+
+				if(Agent.Team == 0)
+				{
+					++Stats.AbilityUses[static_cast<int32_t>(Choice)];
+					++Stats.NumChoices;
+				}
+
+				const ERangeBand Band = GetRangeBand(Facts.Distance, Archetype.Ranges);
+				switch (Choice)
+				{
+				case EAbility::Seek:
+					Agent.bSeeking = true;
+					break;
+				case EAbility::Strafe:
+					if(Facts.bCanStrafe)
+					{
+						Agent.bSeeking = false;
+						Agent.StrafeSign = Random.NextFloat() < 0.5f ? -1.f : 1.f;
+						Agent.StrafeTimeLeft = Archetype.StrafeDuration;
+						Agent.StrafeReadyTime = Time + RollCooldown(StrafeCooldown, Random.NextFloat());
+					}
+					break;
+				case EAbility::Attack:
+				case EAbility::UltimateAttack:
+					// Melee attacks are skipped out of range, as AttackCombo does
+					if(Choice == EAbility::UltimateAttack || Band == ERangeBand::Melee)
+					{
+						StartAction(Agent, Choice);
+						Telegraph(Target, Agent);
+					}
+					break;
+				case EAbility::RangedAttack:
+					StartAction(Agent, Choice);
+					Telegraph(Target, Agent);
+					break;
+				case EAbility::Block:
+					StartAction(Agent, Choice);
+					Agent.BlockReadyTime = Time + RollCooldown(BlockCooldown, Random.NextFloat());
+					break;
+				case EAbility::Dodge:
+					StartAction(Agent, Choice);
+					Agent.DodgeReadyTime = Time + RollCooldown(DodgeCooldown, Random.NextFloat());
+					break;
+				default:
+					break;
+				}
+			}
+
+			void Impact(FMatchAgent& Agent)
+			{
+				Agent.bImpactDone = true;
+				if(Agent.Target < 0) { return; }
+
+				FMatchAgent& Target = Agents[Agent.Target];
+				if(!Target.IsAlive()) { return; }
+
+				// Melee hits need the target still in reach, projectiles fly out to a bit past the ranged attack range
+				const float TargetDistance = Distance(Agent, Target);
+				float Damage = Archetype.MeleeDamage;
+				float Reach = Archetype.Ranges.AttackRange;
+				if(Agent.Action == EAbility::RangedAttack)
+				{
+					Damage = Archetype.RangedDamage;
+					Reach = Archetype.Ranges.RangedAttackRange * 1.5f;
+				}
+				else if(Agent.Action == EAbility::UltimateAttack)
+				{
+					Damage = Archetype.UltimateDamage;
+				}
+				if(TargetDistance > Reach) { return; }
+
+				FDefenderState Defender;
+				Defender.Health = Target.Health;
+				Defender.bBlocking = Target.Action == EAbility::Block;
+				Defender.bDodging = Target.Action == EAbility::Dodge;
+				Target.Health = ResolveDamage(Defender, Damage).Health;
+			}
+
+			void Move(FMatchAgent& Agent, float DeltaTime)
+			{
+				if(Agent.Target < 0 || !Agent.IsUnoccupied()) { return; }
+
+				const FMatchAgent& Target = Agents[Agent.Target];
+				const float TargetDistance = Distance(Agent, Target);
+				if(TargetDistance <= 1.f) { return; }
+
+				const float DirX = (Target.X - Agent.X) / TargetDistance;
+				const float DirY = (Target.Y - Agent.Y) / TargetDistance;
+				const float MoveDistance = Archetype.MoveSpeed * DeltaTime;
+
+				if(Agent.StrafeTimeLeft > 0.f)
+				{
+					Agent.StrafeTimeLeft -= DeltaTime;
+					Agent.X += -DirY * Agent.StrafeSign * MoveDistance;
+					Agent.Y += DirX * Agent.StrafeSign * MoveDistance;
+				}
+				else if(Agent.bSeeking)
+				{
+					const float Remaining = TargetDistance - Archetype.Ranges.AttackRange * SeekAcceptance;
+					if(Remaining <= 0.f)
+					{
+						Agent.bSeeking = false;
+						return;
+					}
+
+					const float Step = MoveDistance < Remaining ? MoveDistance : Remaining;
+					Agent.X += DirX * Step;
+					Agent.Y += DirY * Step;
+				}
+			}
+
+			void Step(float DeltaTime)
+			{
+				// Agents act one after the other, so the order is shuffled every step or whoever comes first would land (& see) every tied hit first
+				for (int32_t Index = static_cast<int32_t>(Order.size()) - 1; Index > 0; --Index)
+				{
+					const int32_t Swap = static_cast<int32_t>(Random.NextUInt() % static_cast<uint32_t>(Index + 1));
+					const int32_t Temp = Order[Index];
+					Order[Index] = Order[Swap];
+					Order[Swap] = Temp;
+				}
+
+				for (const int32_t Index : Order)
+				{
+					FMatchAgent& Agent = Agents[Index];
+					if(!Agent.IsAlive()) { continue; }
+
+					if(!Agent.IsUnoccupied())
+					{
+						Agent.ActionTime += DeltaTime;
+
+						const FActionTiming& Timing = GetTiming(Archetype, Agent.Action);
+						const bool bAttack = Agent.Action == EAbility::Attack || Agent.Action == EAbility::RangedAttack || Agent.Action == EAbility::UltimateAttack;
+						if(bAttack && !Agent.bImpactDone && Agent.ActionTime >= Timing.ImpactTime)
+						{
+							Impact(Agent);
+						}
+						if(Agent.ActionTime >= Timing.Duration)
+						{
+							Agent.Action = EAbility::Count;
+						}
+						continue;
+					}
+
+					// Targets that died since the last think are dropped straight away rather than chased
+					if(Agent.Target >= 0 && !Agents[Agent.Target].IsAlive())
+					{
+						Agent.Target = -1;
+						Agent.NextThinkTime = Time;
+					}
+
+					if(Time >= Agent.NextThinkTime)
+					{
+						Think(Index);
+					}
+					Move(Agent, DeltaTime);
+				}
+			}
+
+			FBehaviorValues Behaviors[2];
+			const FMatchArchetype& Archetype;
+			const FMatchConfig& Config;
+			FCombatRandom& Random;
+			FMatchStats& Stats;
+
+			std::vector<FMatchAgent> Agents;
+			// Update order of the agents this step
+			std::vector<int32_t> Order;
+			float Time = 0.f;
+		};
+	}
+
+	void FMatchStats::Add(const FMatchStats& Other)
+	{
+		NumMatches += Other.NumMatches;
+		WinsA += Other.WinsA;
+		Decisive += Other.Decisive;
+		TimeToKill += Other.TimeToKill;
+		for (int32_t Ability = 0; Ability < NumAbilities; ++Ability)
+		{
+			AbilityUses[Ability] += Other.AbilityUses[Ability];
+		}
+		NumChoices += Other.NumChoices;
+	}
+
+	void SimulateMatch(const FBehaviorValues& A, const FBehaviorValues& B, const FMatchArchetype& Archetype, const FMatchConfig& Config, FCombatRandom& Random, FMatchStats& OutStats)
+	{
+		FMatch Match(A, B, Archetype, Config, Random, OutStats);
+		Match.Run();
+	}
+}
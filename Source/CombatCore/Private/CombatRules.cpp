@@ -0,0 +1,209 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatRules.h"
+
+namespace CombatCore
+{
+	namespace
+	{
+		// Condition value of each ability when its requirements are met (also the upper bound used for pruning)
+		constexpr float SeekCondition = 0.9f;
+		constexpr float StrafeCondition = 0.8f;
+		constexpr float AttackCondition = 0.6f;
+		constexpr float RangedAttackCondition = 0.3f;
+		constexpr float UltimateAttackCondition = 0.2f;
+		constexpr float DodgeCondition = 0.5f;
+		constexpr float BlockCondition = 0.6f;
+
+		constexpr float MetCondition[static_cast<int32_t>(EAbility::Count)] =
+		{
+			SeekCondition,
+			StrafeCondition,
+			AttackCondition,
+			RangedAttackCondition,
+			UltimateAttackCondition,
+			DodgeCondition,
+			BlockCondition
+		};
+
+		bool IsConditionMet(EAbility Ability, const FRangeProfile& Ranges, const FStepFacts& Facts)
+		{
+			const ERangeBand Band = GetRangeBand(Facts.Distance, Ranges);
+			switch (Ability)
+			{
+			case EAbility::Seek:
+				return Facts.bDetected && Band == ERangeBand::OutOfRange;
+			case EAbility::Strafe:
+				return Facts.bDetected && Facts.bCanStrafe;
+			case EAbility::Attack:
+			case EAbility::UltimateAttack:
+				return Facts.bDetected && Band == ERangeBand::Melee;
+			case EAbility::RangedAttack:
+				return Facts.bDetected && Band == ERangeBand::Ranged;
+			case EAbility::Dodge:
+				return Facts.bEnemyAttacking && Facts.bCanDodge;
+			case EAbility::Block:
+				return Facts.bEnemyAttacking && Facts.bCanBlock;
+			default:
+				return false;
+			}
+		}
+
+		// Seek & strafe are scored on their condition alone
+		float GetStepBehaviorValue(const FBehaviorValues& Behavior, EAbility Ability, float Condition)
+		{
+			return (Ability == EAbility::Seek || Ability == EAbility::Strafe) ? Condition : GetBehaviorValue(Behavior, Ability);
+		}
+	}
+
+	FDamageResult ResolveDamage(const FDefenderState& Defender, float Damage)
+	{
+		FDamageResult Result;
+		Result.Outcome = Defender.bDodging ? EHitOutcome::Dodged : (Defender.bBlocking ? EHitOutcome::Blocked : EHitOutcome::Hit);
+
+		if(Defender.Health - Damage <= 0.f)
+		{
+			Result.Damage = Damage;
+			Result.Health = 0.f;
+			Result.bKilled = true;
+			return Result;
+		}
+
+		// Attack does half damage if the defender is blocking & none if they are dodging
+		if(Defender.bBlocking)
+		{
+			Damage *= BlockDamageScale;
+		}
+		if(Defender.bDodging)
+		{
+			Damage = 0.f;
+		}
+
+		Result.Damage = Damage;
+		Result.Health = Defender.Health - Damage;
+		return Result;
+	}
+
+	float ScoreConditions(float BehaviorValue, const float* Conditions, int32_t NumConditions)
+	{
+		float Score = BehaviorValue;
+		for (int32_t Index = 0; Index < NumConditions; ++Index)
+		{
+			Score *= Conditions[Index];
+
+			if(Score == 0)
+			{
+				return 0;
+			}
+		}
+
+		// Averaging scheme of overall score
+		// Depending on the amount of conditions being multiplied, Score can become very small,
+		// so this calculation averages it out giving it a more readable score
+		// (integer division as it always was, a single condition gets no makeup & two or more get the full makeup)
+		const float ModFactor = NumConditions > 0 ? 1 - (1 / NumConditions) : 0.f;
+		const float MakeupValue = (1 - Score) * ModFactor;
+		return Score + (MakeupValue * Score);
+	}
+
+	float GetBehaviorValue(const FBehaviorValues& Behavior, EAbility Ability)
+	{
+		switch (Ability)
+		{
+		case EAbility::Attack:
+			return Behavior.Attack;
+		case EAbility::RangedAttack:
+			return Behavior.RangedAttack;
+		case EAbility::UltimateAttack:
+			return Behavior.UltimateAttack;
+		case EAbility::Dodge:
+			return Behavior.Dodge;
+		case EAbility::Block:
+			return Behavior.Block;
+		default:
+			return 1.f;
+		}
+	}
+
+	float StepScore(EAbility Ability, const FBehaviorValues& Behavior, const FRangeProfile& Ranges, const FStepFacts& Facts)
+	{
+		if(Ability >= EAbility::Count) { return 0.f; }
+
+		const float Condition = IsConditionMet(Ability, Ranges, Facts) ? MetCondition[static_cast<int32_t>(Ability)] : 0.f;
+		return ScoreConditions(GetStepBehaviorValue(Behavior, Ability, Condition), &Condition, 1);
+	}
+
+	float StepUpperBound(EAbility Ability, const FBehaviorValues& Behavior)
+	{
+		if(Ability >= EAbility::Count) { return 0.f; }
+
+		const float Condition = MetCondition[static_cast<int32_t>(Ability)];
+		return ScoreConditions(GetStepBehaviorValue(Behavior, Ability, Condition), &Condition, 1);
+	}
+
+	int32_t PickDitheredAbility(const float* Scores, int32_t NumScores, float Roll)
+	{
+		int32_t Best = 0;
+		for (int32_t Index = 0; Index < NumScores; ++Index)
+		{
+			if(Roll < Scores[Index])
+			{
+				// Equal scores resolve to the first ability with that score
+				int32_t First = 0;
+				while(Scores[First] != Scores[Index])
+				{
+					++First;
+				}
+				Best = First;
+			}
+		}
+		return Best;
+	}
+
+	float ResolveExchange(const FExchangeProfile& Attacker, const FExchangeProfile& Defender, float DeltaTime, float Roll, EHitOutcome& OutHit)
+	{
+		// Same mitigation as ResolveDamage, a dodge avoids the damage & a block scales it
+		if(Roll < Defender.DodgeChance)
+		{
+			OutHit = EHitOutcome::Dodged;
+			return 0.f;
+		}
+
+		const float Damage = Attacker.DamagePerSecond * DeltaTime;
+		if(Roll < Defender.DodgeChance + Defender.BlockChance)
+		{
+			OutHit = EHitOutcome::Blocked;
+			return Damage * BlockDamageScale;
+		}
+
+		OutHit = EHitOutcome::Hit;
+		return Damage;
+	}
+
+	void SimulateDuels(const FExchangeProfile& A, const FExchangeProfile& B, float DeltaTime, float MaxDuration, int32_t NumDuels, FCombatRandom& Random, FDuelStats& OutStats)
+	{
+		if(DeltaTime <= 0.f) { return; }
+
+		EHitOutcome Hit;
+		for (int32_t Duel = 0; Duel < NumDuels; ++Duel)
+		{
+			float HealthA = A.MaxHealth;
+			float HealthB = B.MaxHealth;
+			float Duration = 0.f;
+			while(HealthA > 0.f && HealthB > 0.f && Duration < MaxDuration)
+			{
+				// Both sides strike every step, whoever started the step alive gets their exchange
+				HealthB -= ResolveExchange(A, B, DeltaTime, Random.NextFloat(), Hit);
+				HealthA -= ResolveExchange(B, A, DeltaTime, Random.NextFloat(), Hit);
+				Duration += DeltaTime;
+				OutStats.NumExchanges += 2;
+			}
+
+			OutStats.WinsA += (HealthB <= 0.f && HealthA > 0.f) ? 1 : 0;
+			OutStats.Decisive += (HealthA <= 0.f) != (HealthB <= 0.f) ? 1 : 0;
+			OutStats.TotalDuration += Duration;
+		}
+		OutStats.NumDuels += NumDuels;
+	}
+}
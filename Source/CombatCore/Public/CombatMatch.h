@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CombatRules.h"
+
+/**
+ * Headless team fights between AI driven by the same rules as the live AI (step scores, dithered ability choice, damage mitigation & cooldowns)
+ * on a flat plane without navigation or animation, so behavior values can be compared over thousands of matches
+ * Every call only touches its own arguments, so matches can run on any number of threads at once
+ */
+namespace CombatCore
+{
+	// Length of an action & when its hit lands (seconds from the start)
+	struct FActionTiming
+	{
+		float Duration = 1.f;
+		float ImpactTime = 0.5f;
+	};
+
+	// What the matches know about the archetype both teams are made of
+	struct FMatchArchetype
+	{
+		float MaxHealth = 300.f;
+		FRangeProfile Ranges = { 250.f, 350.f };
+		float MoveSpeed = 600.f;
+		float MeleeDamage = MeleeHitDamage;
+		float RangedDamage = 20.f;
+		float UltimateDamage = MeleeHitDamage;
+
+		FActionTiming Attack = { 1.f, 0.5f };
+		FActionTiming RangedAttack = { 1.2f, 0.6f };
+		FActionTiming UltimateAttack = { 2.f, 1.2f };
+		FActionTiming Block = { 1.f, 0.f };
+		FActionTiming Dodge = { 0.8f, 0.f };
+		// Seconds spent circling per strafe
+		float StrafeDuration = 1.f;
+	};
+
+	struct FMatchConfig
+	{
+		int32_t TeamSize = 1;
+		float StepSeconds = 0.05f;
+		float ThinkInterval = 0.5f;
+		float MaxDuration = 120.f;
+		// Distance between the two teams lines at the start
+		float StartDistance = 1500.f;
+	};
+
+	struct FMatchStats
+	{
+		int32_t NumMatches = 0;
+		int32_t WinsA = 0;
+		// Matches one team won (the rest timed out)
+		int32_t Decisive = 0;
+		// Sum of the durations of the decisive matches
+		double TimeToKill = 0.0;
+		// Abilities chosen by team A
+		int64_t AbilityUses[static_cast<int32_t>(EAbility::Count)] = {};
+		int64_t NumChoices = 0;
+
+		COMBATCORE_API void Add(const FMatchStats& Other);
+	};
+
+	// Plays one match of TeamSize agents with behavior A against TeamSize with behavior B, adding the result to OutStats
+	COMBATCORE_API void SimulateMatch(const FBehaviorValues& A, const FBehaviorValues& B, const FMatchArchetype& Archetype, const FMatchConfig& Config, FCombatRandom& Random, FMatchStats& OutStats);
+}
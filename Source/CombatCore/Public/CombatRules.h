@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// Plain C++ on purpose (no engine headers or types), so the rules compile & run outside the engine as well
+#include <cstdint>
+
+#ifndef COMBATCORE_API
+#define COMBATCORE_API
+#endif
+
+/**
+ * The combat rules the actors & subsystems apply: damage mitigation, range bands, ability scoring, attack section & cooldown rolls and abstract exchanges
+ * Everything takes plain state structs & random rolls as arguments, so results only depend on the inputs
+ */
+namespace CombatCore
+{
+	// How an incoming hit landed on the defender
+	enum class EHitOutcome : uint8_t
+	{
+		Hit,
+		Blocked,
+		Dodged
+	};
+
+	// Same order as EUtilityAbility
+	enum class EAbility : uint8_t
+	{
+		Seek,
+		Strafe,
+		Attack,
+		RangedAttack,
+		UltimateAttack,
+		Dodge,
+		Block,
+
+		Count
+	};
+
+	enum class ERangeBand : uint8_t
+	{
+		// Within AttackRange
+		Melee,
+		// Past AttackRange but within RangedAttackRange
+		Ranged,
+		OutOfRange
+	};
+
+	// A blocked hit does this fraction of its damage, a dodged one none
+	constexpr float BlockDamageScale = 0.5f;
+
+	constexpr int32_t NumAttackSections = 4;
+
+	// Damage of one weapon hit (melee attacks & the ultimate)
+	constexpr float MeleeHitDamage = 20.f;
+
+	struct FCooldownRange
+	{
+		float Min;
+		float Max;
+	};
+
+	constexpr FCooldownRange StrafeCooldown = { 8.f, 10.f };
+	constexpr FCooldownRange BlockCooldown = { 4.f, 6.f };
+	constexpr FCooldownRange DodgeCooldown = { 4.f, 6.f };
+
+	struct FRangeProfile
+	{
+		float AttackRange = 0.f;
+		float RangedAttackRange = 0.f;
+	};
+
+	// Behavior row values the ability conditions are multiplied with
+	struct FBehaviorValues
+	{
+		float Attack = 0.f;
+		float Block = 0.f;
+		float Dodge = 0.f;
+		float RangedAttack = 0.f;
+		float UltimateAttack = 0.f;
+	};
+
+	// What the step conditions read about an agent & one target
+	struct FStepFacts
+	{
+		float Distance = 0.f;
+		bool bDetected = false;
+		// The target is attacking or any nearby enemy telegraphed an attack
+		bool bEnemyAttacking = false;
+		bool bCanStrafe = false;
+		bool bCanBlock = false;
+		bool bCanDodge = false;
+	};
+
+	struct FDefenderState
+	{
+		float Health = 0.f;
+		bool bBlocking = false;
+		bool bDodging = false;
+	};
+
+	struct FDamageResult
+	{
+		// Damage actually taken after blocking or dodging
+		float Damage = 0.f;
+		float Health = 0.f;
+		bool bKilled = false;
+		EHitOutcome Outcome = EHitOutcome::Hit;
+	};
+
+	// Statistical model of one archetype for abstract fights
+	struct FExchangeProfile
+	{
+		float MaxHealth = 0.f;
+		float DamagePerSecond = 0.f;
+		float BlockChance = 0.f;
+		float DodgeChance = 0.f;
+	};
+
+	struct FDuelStats
+	{
+		int32_t NumDuels = 0;
+		int32_t WinsA = 0;
+		// Duels only one side survived (simultaneous kills & timeouts count for neither)
+		int32_t Decisive = 0;
+		int64_t NumExchanges = 0;
+		double TotalDuration = 0.0;
+	};
+
+	// Small fast generator for the simulations (xorshift, not for anything that needs good statistics across streams)
+	struct FCombatRandom
+	{
+		explicit FCombatRandom(uint32_t Seed) : State(Seed != 0 ? Seed : 0x9E3779B9u) {}
+
+		uint32_t NextUInt()
+		{
+			State ^= State << 13;
+			State ^= State >> 17;
+			State ^= State << 5;
+			return State;
+		}
+
+		// [0, 1)
+		float NextFloat() { return (NextUInt() >> 8) * (1.f / 16777216.f); }
+
+		uint32_t State;
+	};
+
+	constexpr ERangeBand GetRangeBand(float Distance, const FRangeProfile& Ranges)
+	{
+		return Distance <= Ranges.AttackRange ? ERangeBand::Melee : (Distance <= Ranges.RangedAttackRange ? ERangeBand::Ranged : ERangeBand::OutOfRange);
+	}
+
+	// Roll in [0, 1)
+	constexpr int32_t PickAttackSection(float Roll)
+	{
+		return Roll <= 0.f ? 0 : (Roll >= 1.f ? NumAttackSections - 1 : static_cast<int32_t>(Roll * NumAttackSections));
+	}
+
+	constexpr float RollCooldown(const FCooldownRange& Range, float Roll)
+	{
+		return Range.Min + (Range.Max - Range.Min) * Roll;
+	}
+
+	// Health & damage taken by a defender hit for Damage (the AI TakeDamage rules, a killing blow isn't mitigated)
+	COMBATCORE_API FDamageResult ResolveDamage(const FDefenderState& Defender, float Damage);
+
+	// Behavior value multiplied by every condition, with a makeup term so several conditions don't shrink the score
+	COMBATCORE_API float ScoreConditions(float BehaviorValue, const float* Conditions, int32_t NumConditions);
+
+	// Row value of the ability, 1 for seek & strafe which have none
+	COMBATCORE_API float GetBehaviorValue(const FBehaviorValues& Behavior, EAbility Ability);
+
+	// Score of the ability from its built in step condition (abilities without consideration curves)
+	COMBATCORE_API float StepScore(EAbility Ability, const FBehaviorValues& Behavior, const FRangeProfile& Ranges, const FStepFacts& Facts);
+
+	// Best step score the ability can reach, used to prune (ability, target) pairs
+	COMBATCORE_API float StepUpperBound(EAbility Ability, const FBehaviorValues& Behavior);
+
+	// Prioritized dithering over the ability scores (Roll in [0, 1)), later abilities whose score beats the roll win & nothing scoring picks the first
+	COMBATCORE_API int32_t PickDitheredAbility(const float* Scores, int32_t NumScores, float Roll);
+
+	// Damage the attacker deals the defender over DeltaTime in the abstract model, Roll in [0, 1) decides the dodge or block
+	COMBATCORE_API float ResolveExchange(const FExchangeProfile& Attacker, const FExchangeProfile& Defender, float DeltaTime, float Roll, EHitOutcome& OutHit);
+
+	// Runs NumDuels abstract duels of A against B from full health, adding the results to OutStats
+	COMBATCORE_API void SimulateDuels(const FExchangeProfile& A, const FExchangeProfile& B, float DeltaTime, float MaxDuration, int32_t NumDuels, FCombatRandom& Random, FDuelStats& OutStats);
+}
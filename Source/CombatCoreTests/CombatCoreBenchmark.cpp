@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatRules.h"
+#include "CombatMatch.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace CombatCore;
+
+namespace
+{
+	double SecondsSince(std::chrono::steady_clock::time_point Start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	}
+
+	// Abstract duels of the default archetype model on NumThreads threads, each with its own random stream
+	void BenchmarkExchanges(int32_t NumThreads, int32_t DuelsPerThread)
+	{
+		const FExchangeProfile Profile = { 300.f, 15.f, 0.2f, 0.1f };
+		std::vector<FDuelStats> Stats(NumThreads);
+		std::vector<std::thread> Threads;
+
+		const auto Start = std::chrono::steady_clock::now();
+		for (int32_t Thread = 0; Thread < NumThreads; ++Thread)
+		{
+			Threads.emplace_back([&, Thread]()
+			{
+				FCombatRandom Random(1234 + Thread);
+				SimulateDuels(Profile, Profile, 0.5f, 600.f, DuelsPerThread, Random, Stats[Thread]);
+			});
+		}
+		for (std::thread& Thread : Threads)
+		{
+			Thread.join();
+		}
+		const double Seconds = SecondsSince(Start);
+
+		long long NumExchanges = 0;
+		for (const FDuelStats& ThreadStats : Stats)
+		{
+			NumExchanges += ThreadStats.NumExchanges;
+		}
+		std::printf("exchanges, %2d threads: %lld in %.1f ms (%.1f million exchanges/s)\n", NumThreads, NumExchanges, Seconds * 1000.0, NumExchanges / Seconds / 1e6);
+	}
+
+	void BenchmarkMatches(int32_t TeamSize, int32_t NumMatches)
+	{
+		const FBehaviorValues Behavior = { 0.7f, 0.5f, 0.5f, 0.4f, 0.3f };
+		FMatchArchetype Archetype;
+		FMatchConfig Config;
+		Config.TeamSize = TeamSize;
+
+		FCombatRandom Random(7);
+		FMatchStats Stats;
+		const auto Start = std::chrono::steady_clock::now();
+		for (int32_t Match = 0; Match < NumMatches; ++Match)
+		{
+			SimulateMatch(Behavior, Behavior, Archetype, Config, Random, Stats);
+		}
+		const double Seconds = SecondsSince(Start);
+
+		std::printf("matches, %dv%d, 1 thread: %d in %.1f ms (%.0f matches/min)\n", TeamSize, TeamSize, NumMatches, Seconds * 1000.0, NumMatches / Seconds * 60.0);
+	}
+}
+
+// CombatCoreBenchmark [duels per thread]
+int main(int Argc, char** Argv)
+{
+	const int32_t DuelsPerThread = Argc > 1 ? std::max(std::atoi(Argv[1]), 1) : 100000;
+	const int32_t MaxThreads = std::max(static_cast<int32_t>(std::thread::hardware_concurrency()), 1);
+
+	BenchmarkExchanges(1, DuelsPerThread);
+	if(MaxThreads > 1)
+	{
+		BenchmarkExchanges(MaxThreads, DuelsPerThread);
+	}
+
+	BenchmarkMatches(1, 2000);
+	BenchmarkMatches(4, 500);
+	return 0;
+}
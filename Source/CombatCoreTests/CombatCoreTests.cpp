@@ -0,0 +1,235 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatRules.h"
+#include "CombatMatch.h"
+#include <cmath>
+#include <cstdio>
+#include <initializer_list>
+
+using namespace CombatCore;
+
+namespace
+{
+	int32_t NumFailures = 0;
+	int32_t NumChecks = 0;
+
+	void Check(bool bCondition, const char* Expression, const char* File, int Line)
+	{
+		++NumChecks;
+		if(!bCondition)
+		{
+			++NumFailures;
+			std::printf("%s:%d: check failed: %s\n", File, Line, Expression);
+		}
+	}
+
+	bool Near(float A, float B, float Tolerance = 1e-5f)
+	{
+		return std::fabs(A - B) <= Tolerance;
+	}
+}
+
+#define CHECK(Expression) Check((Expression), #Expression, __FILE__, __LINE__)
+
+static void TestResolveDamage()
+{
+	// Plain hit
+	FDamageResult Result = ResolveDamage({ 100.f, false, false }, 20.f);
+	CHECK(Near(Result.Damage, 20.f) && Near(Result.Health, 80.f) && !Result.bKilled && Result.Outcome == EHitOutcome::Hit);
+
+	// Blocking halves the damage
+	Result = ResolveDamage({ 100.f, true, false }, 20.f);
+	CHECK(Near(Result.Damage, 20.f * BlockDamageScale) && Near(Result.Health, 90.f) && !Result.bKilled && Result.Outcome == EHitOutcome::Blocked);
+
+	// Dodging avoids it (& wins over blocking)
+	Result = ResolveDamage({ 100.f, true, true }, 20.f);
+	CHECK(Near(Result.Damage, 0.f) && Near(Result.Health, 100.f) && !Result.bKilled && Result.Outcome == EHitOutcome::Dodged);
+
+	// A killing blow isn't mitigated, even while blocking or dodging
+	Result = ResolveDamage({ 15.f, true, false }, 20.f);
+	CHECK(Result.bKilled && Near(Result.Health, 0.f) && Near(Result.Damage, 20.f) && Result.Outcome == EHitOutcome::Blocked);
+	Result = ResolveDamage({ 15.f, false, true }, 20.f);
+	CHECK(Result.bKilled && Near(Result.Damage, 20.f));
+
+	// Exactly lethal counts as a kill
+	Result = ResolveDamage({ 20.f, false, false }, 20.f);
+	CHECK(Result.bKilled && Near(Result.Health, 0.f));
+}
+
+static void TestRangeBands()
+{
+	const FRangeProfile Ranges = { 250.f, 350.f };
+	CHECK(GetRangeBand(0.f, Ranges) == ERangeBand::Melee);
+	CHECK(GetRangeBand(250.f, Ranges) == ERangeBand::Melee);
+	CHECK(GetRangeBand(250.01f, Ranges) == ERangeBand::Ranged);
+	CHECK(GetRangeBand(350.f, Ranges) == ERangeBand::Ranged);
+	CHECK(GetRangeBand(350.01f, Ranges) == ERangeBand::OutOfRange);
+
+	// No ranged band when the ranged range doesn't reach past the attack range
+	CHECK(GetRangeBand(260.f, { 250.f, 200.f }) == ERangeBand::OutOfRange);
+}
+
+static void TestScoreConditions()
+{
+	// One condition gets no makeup
+	const float One[] = { 0.6f };
+	CHECK(Near(ScoreConditions(0.7f, One, 1), 0.42f));
+
+	// Two or more get the full makeup (score + (1 - score) * score)
+	const float Two[] = { 0.6f, 0.5f };
+	const float Product = 0.7f * 0.6f * 0.5f;
+	CHECK(Near(ScoreConditions(0.7f, Two, 2), Product + (1.f - Product) * Product));
+	const float Three[] = { 0.6f, 0.5f, 0.9f };
+	const float Product3 = 0.7f * 0.6f * 0.5f * 0.9f;
+	CHECK(Near(ScoreConditions(0.7f, Three, 3), Product3 + (1.f - Product3) * Product3));
+
+	// Any zero condition zeroes the score
+	const float WithZero[] = { 0.6f, 0.f };
+	CHECK(ScoreConditions(0.7f, WithZero, 2) == 0.f);
+	CHECK(ScoreConditions(0.f, One, 1) == 0.f);
+
+	// No conditions keep the behavior value
+	CHECK(Near(ScoreConditions(0.7f, nullptr, 0), 0.7f));
+}
+
+static void TestStepScores()
+{
+	const FBehaviorValues Behavior = { 0.7f, 0.5f, 0.5f, 0.4f, 0.3f };
+	const FRangeProfile Ranges = { 250.f, 350.f };
+
+	FStepFacts Facts;
+	Facts.bDetected = true;
+	Facts.Distance = 100.f;
+	CHECK(StepScore(EAbility::Attack, Behavior, Ranges, Facts) > 0.f);
+	CHECK(StepScore(EAbility::Seek, Behavior, Ranges, Facts) == 0.f);
+	CHECK(StepScore(EAbility::RangedAttack, Behavior, Ranges, Facts) == 0.f);
+	CHECK(StepScore(EAbility::Block, Behavior, Ranges, Facts) == 0.f);
+
+	Facts.Distance = 300.f;
+	CHECK(StepScore(EAbility::RangedAttack, Behavior, Ranges, Facts) > 0.f);
+	CHECK(StepScore(EAbility::Seek, Behavior, Ranges, Facts) == 0.f);
+
+	Facts.Distance = 1000.f;
+	CHECK(StepScore(EAbility::Seek, Behavior, Ranges, Facts) > 0.f);
+
+	Facts.bEnemyAttacking = true;
+	Facts.bCanBlock = true;
+	CHECK(StepScore(EAbility::Block, Behavior, Ranges, Facts) > 0.f);
+	CHECK(StepScore(EAbility::Dodge, Behavior, Ranges, Facts) == 0.f);
+
+	// Step scores never beat their upper bound
+	for (int32_t Ability = 0; Ability < static_cast<int32_t>(EAbility::Count); ++Ability)
+	{
+		Facts.bCanDodge = Facts.bCanStrafe = true;
+		for (const float Distance : { 100.f, 300.f, 1000.f })
+		{
+			Facts.Distance = Distance;
+			CHECK(StepScore(static_cast<EAbility>(Ability), Behavior, Ranges, Facts) <= StepUpperBound(static_cast<EAbility>(Ability), Behavior) + 1e-6f);
+		}
+	}
+}
+
+static void TestPickDitheredAbility()
+{
+	// Nothing scoring picks the first ability
+	const float Zeros[7] = {};
+	CHECK(PickDitheredAbility(Zeros, 7, 0.f) == 0);
+	CHECK(PickDitheredAbility(Zeros, 7, 0.99f) == 0);
+
+	// The last ability whose score beats the roll wins
+	const float Scores[7] = { 0.f, 0.f, 0.42f, 0.f, 0.06f, 0.f, 0.f };
+	CHECK(PickDitheredAbility(Scores, 7, 0.3f) == 2);
+	CHECK(PickDitheredAbility(Scores, 7, 0.01f) == 4);
+	CHECK(PickDitheredAbility(Scores, 7, 0.5f) == 0);
+
+	// Equal scores resolve to the first ability with that score
+	const float Ties[7] = { 0.f, 0.3f, 0.f, 0.3f, 0.f, 0.f, 0.3f };
+	CHECK(PickDitheredAbility(Ties, 7, 0.1f) == 1);
+}
+
+static void TestResolveExchange()
+{
+	const FExchangeProfile Attacker = { 300.f, 10.f, 0.f, 0.f };
+	const FExchangeProfile Defender = { 300.f, 10.f, 0.2f, 0.1f };
+
+	EHitOutcome Hit;
+	CHECK(Near(ResolveExchange(Attacker, Defender, 0.5f, 0.05f, Hit), 0.f) && Hit == EHitOutcome::Dodged);
+	CHECK(Near(ResolveExchange(Attacker, Defender, 0.5f, 0.15f, Hit), 5.f * BlockDamageScale) && Hit == EHitOutcome::Blocked);
+	CHECK(Near(ResolveExchange(Attacker, Defender, 0.5f, 0.5f, Hit), 5.f) && Hit == EHitOutcome::Hit);
+
+	// Boundaries of the dodge & block bands
+	CHECK(Near(ResolveExchange(Attacker, Defender, 0.5f, 0.1f, Hit), 5.f * BlockDamageScale) && Hit == EHitOutcome::Blocked);
+	CHECK(Near(ResolveExchange(Attacker, Defender, 0.5f, 0.3f, Hit), 5.f) && Hit == EHitOutcome::Hit);
+
+	// Mirror duels are a coin flip
+	FCombatRandom Random(42);
+	FDuelStats Stats;
+	SimulateDuels(Defender, Defender, 0.5f, 600.f, 20000, Random, Stats);
+	CHECK(Stats.NumDuels == 20000 && Stats.Decisive > 0);
+	CHECK(std::fabs(static_cast<double>(Stats.WinsA) / Stats.Decisive - 0.5) < 0.03);
+}
+
+static void TestMatchBalance()
+{
+	// Identical teams must win as often as each other, whichever team is stored (& used to be updated) first
+	const FBehaviorValues Behavior = { 0.7f, 0.5f, 0.5f, 0.4f, 0.3f };
+	const FMatchArchetype Archetype;
+	for (const int32_t TeamSize : { 1, 4 })
+	{
+		FMatchConfig Config;
+		Config.TeamSize = TeamSize;
+
+		FCombatRandom Random(99);
+		FMatchStats Stats;
+		const int32_t NumMatches = TeamSize == 1 ? 20000 : 4000;
+		for (int32_t Match = 0; Match < NumMatches; ++Match)
+		{
+			SimulateMatch(Behavior, Behavior, Archetype, Config, Random, Stats);
+		}
+
+		CHECK(Stats.NumMatches == NumMatches && Stats.Decisive > NumMatches / 2);
+		CHECK(std::fabs(static_cast<double>(Stats.WinsA) / Stats.Decisive - 0.5) < (TeamSize == 1 ? 0.015 : 0.03));
+	}
+}
+
+static void TestRolls()
+{
+	CHECK(Near(RollCooldown(StrafeCooldown, 0.f), StrafeCooldown.Min));
+	CHECK(Near(RollCooldown(StrafeCooldown, 1.f), StrafeCooldown.Max));
+	CHECK(Near(RollCooldown(BlockCooldown, 0.5f), (BlockCooldown.Min + BlockCooldown.Max) * 0.5f));
+
+	CHECK(PickAttackSection(-1.f) == 0);
+	CHECK(PickAttackSection(0.f) == 0);
+	CHECK(PickAttackSection(0.2499f) == 0);
+	CHECK(PickAttackSection(0.25f) == 1);
+	CHECK(PickAttackSection(0.9999f) == NumAttackSections - 1);
+	CHECK(PickAttackSection(1.f) == NumAttackSections - 1);
+	CHECK(PickAttackSection(2.f) == NumAttackSections - 1);
+
+	FCombatRandom Random(0);
+	for (int32_t Index = 0; Index < 100000; ++Index)
+	{
+		const float Roll = Random.NextFloat();
+		if(Roll < 0.f || Roll >= 1.f)
+		{
+			CHECK(Roll >= 0.f && Roll < 1.f);
+			break;
+		}
+	}
+}
+
+int main()
+{
+	TestResolveDamage();
+	TestRangeBands();
+	TestScoreConditions();
+	TestStepScores();
+	TestPickDitheredAbility();
+	TestResolveExchange();
+	TestMatchBalance();
+	TestRolls();
+
+	std::printf("%d checks, %d failed\n", NumChecks, NumFailures);
+	return NumFailures == 0 ? 0 : 1;
+}